@@ -41,6 +41,8 @@
 // standard headers
 //
 
+#include <algorithm>
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -52,6 +54,7 @@
 
 #include "executor.h"
 #include "inspector.h"
+#include "cache.h"
 
 #define TILE_SIZE 5000
 
@@ -70,6 +73,15 @@ double gam, gm1, cfl, eps, mach, alpha, qinf[4];
 #include "update.h"
 #include "update1.h"
 
+// the mesh is read with int indices, while SLOPE maps might hold wider ones
+// (see SLOPE_LONG_INDICES)
+static index_t* to_indices (int* values, int size)
+{
+  index_t* indices = new index_t[size];
+  std::copy (values, values + size, indices);
+  return indices;
+}
+
 // main program
 
 int main(int argc, char **argv)
@@ -91,8 +103,7 @@ int main(int argc, char **argv)
   //
 
   const int avgTileSize = (argc == 1) ? TILE_SIZE : atoi(argv[1]);
-  const int nLoops = 6;
-  const int seedTilePoint = nLoops / 2;
+  const int seedTilePoint = SEED_AUTO;
 
   printf("running inspector\n");
 
@@ -104,11 +115,11 @@ int main(int argc, char **argv)
   set_t* cells = set("cells", nCells);
 
   // maps
-  map_t* c2nMap = map("c2n", cells, nodes, c2n, nCells*4);
-  map_t* e2nMap = map("e2n", edges, nodes, e2n, nEdges*2);
-  map_t* e2cMap = map("e2c", edges, cells, e2c, nEdges*2);
-  map_t* be2nMap = map("be2n", bedges, nodes, be2n, nBedges*2);
-  map_t* be2cMap = map("be2c", bedges, cells, be2c, nBedges*1);
+  map_t* c2nMap = map("c2n", cells, nodes, to_indices (c2n, nCells*4), nCells*4);
+  map_t* e2nMap = map("e2n", edges, nodes, to_indices (e2n, nEdges*2), nEdges*2);
+  map_t* e2cMap = map("e2c", edges, cells, to_indices (e2c, nEdges*2), nEdges*2);
+  map_t* be2nMap = map("be2n", bedges, nodes, to_indices (be2n, nBedges*2), nBedges*2);
+  map_t* be2cMap = map("be2c", bedges, cells, to_indices (be2c, nBedges*1), nBedges*1);
 
   // descriptors
   desc_list adtCalcDesc ({desc(c2nMap, READ),
@@ -138,7 +149,14 @@ int main(int argc, char **argv)
   insp_add_parloop (insp, "bresCalc2", bedges, &bresCalcDesc);
   insp_add_parloop (insp, "update2", cells, &updateDesc);
 
-  insp_run (insp, seedTilePoint);
+  // an optional second argument is a file in which the inspection is cached
+  // across runs
+  if (argc <= 2 || insp_load (insp, seedTilePoint, argv[2]) != INSP_OK) {
+    insp_run (insp, seedTilePoint);
+    if (argc > 2) {
+      insp_save (insp, seedTilePoint, argv[2]);
+    }
+  }
 
   insp_print (insp, LOW);
 
@@ -156,6 +174,21 @@ int main(int argc, char **argv)
   executor_t* exec = exec_init (insp);
   int nColors = exec_num_colors (exec);;
 
+  // the executor plans are all that is needed from now on
+  exec_free_tiles (exec);
+
+  // resolve the local maps once, rather than per tile
+  int hc2n_0 = exec_map_handle (exec, 0, "c2n");
+  int he2n_1 = exec_map_handle (exec, 1, "e2n");
+  int he2c_1 = exec_map_handle (exec, 1, "e2c");
+  int hbe2n_2 = exec_map_handle (exec, 2, "be2n");
+  int hbe2c_2 = exec_map_handle (exec, 2, "be2c");
+  int hc2n_4 = exec_map_handle (exec, 4, "c2n");
+  int he2n_5 = exec_map_handle (exec, 5, "e2n");
+  int he2c_5 = exec_map_handle (exec, 5, "e2c");
+  int hbe2n_6 = exec_map_handle (exec, 6, "be2n");
+  int hbe2c_6 = exec_map_handle (exec, 6, "be2c");
+
   // initialise timers for total execution wall time
   double start = time_stamp();
 
@@ -185,13 +218,12 @@ int main(int argc, char **argv)
         #pragma omp parallel for
         for (int j = 0; j < nTilesPerColor; j++) {
           // execute the tile
-          tile_t* tile = exec_tile_at (exec, i, j);
           int tileLoopSize;
 
           // loop adt_calc (calculate area/timstep)
-          iterations_list& lc2n_0 = tile_get_local_map (tile, 0, "c2n");
-          iterations_list& iterations_0 = tile_get_iterations (tile, 0);
-          tileLoopSize = tile_loop_size (tile, 0);
+          index_t* lc2n_0 = exec_local_map (exec, i, j, 0, hc2n_0);
+          index_t* iterations_0 = exec_iterations (exec, i, j, 0);
+          tileLoopSize = exec_loop_size (exec, i, j, 0);
           #pragma omp simd
           for (int k = 0; k < tileLoopSize; k++) {
             adt_calc (x + lc2n_0[k*4 + 0]*2,
@@ -203,10 +235,10 @@ int main(int argc, char **argv)
           }
 
           // loop res_calc
-          iterations_list& le2n_1 = tile_get_local_map (tile, 1, "e2n");
-          iterations_list& le2c_1 = tile_get_local_map (tile, 1, "e2c");
-          iterations_list& iterations_1 = tile_get_iterations (tile, 1);
-          tileLoopSize = tile_loop_size (tile, 1);
+          index_t* le2n_1 = exec_local_map (exec, i, j, 1, he2n_1);
+          index_t* le2c_1 = exec_local_map (exec, i, j, 1, he2c_1);
+          index_t* iterations_1 = exec_iterations (exec, i, j, 1);
+          tileLoopSize = exec_loop_size (exec, i, j, 1);
           for (int k = 0; k < tileLoopSize; k++) {
             res_calc (x + le2n_1[k*2 + 0]*2,
                       x + le2n_1[k*2 + 1]*2,
@@ -219,10 +251,10 @@ int main(int argc, char **argv)
           }
 
           // loop bres_calc
-          iterations_list& lbe2n_2 = tile_get_local_map (tile, 2, "be2n");
-          iterations_list& lbe2c_2 = tile_get_local_map (tile, 2, "be2c");
-          iterations_list& iterations_2 = tile_get_iterations (tile, 2);
-          tileLoopSize = tile_loop_size (tile, 2);
+          index_t* lbe2n_2 = exec_local_map (exec, i, j, 2, hbe2n_2);
+          index_t* lbe2c_2 = exec_local_map (exec, i, j, 2, hbe2c_2);
+          index_t* iterations_2 = exec_iterations (exec, i, j, 2);
+          tileLoopSize = exec_loop_size (exec, i, j, 2);
           for (int k = 0; k < tileLoopSize; k++) {
             bres_calc (x + lbe2n_2[k*2 + 0]*2,
                        x + lbe2n_2[k*2 + 1]*2,
@@ -233,8 +265,8 @@ int main(int argc, char **argv)
           }
 
           // loop update
-          iterations_list& iterations_3 = tile_get_iterations (tile, 3);
-          tileLoopSize = tile_loop_size (tile, 3);
+          index_t* iterations_3 = exec_iterations (exec, i, j, 3);
+          tileLoopSize = exec_loop_size (exec, i, j, 3);
           for (int k = 0; k < tileLoopSize; k++) {
             update    (qold + iterations_3[k]*4,
                        q + iterations_3[k]*4,
@@ -243,9 +275,9 @@ int main(int argc, char **argv)
           }
 
           // loop adt_calc (k = 2)
-          iterations_list& lc2n_4 = tile_get_local_map (tile, 4, "c2n");
-          iterations_list& iterations_4 = tile_get_iterations (tile, 4);
-          tileLoopSize = tile_loop_size (tile, 4);
+          index_t* lc2n_4 = exec_local_map (exec, i, j, 4, hc2n_4);
+          index_t* iterations_4 = exec_iterations (exec, i, j, 4);
+          tileLoopSize = exec_loop_size (exec, i, j, 4);
           #pragma omp simd
           for (int k = 0; k < tileLoopSize; k++) {
             adt_calc (x + lc2n_4[k*4 + 0]*2,
@@ -257,10 +289,10 @@ int main(int argc, char **argv)
           }
 
           // loop res_calc (k = 2)
-          iterations_list& le2n_5 = tile_get_local_map (tile, 5, "e2n");
-          iterations_list& le2c_5 = tile_get_local_map (tile, 5, "e2c");
-          iterations_list& iterations_5 = tile_get_iterations (tile, 5);
-          tileLoopSize = tile_loop_size (tile, 5);
+          index_t* le2n_5 = exec_local_map (exec, i, j, 5, he2n_5);
+          index_t* le2c_5 = exec_local_map (exec, i, j, 5, he2c_5);
+          index_t* iterations_5 = exec_iterations (exec, i, j, 5);
+          tileLoopSize = exec_loop_size (exec, i, j, 5);
           for (int k = 0; k < tileLoopSize; k++) {
             res_calc (x + le2n_5[k*2 + 0]*2,
                       x + le2n_5[k*2 + 1]*2,
@@ -273,10 +305,10 @@ int main(int argc, char **argv)
           }
 
           // loop bres_calc (k = 2)
-          iterations_list& lbe2n_6 = tile_get_local_map (tile, 6, "be2n");
-          iterations_list& lbe2c_6 = tile_get_local_map (tile, 6, "be2c");
-          iterations_list& iterations_6 = tile_get_iterations (tile, 6);
-          tileLoopSize = tile_loop_size (tile, 6);
+          index_t* lbe2n_6 = exec_local_map (exec, i, j, 6, hbe2n_6);
+          index_t* lbe2c_6 = exec_local_map (exec, i, j, 6, hbe2c_6);
+          index_t* iterations_6 = exec_iterations (exec, i, j, 6);
+          tileLoopSize = exec_loop_size (exec, i, j, 6);
           for (int k = 0; k < tileLoopSize; k++) {
             bres_calc (x + lbe2n_6[k*2 + 0]*2,
                        x + lbe2n_6[k*2 + 1]*2,
@@ -287,8 +319,8 @@ int main(int argc, char **argv)
           }
 
           // loop update
-          iterations_list& iterations_7 = tile_get_iterations (tile, 7);
-          tileLoopSize = tile_loop_size (tile, 7);
+          index_t* iterations_7 = exec_iterations (exec, i, j, 7);
+          tileLoopSize = exec_loop_size (exec, i, j, 7);
           for (int k = 0; k < tileLoopSize; k++) {
             update    (qold + iterations_7[k]*4,
                        q + iterations_7[k]*4,
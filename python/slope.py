@@ -4,15 +4,26 @@
 # Author: Fabio Luporini (2015)
 
 import ctypes
+import os
 
 
 ### SLOPE C-types for python-C interaction ###
 
+# The type of set sizes and map entries, ``index_t`` in SLOPE. This must match
+# the build of the SLOPE library, so it is taken from the same variable: if
+# SLOPE_LONG_INDICES is set, indices are 64-bit integers
+long_indices = bool(os.environ.get('SLOPE_LONG_INDICES'))
+c_index_t = ctypes.c_int64 if long_indices else ctypes.c_int
+
+# The seed loop partitioning modes based on the coordinates of the mesh nodes
+geometric_part_modes = ('hilbert', 'morton', 'rcb')
+
+
 class Set(ctypes.Structure):
     _fields_ = [('name', ctypes.c_char_p),
-                ('core', ctypes.c_int),
-                ('exec', ctypes.c_int),
-                ('nonexec', ctypes.c_int)]
+                ('core', c_index_t),
+                ('exec', c_index_t),
+                ('nonexec', c_index_t)]
 
 
 class Dat(ctypes.Structure):
@@ -22,14 +33,14 @@ class Dat(ctypes.Structure):
 
 class Map(ctypes.Structure):
     _fields_ = [('name', ctypes.c_char_p),
-                ('map', ctypes.POINTER(ctypes.c_int)),
-                ('size', ctypes.c_int)]
+                ('map', ctypes.POINTER(c_index_t)),
+                ('size', c_index_t)]
 
 
 class Part(ctypes.Structure):
     _fields_ = [('name', ctypes.c_char_p),
-                ('data', ctypes.POINTER(ctypes.c_int)),
-                ('size', ctypes.c_int),
+                ('data', ctypes.POINTER(c_index_t)),
+                ('size', c_index_t),
                 ('nparts', ctypes.c_int)]
 
 
@@ -47,7 +58,7 @@ class Inspector(object):
     mesh_map_def = 'map_t* %s = map(mesh_maps[%d].name, %s, %s, mesh_maps[%d].map, mesh_maps[%d].size);'
     part_def = 'set_t* %s = set(partitionings[%d].name, partitionings[%d].nparts, 0, 0, NULL);\n  '
     part_def += 'map_t* %s = map(%s, %s, %s, partitionings[%d].part, partitionings[%d].size);'
-    desc_def = 'desc(%s, %s)'
+    desc_def = 'desc(%s, %s, %d)'
     desc_list_def = 'desc_list %s ({%s});'
     loop_def = 'insp_add_parloop(insp, "%s", %s, &%s);'
     output_vtk = 'generate_vtk(insp, %s, %s, (double*)coords_dat[0].data, %s, rank);'
@@ -62,15 +73,15 @@ class Inspector(object):
 // Inspector's ctypes-compatible data structures and functions
 typedef struct {
   char* name;
-  int core;
-  int exec;
-  int nonexec;
+  index_t core;
+  index_t exec;
+  index_t nonexec;
 } slope_set;
 
 typedef struct {
   char* name;
-  int* map;
-  int size;
+  index_t* map;
+  index_t size;
 } slope_map;
 
 typedef struct {
@@ -80,8 +91,8 @@ typedef struct {
 
 typedef struct {
   char* name;
-  int* part;
-  int size;
+  index_t* part;
+  index_t size;
   int nparts;
 } slope_part;
 
@@ -121,7 +132,9 @@ void* inspector(slope_set sets[%(n_sets)d],
   int prefetchHalo = %(prefetchHalo)d;
   bool ignoreWAR = %(ignore_war)s;
   inspector_t* insp = insp_init (avgTileSize, %(mode)s, %(coloring)s, %(mesh_map_list)s,
-                                 %(partitionings_list)s, prefetchHalo, ignoreWAR, %(name)s);
+                                 %(partitionings_list)s, prefetchHalo, ignoreWAR, %(name)s,
+                                 %(partitioning)s, %(coordinates)s, %(mesh_dim)s, %(max_colors)d,
+                                 %(repair_conflicts)s);
 
   %(loop_defs)s
 
@@ -134,6 +147,7 @@ void* inspector(slope_set sets[%(n_sets)d],
   }
 
   executor_t* exec = exec_init (insp);
+  exec_free_tiles (exec);
   insp_free (insp);
   delete meshMaps;
   return exec;
@@ -152,6 +166,8 @@ void* inspector(slope_set sets[%(n_sets)d],
 
         self._part_mode = kwargs.get('part_mode', 'chunk')
         self._coloring = kwargs.get('coloring', 'default')
+        self._max_colors = kwargs.get('max_colors', 0)
+        self._repair_conflicts = kwargs.get('repair_conflicts', False)
         self._prefetch = kwargs.get('prefetch', 0)
         self._seed_loop = kwargs.get('seed_loop', None)
         self._ignore_war = kwargs.get('ignore_war', False)
@@ -180,8 +196,7 @@ void* inspector(slope_set sets[%(n_sets)d],
         maps = [(_fix_c(n), _fix_c(i), _fix_c(o), v) for n, i, o, v in maps]
         ctype = Map*len(maps)
         self._maps = maps
-        return (ctype, ctype(*[Map(n, v.ctypes.data_as(ctypes.POINTER(ctypes.c_int)),
-                                   v.size) for n, _, _, v in maps]))
+        return (ctype, ctype(*[Map(n, _index_ptr(v), v.size) for n, _, _, v in maps]))
 
     def add_loops(self, loops):
         """Add a list of ``loops`` to this Inspector
@@ -195,9 +210,12 @@ void* inspector(slope_set sets[%(n_sets)d],
                     (previously defined through a call to ``map(...)``) and the
                     second entry is the access mode (e.g., RW, READ, INC, ...).
                     If the access to a dataset does not involve any map, than the
-                    first entry assumes the value of the special keyword ``DIRECT``
+                    first entry assumes the value of the special keyword ``DIRECT``.
+                    An optional third entry is the number of bytes of the dataset
+                    per element of the target set, used to compute tile footprints
         """
-        self._loops = [(_fix_c(n), _fix_c(s), [(_fix_c(i[0]), i[1]) for i in d])
+        self._loops = [(_fix_c(n), _fix_c(s), [(_fix_c(i[0]), i[1], i[2] if len(i) > 2 else 0)
+                                               for i in d])
                        for n, s, d in loops]
 
     def add_partitionings(self, partitionings):
@@ -210,8 +228,8 @@ void* inspector(slope_set sets[%(n_sets)d],
                           '%s_partitioning' % _fix_c(s), v) for s, v in partitionings]
         ctype = Part*len(partitionings)
         self._partitionings = partitionings
-        return (ctype, ctype(*[Part(s, v.ctypes.data_as(ctypes.POINTER(ctypes.c_int)),
-                                    v.size, max(v)) for n, _, _, v in partitionings]))
+        return (ctype, ctype(*[Part(s, _index_ptr(v), v.size, max(v))
+                               for n, _, _, v in partitionings]))
 
     def set_tile_size(self, tile_size):
         """Set a tile size for this Inspector"""
@@ -230,27 +248,45 @@ void* inspector(slope_set sets[%(n_sets)d],
         :param kwargs:
             * 'ignore_war': inform the inspector that for the given loop chain
                 there is no need to track write-after-read dependencies.
-            * 'seed_loop': set the loop from which tiles are derived.
+            * 'seed_loop': set the loop from which tiles are derived, or
+                ``auto`` to let the inspector select it.
             * 'prefetch': a value N such that N >= 0, default N = 0. N is the
                 software prefetch distance that will be used by the executor.
             * 'coloring': set a coloring mode (available: ``default``, ``rand``,
-                ``mincols``). May be used to improve load balancing.
+                ``mincols``, ``balanced``). May be used to improve load balancing.
             * 'part_mode': set the seed loop partitioning mode (available:
-                ``chunk``, ``metis``). May be used to improve load balancing.
+                ``chunk``, ``metis``, ``bfs``, ``hilbert``, ``morton``, ``rcb``).
+                May be used to improve load balancing. ``hilbert``, ``morton`` and
+                ``rcb`` partition the mesh geometrically, so they need the mesh maps
+                (see ``set_mesh_maps``) and the coordinates of the nodes (see
+                ``set_coordinates``).
+            * 'max_colors': a value N such that N >= 0, default N = 0 (no limit).
+                If tiling produces more than N colors, tiles are merged.
+            * 'repair_conflicts': if True, conflicts between tiles are repaired
+                by recoloring only the tiles concerned and tiling again only the
+                affected iterations, rather than the whole loop chain. Default False.
         """
         self._ignore_war = kwargs.get('ignore_war', False)
 
         self._seed_loop = kwargs.get('seed_loop', 0)
-        assert self._seed_loop >= 0 and self._seed_loop < len(self._loops)
+        if self._seed_loop == 'auto':
+            self._seed_loop = -1
+        assert self._seed_loop >= -1 and self._seed_loop < len(self._loops)
 
         self._prefetch = kwargs.get('prefetch', 0)
         assert isinstance(self._prefetch, int) and self._prefetch >= 0
 
         self._coloring = kwargs.get('coloring', 'default')
-        assert self._coloring in ['default', 'rand', 'mincols']
+        assert self._coloring in ['default', 'rand', 'mincols', 'balanced']
 
         self._part_mode = kwargs.get('part_mode', 'chunk')
-        assert self._part_mode in ['chunk', 'metis']
+        assert self._part_mode in ['chunk', 'metis', 'bfs'] + list(geometric_part_modes)
+
+        self._max_colors = kwargs.get('max_colors', 0)
+        assert isinstance(self._max_colors, int) and self._max_colors >= 0
+
+        self._repair_conflicts = kwargs.get('repair_conflicts', False)
+        assert isinstance(self._repair_conflicts, bool)
 
     def add_extra_info(self):
         """Inspection/Execution can benefit of certain data fields that are not
@@ -286,9 +322,8 @@ void* inspector(slope_set sets[%(n_sets)d],
         mesh_maps = Inspector._globaldata.get('mesh_maps', [])
         ctype = Map*len(mesh_maps)
         self._mesh_maps = mesh_maps
-        extra.append((ctype, ctype(*[Map(n,
-                                         v.ctypes.data_as(ctypes.POINTER(ctypes.c_int)),
-                                         v.size) for n, _, _, v in mesh_maps])))
+        extra.append((ctype, ctype(*[Map(n, _index_ptr(v), v.size)
+                                     for n, _, _, v in mesh_maps])))
 
         return extra
 
@@ -304,14 +339,14 @@ void* inspector(slope_set sets[%(n_sets)d],
             descs_name = "%s_Desc_%d" % (loop_name, i)
             loop_name = "%s_Loop_%d" % (loop_name, i)
 
-            descs = [Inspector.desc_def % (d[0], d[1]) for d in loop_descs]
+            descs = [Inspector.desc_def % (d[0], d[1], d[2]) for d in loop_descs]
             desc_defs.append(Inspector.desc_list_def % (descs_name, ", ".join(descs)))
             loop_defs.append(Inspector.loop_def % (loop_name, loop_it_space, descs_name))
 
         avail = lambda s: all(i in [s[0] for s in self._sets] for i in s)
 
         mesh_map_defs, mesh_map_list = "", "NULL"
-        if self._mesh_maps and self._part_mode == 'metis':
+        if self._mesh_maps and self._part_mode in ['metis'] + list(geometric_part_modes):
             mesh_map_defs = [Inspector.mesh_map_def % ("mm_%s" % m[0], i, m[1], m[2], i, i)
                              for i, m in enumerate(self._mesh_maps) if avail([m[1], m[2]])]
             mesh_map_defs += ["meshMaps->insert(mm_%s);" % m[0]
@@ -328,11 +363,22 @@ void* inspector(slope_set sets[%(n_sets)d],
             partitionings_list = "setPartitionings"
 
         coloring = "COL_%s" % self._coloring.upper()
+        partitioning = "PART_DEFAULT"
+        if self._part_mode == 'bfs' or self._part_mode in geometric_part_modes:
+            partitioning = "PART_%s" % self._part_mode.upper()
+
+        coordinates = Inspector._globaldata.get('coordinates')
+        coordinates_arg, mesh_dim = "NULL", "DIM2"
+        if self._part_mode in geometric_part_modes:
+            if not (coordinates and mesh_map_list != "NULL"):
+                raise SlopeError("Partitioning mode %s needs mesh maps and coordinates"
+                                 % self._part_mode)
+            coordinates_arg = "(double*)coords_dat[0].data"
+            mesh_dim = "DIM%d" % coordinates[2]
 
         seed_loop = self._seed_loop if self._seed_loop is not None else len(self._loops) / 2
 
         debug_mode = Inspector._globaldata.get('debug_mode')
-        coordinates = Inspector._globaldata.get('coordinates')
         output_insp, output_vtk = "", ""
         if debug_mode:
             output_insp = Inspector.output_insp % debug_mode
@@ -349,6 +395,11 @@ void* inspector(slope_set sets[%(n_sets)d],
             'n_sets': len(self._sets),
             'mode': Inspector._globaldata['mode'],
             'coloring': coloring,
+            'partitioning': partitioning,
+            'coordinates': coordinates_arg,
+            'mesh_dim': mesh_dim,
+            'max_colors': self._max_colors,
+            'repair_conflicts': str(self._repair_conflicts).lower(),
             'prefetchHalo': self._prefetch,
             'seed': seed_loop,
             'mesh_map_defs': "\n  ".join(mesh_map_defs),
@@ -373,6 +424,7 @@ class Executor(object):
         'name_param_exec': '_exec',
         'name_local_map': 'loc_%(gmap)s_%(loop_id)d',
         'name_local_iters': 'iterations_%(loop_id)d',
+        'name_map_handle': 'h_%(gmap)s_%(loop_id)d',
         'loop_chain_body': '%(loop_chain_body)s',  # Instantiated user side
         'headers': ['#include "%s"' % h for h in ['inspector.h', 'executor.h', 'utils.h']],
         'ctype_exec': 'void*',
@@ -396,9 +448,7 @@ for (int i = 0; i < nColors; i++) {
   %(omp)s
   for (int j = 0; j < nTilesPerColor; j++) {
     // execute tile j for color i
-    tile_t* tile = exec_tile_at (%(name_exec)s, i, j, %(region_flag)s);
-    if (! tile) {
-      // this might be the case if the tile region does not match
+    if (exec_tile_region (%(name_exec)s, i, j) != %(region_flag)s) {
       continue;
     }
     int %(tile_end)s;
@@ -406,13 +456,16 @@ for (int i = 0; i < nColors; i++) {
     %(loop_chain_body)s
   }
 }
+"""
+    map_handle_def = """\
+int %(handle)s = exec_map_handle (%(name_exec)s, %(loop_id)d, "%(gmap)s");
 """
     local_map_def = """
-iterations_list& %(lmap)s = tile_get_local_map (tile, %(loop_id)d, "%(gmap)s");
+index_t* %(lmap)s = exec_local_map (%(name_exec)s, i, j, %(loop_id)d, %(handle)s);
 """
     local_iters = """\
-iterations_list& %(local_iters)s = tile_get_iterations (tile, %(loop_id)d);
-tileLoopSize = tile_loop_size (tile, %(loop_id)d);
+index_t* %(local_iters)s = exec_iterations (%(name_exec)s, i, j, %(loop_id)d);
+tileLoopSize = exec_loop_size (%(name_exec)s, i, j, %(loop_id)d);
 """
 
     debug_init = """
@@ -460,11 +513,12 @@ nIters[%(loop_id)d] += tileLoopSize;
     def __init__(self, inspector):
         code_dict = dict(Executor.meta)
         code_dict.update({'omp': self._omp_pragma()})
+        self._loop_init, self._gtl_maps, self._loop_end = self._genloops(inspector._loops)
         self._code = "\n".join([self._debug_init(inspector._loops),
                                 Executor.init_code % code_dict,
+                                self._map_handles(inspector._loops),
                                 Executor.outer_tiles_loop % code_dict,
                                 self._debug_end(inspector._name, inspector._loops)])
-        self._loop_init, self._gtl_maps, self._loop_end = self._genloops(inspector._loops)
 
     def _genloops(self, loops):
         """Return a 3-tuple, in which:
@@ -486,14 +540,16 @@ nIters[%(loop_id)d] += tileLoopSize;
                           for gmap in global_maps]
             gtl_map = dict(zip(global_maps, local_maps))
             local_maps_def = "".join([Executor.local_map_def % {
-                'gmap': gmap,
                 'lmap': lmap,
+                'handle': Executor.meta['name_map_handle'] % {'gmap': gmap, 'loop_id': i},
+                'name_exec': Executor.meta['name_exec'],
                 'loop_id': i} for gmap, lmap in gtl_map.items()])
             name_local_iters = Executor.meta['name_local_iters'] % {
                 'loop_id': i
             }
             local_iters = Executor.local_iters % {
                 'local_iters': name_local_iters,
+                'name_exec': Executor.meta['name_exec'],
                 'loop_id': i
             }
             header_code.append(("%s%s" % (local_maps_def, local_iters)).strip('\n'))
@@ -507,6 +563,19 @@ nIters[%(loop_id)d] += tileLoopSize;
 
         return (header_code, gtl_maps, end_code)
 
+    def _map_handles(self, loops):
+        """Return the code resolving, once per loop chain execution, the handles
+        to the local maps used in the tiles."""
+        handles = []
+        for i, loop in enumerate(loops):
+            global_maps = set(desc[0] for desc in loop[2] if desc[0] != 'DIRECT')
+            handles.extend([Executor.map_handle_def % {
+                'handle': Executor.meta['name_map_handle'] % {'gmap': gmap, 'loop_id': i},
+                'name_exec': Executor.meta['name_exec'],
+                'gmap': gmap,
+                'loop_id': i} for gmap in global_maps])
+        return "".join(handles)
+
     def _debug_init(self, loops):
         init = ""
         if Inspector._globaldata.get('time_mode'):
@@ -576,6 +645,16 @@ class SlopeError(Exception):
 
 # Utility functions
 
+def _index_ptr(values):
+    """Return a pointer to the numpy array ``values``, whose entries must be of
+    the same size as SLOPE's ``index_t`` (see ``c_index_t``)."""
+    if values.itemsize != ctypes.sizeof(c_index_t):
+        raise SlopeError("Expected %d-byte indices, got %d-byte ones (is SLOPE_LONG_INDICES "
+                         "set as when SLOPE was built?)" % (ctypes.sizeof(c_index_t),
+                                                            values.itemsize))
+    return values.ctypes.data_as(ctypes.POINTER(c_index_t))
+
+
 def _fix_c(var):
     """Make string ``var`` a valid C literal by removing invalid characters."""
     if not var:
@@ -591,8 +670,10 @@ def get_compile_opts(compiler='gnu'):
     """Return a list of options that are expected to be used when compiling the
     inspector/executor code. Supported compilers: [gnu (default), intel]."""
     functional_opts = ['-std=c++11']
+    if long_indices:
+        functional_opts.append('-DSLOPE_LONG_INDICES')
     debug_opts = []
-    if Inspector._globaldata.get('coordinates'):
+    if Inspector._globaldata.get('debug_mode') and Inspector._globaldata.get('coordinates'):
         debug_opts = ['-DSLOPE_VTK']
     optimization_opts = ['-O3']
     optimization_opts.append('-fopenmp')
@@ -639,10 +720,22 @@ def set_debug_mode(mode, coordinates=None):
     Inspector._globaldata['debug_mode'] = mode
 
     if coordinates:
-        _, _, arity = coordinates
-        if arity not in [1, 2, 3]:
-            raise SlopeError("Arity should be a number in [1, 2, 3]")
-        Inspector._globaldata['coordinates'] = coordinates
+        set_coordinates(coordinates)
+
+
+def set_coordinates(coordinates):
+    """Add a coordinates field, used by the geometric partitioning modes
+    (``hilbert``, ``morton``, ``rcb``) and, in debug mode, to generate VTK files.
+
+    :param coordinates: a 3-tuple, in which the first entry is the set name the
+        coordinates belong to, which should be the target set of the mesh maps;
+        the second entry is a numpy array of coordinates values; the third entry
+        indicates the dimension of the dataset (accepted [1, 2, 3])
+    """
+    _, _, arity = coordinates
+    if arity not in [1, 2, 3]:
+        raise SlopeError("Arity should be a number in [1, 2, 3]")
+    Inspector._globaldata['coordinates'] = coordinates
 
 
 def set_time_mode(mode):
@@ -0,0 +1,96 @@
+/*
+ *  async.h
+ *
+ * Run the inspection in the background, while the application executes its
+ * loops untiled, and switch to the executor once the tiles are ready
+ */
+
+#ifndef _ASYNC_H_
+#define _ASYNC_H_
+
+#include <string>
+
+#include <pthread.h>
+
+#include "inspector.h"
+
+/*
+ * A handle to an inspection running in the background
+ */
+typedef struct {
+  /* the thread running the inspection; if it could not be spawned, the
+     inspection is run by /insp_run_async/ itself */
+  pthread_t thread;
+  bool spawned;
+  /* protects /done/ */
+  pthread_mutex_t lock;
+  /* the arguments of the inspection */
+  inspector_t* insp;
+  int suggestedSeed;
+  int nThreads;
+  std::string fileName;
+  /* true once the inspection has completed */
+  bool done;
+  /* the outcome of the inspection, valid once /done/ */
+  insp_info result;
+  /* the time, in seconds, taken by the inspection, valid once /done/ */
+  double time;
+} insp_async_t;
+
+/*
+ * Start the inspection of /insp/ on a background thread, and return straight
+ * away. Typical usage: ::
+ *
+ *     insp_async_t* handle = insp_run_async (insp, seed);
+ *     while (! insp_ready (handle)) {
+ *       // execute one time step with the original, untiled loops
+ *     }
+ *     insp_wait (handle);
+ *     executor_t* exec = exec_init (insp, EXEC_COLORS);
+ *
+ * Until /insp_wait/ returns, /insp/, the sets and maps of its loops, and any
+ * mesh maps, partitionings or coordinates given to /insp_init/ must not be
+ * modified or freed; they can be read, so the untiled loops can still use the
+ * maps. The tiles are the same as those /insp_run/ would compute, whatever the
+ * number of threads running the inspection.
+ *
+ * @param insp
+ *   the inspector data structure, already initialized with some parloops
+ * @param suggestedSeed
+ *   the seed loop, as in /insp_run/
+ * @param nThreads (optional)
+ *   the number of OpenMP threads running the inspection, so that some cores can
+ *   be left to the untiled loops. 0 means as many threads as OpenMP would use
+ *   by default
+ * @param fileName (optional)
+ *   if not empty, the inspection is first loaded from /fileName/, as with
+ *   /insp_load/; if that fails, /insp_run/ is called and its result stored in
+ *   /fileName/, as with /insp_save/
+ * @return
+ *   a handle to the background inspection
+ */
+insp_async_t* insp_run_async (inspector_t* insp,
+                              int suggestedSeed,
+                              int nThreads = 0,
+                              std::string fileName = "");
+
+/*
+ * Check, without blocking, whether a background inspection has completed
+ */
+bool insp_ready (insp_async_t* handle);
+
+/*
+ * Wait for a background inspection to complete, and free /handle/. The
+ * inspector can then be used as after /insp_run/ (e.g., by /exec_init/)
+ *
+ * @param handle
+ *   the handle returned by /insp_run_async/
+ * @param time (optional)
+ *   if not NULL, the time, in seconds, taken by the inspection
+ * @return
+ *   the outcome of /insp_run/, or INSP_OK if the inspection was loaded from file
+ */
+insp_info insp_wait (insp_async_t* handle,
+                     double* time = NULL);
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ *  cache.h
+ *
+ * Persist the result of an inspection to disk, such that later runs over the
+ * same loop chain and the same mesh can skip /insp_run/ altogether
+ */
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <string>
+
+#include <stdint.h>
+
+#include "inspector.h"
+
+/*
+ * Compute a fingerprint of an inspection problem. Two inspectors with the same
+ * fingerprint are guaranteed (modulo hash collisions) to produce the same tiling.
+ *
+ * The fingerprint covers: the loop chain (loop names, iteration sets, access
+ * descriptors), the content of all maps, the mesh maps, set partitionings and
+ * node coordinates provided to /insp_init/, the tile size, the tiling strategy,
+ * the coloring and partitioning modes, the prefetch halo, the /ignoreWAR/ flag,
+ * the number of threads, and the suggested seed loop.
+ *
+ * @param insp
+ *   the inspector data structure, already initialized with some parloops
+ * @param suggestedSeed
+ *   the seed loop that would be passed to /insp_run/
+ */
+uint64_t cache_fingerprint (inspector_t* insp,
+                            int suggestedSeed);
+
+/*
+ * Write the result of an inspection (seed partitioning and coloring, tiles,
+ * iterations lists and local maps) to a compact binary file.
+ *
+ * @param insp
+ *   the inspector data structure, on which /insp_run/ has already been called
+ * @param suggestedSeed
+ *   the seed loop that was passed to /insp_run/
+ * @param fileName
+ *   the file in which the inspection is stored; overwritten if already present
+ * @return
+ *   INSP_OK if the file was written, INSP_ERR otherwise
+ */
+insp_info insp_save (inspector_t* insp,
+                     int suggestedSeed,
+                     std::string fileName);
+
+/*
+ * Load the result of an inspection previously stored through /insp_save/. The
+ * file is memory-mapped and its fingerprint compared with that of /insp/. On a
+ * match, /insp/ is populated as if /insp_run/ had been called, so /exec_init/
+ * can be called straight away; the results of a previous inspection, if any,
+ * are discarded. Typical usage: ::
+ *
+ *     if (insp_load (insp, seed, fileName) != INSP_OK) {
+ *       insp_run (insp, seed);
+ *       insp_save (insp, seed, fileName);
+ *     }
+ *
+ * @param insp
+ *   the inspector data structure, already initialized with some parloops
+ * @param suggestedSeed
+ *   the seed loop that would be passed to /insp_run/
+ * @param fileName
+ *   the file in which the inspection was stored
+ * @return
+ *   INSP_OK if the inspection was loaded; INSP_ERR if the file is missing,
+ *   corrupted, or refers to a different inspection problem (in which case
+ *   /insp/ is left untouched)
+ */
+insp_info insp_load (inspector_t* insp,
+                     int suggestedSeed,
+                     std::string fileName);
+
+#endif
@@ -41,12 +41,29 @@ void color_rand (inspector_t* insp);
 void color_fully_parallel (inspector_t* insp);
 
 /*
- * Assign colors to tiles such that two adjacent tiles are not assigned the same color.
+ * Compute the tile adjacency graph: two tiles are adjacent if their seed loop
+ * iterations are mapped by /seedMap/ to at least one common element. The graph
+ * only depends on the seed loop partitioning, so it can be reused by all of
+ * the tiling sweeps.
  *
  * @param insp
  *   the inspector data structure
  * @param seedMap
  *   a map used in the indirect seed loop to determine adjacent tiles
+ * @return
+ *   an irregular map from tiles to their adjacent tiles
+ */
+map_t* color_tile_graph (inspector_t* insp,
+                         map_t* seedMap);
+
+/*
+ * Assign colors to tiles such that two adjacent tiles are not assigned the same color.
+ * Tiles are colored in parallel; the coloring does not depend on the number of threads.
+ *
+ * @param insp
+ *   the inspector data structure
+ * @param tileGraph
+ *   the tile adjacency graph, as computed by /color_tile_graph/
  * @param conflictsTracker
  *   track tiles that despite not being adjacent should not be assigned the same color
  * @param onlyCore
@@ -56,8 +73,32 @@ void color_fully_parallel (inspector_t* insp);
  *   build up the /iter2color/ field in /insp/
  */
 void color_diff_adj (inspector_t* insp,
-                     map_t* seedMap,
+                     map_t* tileGraph,
                      tracker_t* conflictsTracker,
                      bool onlyCore = false);
 
+/*
+ * Repair a coloring in which some tiles have the same color as tiles they are in
+ * conflict with. Each such tile, unless a tile it is in conflict with came first
+ * and has already been recolored, takes the smallest color not used by any of
+ * its adjacent or conflicting tiles. All other tiles keep their color.
+ *
+ * @param insp
+ *   the inspector data structure
+ * @param tileGraph
+ *   the tile adjacency graph, as computed by /color_tile_graph/
+ * @param conflictsTracker
+ *   track tiles that despite not being adjacent should not be assigned the same color
+ * @param recolored
+ *   filled with the seed loop iterations whose color changed
+ * @return
+ *   true if the coloring has been repaired; false, leaving the coloring
+ *   untouched, if a halo tile should be recolored, or if a core tile should take
+ *   a color not smaller than those of the halo tiles
+ */
+bool color_repair (inspector_t* insp,
+                   map_t* tileGraph,
+                   tracker_t* conflictsTracker,
+                   std::vector<index_t>& recolored);
+
 #endif
@@ -20,15 +20,20 @@
 enum am_t {READ, WRITE, RW, INC};
 
 /*
- * Represent an access descriptor, which includes two fields:
+ * Represent an access descriptor, which includes three fields:
  * - a map from the iteration set of a parloop to a target set
  * - the access mode to the target set (READ, WRITE, RW, INC)
+ * - optionally, the size of the data accessed for each element of the target set
  */
 typedef struct {
   /* map used to access a certain set */
   map_t* map;
   /* access mode */
   am_t mode;
+  /* bytes of data per element of the target set, or 0 if unknown. Descriptors
+     with same target set and same number of bytes are assumed to access the
+     same data */
+  int bytes;
 } descriptor_t;
 
 typedef std::set<descriptor_t*> desc_list;
@@ -37,11 +42,13 @@ typedef std::set<descriptor_t*> desc_list;
  * Initialize an access descriptor
  */
 inline descriptor_t* desc (map_t* map,
-                           am_t mode)
+                           am_t mode,
+                           int bytes = 0)
 {
   descriptor_t* desc = new descriptor_t;
   desc->map = map;
   desc->mode = mode;
+  desc->bytes = bytes;
   return desc;
 }
 
@@ -10,25 +10,92 @@
 #include "inspector.h"
 #include "utils.h"
 
+/*
+ * Execution modes:
+ * - EXEC_COLORS: tiles are executed color by color, with a barrier between
+ *   two consecutive colors
+ * - EXEC_DAG: a tile is executed as soon as all of the adjacent tiles with
+ *   smaller color have been executed; idle threads steal ready tiles from
+ *   the other threads
+ */
+enum exec_mode {EXEC_COLORS, EXEC_DAG};
+
+/*
+ * The executor plan of a loop: the iterations and the local maps of all tiles,
+ * stored contiguously in execution order, that is by color and then by tile.
+ * The /p/-th tile in execution order owns iterations[offsets[p]], ...,
+ * iterations[offsets[p + 1] - 1], where offsets are /localMaps->offsets/
+ */
+typedef struct {
+  /* iterations of all tiles */
+  index_t* iterations;
+  /* local maps of all tiles, plus the offsets of each tile */
+  local_maps_t* localMaps;
+} exec_plan_t;
+
 /*
  * The executor main data structure.
  */
 typedef struct {
-  /* list of tiles */
+  /* list of tiles, NULL if already freed through /exec_free_tiles/ */
   tile_list* tiles;
   /* map from colors to tiles */
   map_t* color2tile;
 
+  /* number of loops crossed by a tile */
+  int nLoops;
+  /* number of extra iterations in a tile, useful for SW prefetching */
+  int prefetchHalo;
+  /* region of each tile, in execution order */
+  tile_region* regions;
+  /* the executor plan of each loop */
+  exec_plan_t* plans;
+
+  /* how tiles are executed by /exec_run/ */
+  exec_mode mode;
+  /* in EXEC_DAG mode, a map from each tile to the tiles depending on it, and the
+   * number of tiles each tile depends on (tiles are in execution order) */
+  map_t* tileDag;
+  int* nPredecessors;
+
 } executor_t;
 
+/*
+ * A function executing a tile, which is given by its color and its position
+ * among the tiles with that color. /args/ is passed through by /exec_run/
+ */
+typedef void (*tile_kernel) (executor_t* exec,
+                             int color,
+                             int ithTile,
+                             void* args);
+
 
 /*
- * Initialize a new executor
+ * Initialize a new executor. The executor takes over the tiles of /insp/, which
+ * are then freed by /exec_free_tiles/ or /exec_free/
  *
  * @param insp
  *   the inspector from which the executor is built
+ * @param mode
+ *   how tiles are executed by /exec_run/ (EXEC_COLORS, EXEC_DAG)
  */
-executor_t* exec_init (inspector_t* insp);
+executor_t* exec_init (inspector_t* insp,
+                       exec_mode mode = EXEC_COLORS);
+
+/*
+ * Execute all tiles, in an order that depends on the executor mode
+ *
+ * @param exec
+ *   the executor data structure
+ * @param kernel
+ *   the function executing a tile; in EXEC_DAG mode, this may be called
+ *   concurrently for tiles of different colors
+ * @param args
+ *   user data passed to /kernel/
+ */
+void exec_run (executor_t* exec,
+               tile_kernel kernel,
+               void* args);
 
 /*
  * Return the number of colors computed
@@ -67,6 +134,121 @@ tile_t* exec_tile_at (executor_t* exec,
                       int ithTile,
                       tile_region region = LOCAL);
 
+/*
+ * Return a handle to a local map, to be used with /exec_local_map/. This is
+ * meant to be called once per loop and map, outside of the time-stepping loop
+ *
+ * @param exec
+ *   the executor data structure
+ * @param loopIndex
+ *   the index of a loop crossed by the tiles
+ * @param mapName
+ *   the name of the global map whose local map is retrieved
+ * @return
+ *   a handle to the local map, or -1 if the loop does not access such map
+ */
+int exec_map_handle (executor_t* exec,
+                     int loopIndex,
+                     std::string mapName);
+
+/*
+ * Return the position in execution order of the i-th tile with given color
+ */
+inline int exec_tile_pos (executor_t* exec,
+                          int color,
+                          int ithTile)
+{
+  return exec->color2tile->offsets[color] + ithTile;
+}
+
+/*
+ * Return the region of the i-th tile with given color
+ */
+inline tile_region exec_tile_region (executor_t* exec,
+                                     int color,
+                                     int ithTile)
+{
+  return exec->regions[exec_tile_pos (exec, color, ithTile)];
+}
+
+/*
+ * Return the iterations that the i-th tile with given color executes in a loop
+ */
+inline index_t* exec_iterations (executor_t* exec,
+                                 int color,
+                                 int ithTile,
+                                 int loopIndex)
+{
+  exec_plan_t* plan = exec->plans + loopIndex;
+  return plan->iterations + plan->localMaps->offsets[exec_tile_pos (exec, color, ithTile)];
+}
+
+/*
+ * Return the number of iterations that the i-th tile with given color executes
+ * in a loop (extra iterations for SW prefetching excluded)
+ */
+inline int exec_loop_size (executor_t* exec,
+                           int color,
+                           int ithTile,
+                           int loopIndex)
+{
+  index_t* offsets = exec->plans[loopIndex].localMaps->offsets;
+  int pos = exec_tile_pos (exec, color, ithTile);
+  return offsets[pos + 1] - offsets[pos] - exec->prefetchHalo;
+}
+
+/*
+ * Return the local map of the i-th tile with given color in a loop
+ *
+ * @param mapHandle
+ *   the handle returned by /exec_map_handle/
+ */
+inline index_t* exec_local_map (executor_t* exec,
+                                int color,
+                                int ithTile,
+                                int loopIndex,
+                                int mapHandle)
+{
+  local_maps_t* localMaps = exec->plans[loopIndex].localMaps;
+  int pos = exec_tile_pos (exec, color, ithTile);
+  return localMaps->values[mapHandle] + local_map_start (localMaps, mapHandle, pos);
+}
+
+/*
+ * Return the offsets of a local map of an irregular global map, or NULL if the
+ * global map is not irregular: the elements touched by the e-th iteration of the
+ * i-th tile with given color are those in positions from offsets[e] - offsets[0]
+ * to offsets[e + 1] - offsets[0] (excluded) in the local map returned by
+ * /exec_local_map/
+ *
+ * @param mapHandle
+ *   the handle returned by /exec_map_handle/
+ */
+inline index_t* exec_local_offsets (executor_t* exec,
+                                    int color,
+                                    int ithTile,
+                                    int loopIndex,
+                                    int mapHandle)
+{
+  local_maps_t* localMaps = exec->plans[loopIndex].localMaps;
+  index_t* mapOffsets = localMaps->mapOffsets[mapHandle];
+  return mapOffsets ? mapOffsets + localMaps->offsets[exec_tile_pos (exec, color, ithTile)] : NULL;
+}
+
+/*
+ * Return the executor plan of a loop, which gives access to the iterations and
+ * local maps of all tiles as contiguous arrays (e.g., to copy them in bulk to
+ * an accelerator). The plan is owned by the executor
+ */
+exec_plan_t* exec_plan (executor_t* exec,
+                        int loopIndex);
+
+/*
+ * Free the tiles, which are not needed for execution once the executor plans
+ * are built. After this call, /exec_tile_at/ cannot be used anymore
+ */
+void exec_free_tiles (executor_t* exec);
+
 /*
  * Destroy an executor
  */
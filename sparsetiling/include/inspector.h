@@ -9,11 +9,15 @@
 
 #include "parloop.h"
 #include "tile.h"
+#include "stats.h"
 
 enum insp_strategy {SEQUENTIAL, OMP, ONLY_MPI, OMP_MPI};
-enum insp_coloring {COL_DEFAULT, COL_RAND, COL_MINCOLS};
+enum insp_coloring {COL_DEFAULT, COL_RAND, COL_MINCOLS, COL_BALANCED};
 enum insp_info {INSP_OK, INSP_ERR};
 enum insp_verbose {MINIMAL = 1, VERY_LOW = 5, LOW = 20, MEDIUM = 40, HIGH};
+enum insp_partitioning {PART_DEFAULT, PART_HILBERT, PART_MORTON, PART_RCB, PART_BFS};
+enum dimension {DIM1 = 1, DIM2 = 2, DIM3 = 3};
+enum insp_seed {SEED_AUTO = -1};
 
 /*
  * The inspector main data structure.
@@ -25,6 +29,13 @@ typedef struct {
   insp_strategy strategy;
   /* the seed loop index */
   int seed;
+  /* true if the seed loop was selected automatically, in which case the tile
+     growth, forward and backward, and the conflicts per tile that a trial
+     tiling sweep predicted for it are also available */
+  bool autoSeed;
+  double predictedGrowthFwd;
+  double predictedGrowthBwd;
+  double predictedConflicts;
   /* seed loop partitioning */
   map_t* iter2tile;
   /* seed loop coloring */
@@ -39,15 +50,34 @@ typedef struct {
   set_t* tileRegions;
   /* number of tiling sweeps */
   int nSweeps;
+  /* number of conflicts between tiles found while tiling, in both directions */
+  int nConflicts;
+  /* should conflicts be repaired by recoloring only the tiles concerned, rather
+     than by a new tiling sweep ? */
+  bool repairConflicts;
+  /* number of conflict repairs, loop iterations they tiled again, and time spent */
+  int nRepairs;
+  long nRetiled;
+  double repairTime;
   /* partitioning mode */
   std::string partitioningMode;
 
   /* how tiles are going to be colored */
   insp_coloring coloring;
+  /* maximum number of colors, or 0 if unbounded */
+  int maxColors;
   /* the mesh structure, as a list of maps to nodes */
   map_list* meshMaps;
   /* available set partitionings, may be used for deriving tiles */
   map_list* partitionings;
+  /* how the seed loop is partitioned if no set partitioning is available */
+  insp_partitioning partitioning;
+  /* coordinates of the mesh nodes (i.e., the target set of /meshMaps/) */
+  double* coordinates;
+  dimension meshDim;
+
+  /* inverse maps, computed once and shared by all loops and tiling sweeps */
+  inverse_maps* inverseMaps;
 
   /* number of extra iterations in a tile, useful for SW prefetching */
   int prefetchHalo;
@@ -58,6 +88,9 @@ typedef struct {
   /* the following fields track the time spent in various code sections*/
   double totalInspectionTime;
   double partitioningTime;
+  /* finer-grained statistics of the last inspection: time spent in each phase
+     and loop, tiling sweeps, and memory used (see /insp_print_stats/) */
+  insp_stats_t* stats;
 
   /* additional global information */
   int nThreads;
@@ -79,7 +112,9 @@ typedef struct {
  *   some strategies can be altered, particularly that of SEQUENTIAL and ONLY_MPI.
  *   Accepted values are COL_DEFAULT, COL_RAND (random coloring), COL_MINCOLS
  *   (try to minimize the number of colors such that adjacent tiles have different
- *   colors)
+ *   colors), COL_BALANCED (as COL_MINCOLS, but then tiles are moved across colors
+ *   to even out the number of tiles per color, aiming at no fewer tiles per color
+ *   than threads)
  * @param meshMaps (optional)
  *   a high level description of the mesh through a list of maps to nodes. This
  *   can optionally be used to partition an iteration space using an external
@@ -95,6 +130,37 @@ typedef struct {
  * @param name (optional)
  *   a unique name that identifies the inspector. Only useful if more than
  *   one inspectors are needed
+ * @param partitioning (optional)
+ *   how the seed loop is partitioned if none of /partitionings/ applies to it.
+ *   PART_DEFAULT uses METIS, if available, or contiguous chunks of iterations.
+ *   PART_HILBERT and PART_MORTON sort the seed loop iterations along a Hilbert
+ *   or Morton space-filling curve, and then cut them into chunks of /tileSize/
+ *   iterations. PART_RCB applies recursive coordinate bisection. These three
+ *   require /meshMaps/ and /coordinates/. PART_BFS grows tiles by breadth-first
+ *   search over the seed loop iterations, using only the topology of the map
+ *   read by the seed loop
+ * @param coordinates (optional)
+ *   coordinates of the mesh nodes, that is the target set of /meshMaps/, as an
+ *   array of /meshDim/ values per node. The coordinates of an iteration of the
+ *   seed loop are the centroid of the nodes it is mapped to
+ * @param meshDim (optional)
+ *   number of coordinates per node
+ * @param maxColors (optional)
+ *   maximum number of colors, 0 meaning no limit. It applies whenever tiles are
+ *   colored based on their adjacency (i.e., the OMP strategies, COL_MINCOLS and
+ *   COL_BALANCED). If tiling ends up with more colors, the tiles of the colors
+ *   beyond the cap and their adjacent tiles are merged in pairs, and the loop
+ *   chain is tiled again, at most 8 times; if the cap is still not met,
+ *   /insp_run/ returns INSP_ERR. Otherwise, if a color has fewer tiles than
+ *   threads, its tiles are split in two halves and the loop chain is tiled
+ *   again, as long as no merging was needed
+ * @param repairConflicts (optional)
+ *   if true, when tiling finds conflicts between tiles, only the tiles in
+ *   conflict are recolored and only the loop iterations whose tile or color may
+ *   change as a result are tiled again. Otherwise, the seed loop is recolored
+ *   from scratch and the whole loop chain is tiled again. A new tiling sweep is
+ *   still needed if a repair would change the colors of the halo tiles. Off
+ *   by default
  * @return
  *   an empty inspector
  */
@@ -105,7 +171,12 @@ inspector_t* insp_init (int tileSize,
                         map_list* partitionings = NULL,
                         int prefetchHalo = 1,
                         bool ignoreWAR = false,
-                        std::string name = "");
+                        std::string name = "",
+                        insp_partitioning partitioning = PART_DEFAULT,
+                        double* coordinates = NULL,
+                        dimension meshDim = DIM2,
+                        int maxColors = 0,
+                        bool repairConflicts = false);
 
 /*
  * Add a parloop to the inspector
@@ -135,13 +206,32 @@ insp_info insp_add_parloop (inspector_t* insp,
  * @param suggestedSeed
  *   the ID of a loop from which tiling should be derived (i.e., a number between
  *   0 and the number of parloops in the inspector). This parameters may be
- *   ignored depending on the tiling strategy
+ *   ignored depending on the tiling strategy. If SEED_AUTO, the seed loop is
+ *   selected by running a trial tiling sweep, over the few loops around each
+ *   candidate seed loop, and picking the one whose tiles conflict the least
  * @return
- *   populates the tiles in the inspector
+ *   populates the tiles in the inspector. The results of a previous inspection
+ *   (tiles, tiling and coloring of the seed loop, statistics) are discarded.
+ *   INSP_ERR if the tiles, though legal, have more colors than /maxColors/
  */
 insp_info insp_run (inspector_t* insp,
                     int suggestedSeed);
 
+/*
+ * Build the graph of dependencies among tiles, as a DAG oriented by color:
+ * there is a path from tile /a/ to tile /b/ if the two tiles touch a common
+ * element, in any loop and in any set, and /a/ has a smaller color than /b/.
+ * Only the edges between tiles with consecutive colors, among those touching
+ * an element, are stored. Executing a tile once all of its predecessors have
+ * been executed is then equivalent to executing tiles color by color
+ *
+ * @param insp
+ *   the inspector data structure, on which /insp_run/ has already been called
+ * @return
+ *   a map from each tile to its successors in the DAG
+ */
+map_t* insp_tile_dag (inspector_t* insp);
+
 /*
  * Print a summary of the inspector
  *
@@ -156,6 +246,33 @@ void insp_print (inspector_t* insp,
                  insp_verbose level,
                  int loopIndex = -1);
 
+/*
+ * Measure the quality of the tiling computed by the last inspection (see
+ * /stats_quality/), and store it in /insp->stats/. This is not done by
+ * /insp_run/, since it touches every local map of every tile
+ *
+ * @param insp
+ *   the inspector data structure, on which /insp_run/ or /insp_load/ has
+ *   already been called
+ */
+void insp_measure_quality (inspector_t* insp);
+
+/*
+ * Write the statistics of the last inspection (see /insp_stats_t/) as a JSON
+ * object. The same statistics can be read from /insp->stats/. The quality of the
+ * tiling is only included if /insp_measure_quality/ has been called
+ *
+ * @param insp
+ *   the inspector data structure, on which /insp_run/ has already been called
+ * @param fileName (optional)
+ *   the file in which the statistics are written, overwritten if already
+ *   present; if empty, the statistics are written to the standard output
+ * @return
+ *   INSP_OK if the statistics were written, INSP_ERR otherwise
+ */
+insp_info insp_print_stats (inspector_t* insp,
+                            std::string fileName = "");
+
 /*
  * Destroy an inspector
  */
@@ -7,6 +7,7 @@
 #define _MAP_H_
 
 #include <set>
+#include <unordered_map>
 
 #include "set.h"
 
@@ -21,19 +22,22 @@ typedef struct {
   /* output iteration set */
   set_t* outSet;
   /* indirect map from input to output iteration sets */
-  int* values;
+  index_t* values;
   /* size of /values/ (== offsets[inSet->size] if an irregular map) */
-  int size;
+  index_t size;
   /* offsets in /values/ when two elements in the input iteration set can have
    * a different number of output iteration set elements. For example, this is
    * the case of a map from vertices to edges in an unstructured mesh. This value
    * is different than NULL only if the map is irregular. The size of this array
    * is inSet->size + 1.*/
-  int* offsets;
+  index_t* offsets;
 } map_t;
 
 typedef std::set<map_t*> map_list;
 
+/* A collection of inverse maps, indexed by the map they are the inverse of */
+typedef std::unordered_map<map_t*, map_t*> inverse_maps;
+
 /*
  * Identify direct maps
  */
@@ -45,8 +49,8 @@ typedef std::set<map_t*> map_list;
 map_t* map (std::string name,
             set_t* inSet,
             set_t* outSet,
-            int* values,
-            int size);
+            index_t* values,
+            index_t size);
 
 /*
  * Return a fresh copy of /map/
@@ -62,8 +66,8 @@ map_t* map_cpy (std::string name,
 map_t* imap (std::string name,
              set_t* inSet,
              set_t* outSet,
-             int* values,
-             int* offsets);
+             index_t* values,
+             index_t* offsets);
 
 /*
  * Destroy a map
@@ -78,21 +82,82 @@ void map_free (map_t* map,
  *   update /offset/ and /size/
  */
 void map_ofs (map_t* map,
-              int element,
-              int* offset,
+              index_t element,
+              index_t* offset,
               int* size);
 
 /*
- * Invert a fixed-arity mapping from a set X to a set Y. This function CANNOT be
- * used for inverting irregular maps.
+ * Invert a mapping from a set X to a set Y. The mapping can have any arity, or be
+ * irregular. Entries set to -1 (i.e., off-processor elements) are ignored.
+ *
+ * The inversion runs in parallel, if compiled with SLOPE_OMP, and the output
+ * does not depend on the number of threads: the x elements related to a same y
+ * element appear in increasing order.
  *
  * @param x2y
  *   a mapping from a set x to a set y
+ * @param maxIncidence
+ *   if not NULL, set to the maximum incidence degree on a y element
  * @return
- *   a mapping from set y to set x. Also update /maxIncidence/, which tells the
- *   maximum incidence degree on a y element
+ *   a mapping from set y to set x
  */
 map_t* map_invert (map_t* x2y,
                    int* maxIncidence);
 
+/*
+ * Build the line graph of the first /nElements/ elements of the input set of
+ * /map/: two elements are adjacent if /map/ relates them to at least one common
+ * element of the output set. /map/ can have any arity, or be irregular.
+ *
+ * @param map
+ *   a mapping from a set x to a set y
+ * @param nElements
+ *   only the elements of x in [0, nElements) are considered
+ * @param offsets
+ *   the position of the neighbours of each element in /adjncy/ (nElements + 1)
+ * @param adjncy
+ *   the neighbours of each element, sorted, without self loops and duplicates
+ */
+void map_line_graph (map_t* map,
+                     index_t nElements,
+                     index_t** offsets,
+                     index_t** adjncy);
+
+/*
+ * Initialize an empty collection of inverse maps
+ */
+inverse_maps* inverse_maps_init();
+
+/*
+ * Retrieve the inverse of a map. The inverse is computed through
+ * /map_invert/ only the first time it is requested, and then kept in /cache/
+ * for later requests.
+ *
+ * @param x2y
+ *   a mapping from a set x to a set y; it must not be freed, or its values
+ *   changed, as long as /cache/ is in use
+ * @param cache
+ *   the collection of inverse maps computed so far
+ * @param maxIncidence
+ *   if not NULL, set to the maximum incidence degree on a y element
+ * @return
+ *   a mapping from set y to set x. The caller does not own this map, which is
+ *   freed along with /cache/
+ */
+map_t* map_invert_cached (map_t* x2y,
+                          inverse_maps* cache,
+                          int* maxIncidence = NULL);
+
+/*
+ * Remove from /cache/, and destroy, the inverse of /x2y/, if any. This must be
+ * called before /x2y/ is freed, or its values changed
+ */
+void inverse_maps_erase (inverse_maps* cache,
+                         map_t* x2y);
+
+/*
+ * Destroy a collection of inverse maps, including all of the inverse maps in it
+ */
+void inverse_maps_free (inverse_maps* cache);
+
 #endif
@@ -19,8 +19,102 @@
  */
 void partition (inspector_t* insp);
 
+/*
+ * Partition the seed loop as in /indMap/, e.g. a partitioning computed by
+ * /partition/ for the same seed loop and a different loop chain.
+ *
+ * @param insp
+ *   the inspector data structure
+ * @param indMap
+ *   the partitioning, which the inspector takes ownership of
+ * @param nCore
+ *   the number of core tiles in /indMap/
+ * @param nExec
+ *   the number of exec halo tiles in /indMap/
+ * @param nNonExec
+ *   the number of non exec halo tiles in /indMap/
+ * @return
+ *   build up the /tiles/ and /iter2tile/ fields in /insp/; a previous
+ *   partitioning is freed
+ */
+void partition_from (inspector_t* insp,
+                     index_t* indMap,
+                     int nCore,
+                     int nExec,
+                     int nNonExec);
+
+/*
+ * Coarsen the partitioning of the seed loop by merging pairs of adjacent core
+ * tiles. Each core tile to be merged is merged with its smallest adjacent core
+ * tile that has not been merged yet, if any.
+ *
+ * @param insp
+ *   the inspector data structure, with the seed loop already partitioned
+ * @param tileGraph
+ *   the tile adjacency graph, as computed by /color_tile_graph/
+ * @param merge
+ *   for each core tile, true if the tile has to be merged
+ * @return
+ *   rebuild the /tiles/ and /iter2tile/ fields in /insp/; /iter2color/ is freed
+ */
+void partition_merge (inspector_t* insp,
+                      map_t* tileGraph,
+                      bool* merge);
+
+/*
+ * Refine the partitioning of the seed loop by splitting core tiles in two halves.
+ *
+ * @param insp
+ *   the inspector data structure, with the seed loop already partitioned
+ * @param split
+ *   for each core tile, true if the tile has to be split
+ * @return
+ *   rebuild the /tiles/ and /iter2tile/ fields in /insp/; /iter2color/ is freed
+ */
+void partition_split (inspector_t* insp,
+                      bool* split);
+
+/*
+ * Replace the partitioning of the seed loop.
+ *
+ * @param insp
+ *   the inspector data structure, with the seed loop already partitioned
+ * @param indMap
+ *   the new partitioning, which the inspector takes ownership of. The halo
+ *   tiles must be the same as in the current partitioning
+ * @param nCore
+ *   the number of core tiles in /indMap/
+ * @return
+ *   rebuild the /tiles/ and /iter2tile/ fields in /insp/; /iter2color/ is freed
+ */
+void partition_replace (inspector_t* insp,
+                        index_t* indMap,
+                        int nCore);
+
+/*
+ * Free the partitioning of the seed loop, i.e. the /tiles/, /tileRegions/,
+ * /iter2tile/ and /iter2color/ fields in /insp/, which are set to NULL. The
+ * /tiles/ field may already be NULL if the tiles were freed by an executor.
+ *
+ * @param insp
+ *   the inspector data structure, with the seed loop already partitioned
+ */
+void partition_free (inspector_t* insp);
+
 #ifdef SLOPE_METIS
-void get_adjncy_and_offsets(map_t* map, int** adjncy, int** offsets);
+/*
+ * Build, in CSR format, the line graph of /map/: two elements of the input set
+ * of /map/ are adjacent if they share an element of the output set. /map/ can
+ * have any arity, or be irregular (i.e., have /offsets/).
+ *
+ * @param map
+ *   a map whose input set is partitioned by METIS
+ * @param adjncy
+ *   the neighbours of each element, sorted and with no duplicates
+ * @param offsets
+ *   the position of each element's neighbours in /adjncy/
+ */
+void get_adjncy_and_offsets(map_t* map, index_t** adjncy, index_t** offsets);
 #endif
 
 #endif
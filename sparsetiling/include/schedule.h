@@ -1,5 +1,5 @@
 /*
- *  tiling.h
+ *  schedule.h
  *
  * Scheduling functions map iteration set elements to a tile and a color
  */
@@ -10,17 +10,58 @@
 #include <set>
 #include <string>
 
+#include <stdint.h>
+
 #include "common.h"
+#include "set.h"
+
+/*
+ * The tile and the color of an iteration, packed in a single word such that
+ * tiling reads both with a single memory access: the color is stored in the
+ * most significant half of the word, the tile in the least significant half.
+ * The word has 64 bits unless SLOPE_NARROW_SCHEDULES is defined, in which case
+ * it has 32 bits, halving the memory taken by the schedules, but tile IDs and
+ * colors must be smaller than TC_MAX, i.e. 2^15 - 1
+ */
+#ifdef SLOPE_NARROW_SCHEDULES
+typedef int32_t tc_t;
+typedef int16_t tc_half_t;
+typedef uint32_t tc_unsigned_t;
+typedef uint16_t tc_unsigned_half_t;
+#else
+typedef int64_t tc_t;
+typedef int32_t tc_half_t;
+typedef uint64_t tc_unsigned_t;
+typedef uint32_t tc_unsigned_half_t;
+#endif
+#define TC_BITS (8*sizeof(tc_half_t))
+// the largest tile ID and color that can be packed, also marking the iterations
+// not tiled yet
+#define TC_MAX ((int)(((tc_unsigned_half_t)-1) >> 1))
+
+inline tc_t tc_pack (int tile, int color)
+{
+  return (tc_t)(((tc_unsigned_t)(tc_unsigned_half_t)color << TC_BITS) |
+                (tc_unsigned_half_t)tile);
+}
+
+inline int tc_tile (tc_t tc)
+{
+  return (int)(tc_half_t)tc;
+}
+
+inline int tc_color (tc_t tc)
+{
+  return (int)(tc >> TC_BITS);
+}
 
 typedef struct {
   /* set name identifier */
   std::string name;
   /* iteration set */
-  int itSetSize;
-  /* tiling of the iteration set tiling */
-  int* iter2tile;
-  /* coloring of the iteration set coloring */
-  int* iter2color;
+  index_t itSetSize;
+  /* tiling and coloring of the iteration set, as packed (color, tile) words */
+  tc_t* iter2tc;
   /* tiling direction */
   direction_t direction;
   /* has the schedule been computed ? */
@@ -31,13 +72,11 @@ typedef struct {
 /*
  * Map iterations to tile IDs and colors.
  *
- * Note: the caller loses ownership of iter2tile and iter2color after calling
- * this function.
+ * Note: the caller loses ownership of iter2tc after calling this function.
  */
 schedule_t* schedule_init (std::string name,
-                           int itSetSize,
-                           int* iter2tile,
-                           int* iter2color,
+                           index_t itSetSize,
+                           tc_t* iter2tc,
                            direction_t direction);
 
 /*
@@ -50,6 +89,19 @@ schedule_t* schedule_cpy (schedule_t* schedule);
  */
 void schedule_free (schedule_t* schedule);
 
+/*
+ * Return the bytes held by /schedule/
+ */
+long schedule_bytes (schedule_t* schedule);
+
+/*
+ * Unpack the tiling and the coloring of /schedule/ into /iter2tile/ and
+ * /iter2color/, two arrays of /schedule->itSetSize/ elements
+ */
+void schedule_unpack (schedule_t* schedule,
+                      int* iter2tile,
+                      int* iter2color);
+
 
 inline bool schedule_cmp (const schedule_t* a,
                           const schedule_t* b)
@@ -69,8 +121,17 @@ typedef std::set<schedule_t*, bool(*)(const schedule_t* a, const schedule_t* b)>
 projection_t* projection_init();
 
 /*
- * Destroy a loop projection
+ * Destroy a loop projection. The schedules also in /keep/, which share memory
+ * with those in /projection/, are not freed
+ */
+void projection_free (projection_t* projection,
+                      projection_t* keep = NULL);
+
+/*
+ * Return the bytes held by the schedules in /projection/ and by those in
+ * /shared/, if not NULL, that are not also in /projection/
  */
-void projection_free (projection_t* projection);
+long projection_bytes (projection_t* projection,
+                       projection_t* shared = NULL);
 
 #endif
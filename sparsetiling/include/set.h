@@ -10,6 +10,19 @@
 
 #include <string>
 
+#include <stdint.h>
+
+/*
+ * The type of the indices of set elements, and of the positions in maps. This is
+ * a 32-bit integer unless SLOPE_LONG_INDICES is defined, in which case sets and
+ * maps can have more than 2^31 elements and entries, respectively
+ */
+#ifdef SLOPE_LONG_INDICES
+typedef int64_t index_t;
+#else
+typedef int index_t;
+#endif
+
 /*
  * Represent a set
  */
@@ -17,13 +30,13 @@ typedef struct {
   /* identifier name of the set */
   std::string name;
   /* size of the local set not touching halo regions */
-  int core;
+  index_t core;
   /* size of the halo region (will be executed over redundantly) */
-  int execHalo;
+  index_t execHalo;
   /* size of the halo region that will only be read */
-  int nonExecHalo;
+  index_t nonExecHalo;
   /* size of the whole iteration space, including halo */
-  int size;
+  index_t size;
   /* am I a subset? If so (!= NULL), what is my superset? */
   void* superset;
 } set_t;
@@ -49,9 +62,9 @@ typedef std::set<set_t*> set_list;
  *    - `nonExecHalo`: read when executing the halo region
  */
 inline set_t* set (std::string name,
-                   int core,
-                   int execHalo = 0,
-                   int nonExecHalo = 0,
+                   index_t core,
+                   index_t execHalo = 0,
+                   index_t nonExecHalo = 0,
                    set_t* superset = NULL)
 {
   set_t* set =  new set_t;
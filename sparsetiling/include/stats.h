@@ -0,0 +1,209 @@
+/*
+ *  stats.h
+ *
+ * Track where the time and the memory go during an inspection
+ */
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <vector>
+#include <string>
+#include <ostream>
+
+#include "parloop.h"
+#include "tile.h"
+
+/*
+ * The phases of an inspection. The time spent tiling, projecting and assigning
+ * iterations to tiles, and computing local maps, is also tracked per loop
+ */
+enum stats_phase {PHASE_SEED_MAPS, PHASE_SEED_SELECTION, PHASE_PARTITIONING,
+                  PHASE_COLORING, PHASE_TILING, PHASE_PROJECTION, PHASE_ASSIGNMENT,
+                  PHASE_REPAIR, PHASE_RESHAPE, PHASE_LOCAL_MAPS, PHASE_FOOTPRINTS,
+                  PHASE_QUALITY, N_PHASES};
+
+/*
+ * The data structures whose memory is tracked: the projections of the tiling
+ * and coloring to the sets touched by the loops, the trackers of conflicts
+ * between tiles, the copies of the schedules kept to repair conflicts, the
+ * tiles (i.e., their iterations), and the local maps
+ */
+enum stats_data {MEM_PROJECTIONS, MEM_TRACKERS, MEM_TRACES, MEM_TILES,
+                 MEM_LOCAL_MAPS, N_MEMORY};
+
+/*
+ * The data touched by the tiles of a loop through a map, or directly
+ */
+typedef struct {
+  /* name of the map, empty for direct accesses, and of the set accessed */
+  std::string map;
+  std::string set;
+  /* number of distinct elements touched by each tile */
+  std::vector<index_t> touched;
+  /* number of elements touched by more than one tile, and number of tiles
+     touching an element, on average over the elements touched */
+  index_t boundary;
+  double redundancy;
+} access_stats_t;
+
+typedef struct {
+  /* name of the loop */
+  std::string name;
+  /* seconds spent in each phase; only the tiling, projection, assignment and
+     local maps phases are tracked per loop */
+  double times[N_PHASES];
+  /* iterations per core tile: fewest, average, most, and standard deviation */
+  int minSize;
+  double meanSize;
+  int maxSize;
+  double stddevSize;
+  /* average and largest number of iterations per core tile, relative to the
+     average number of iterations per core tile of the seed loop */
+  double growth;
+  double maxGrowth;
+  /* the data touched through each map accessed by the loop, and directly */
+  std::vector<access_stats_t> accesses;
+} loop_stats_t;
+
+typedef struct {
+  /* number of tiles with the color, and their iterations across all loops */
+  int nTiles;
+  long nIterations;
+  /* iterations of the largest tile, and ratio to the average over the tiles */
+  long maxIterations;
+  double imbalance;
+} color_stats_t;
+
+typedef struct {
+  /* seconds spent in the tiling sweep, repairs excluded */
+  double time;
+  /* number of colors and of tiles, once the sweep has completed */
+  int nColors;
+  int nTiles;
+  /* number of conflicts found by the sweep */
+  int nConflicts;
+  /* number of conflict repairs following the sweep, loop iterations they tiled
+     again, and seconds they took */
+  int nRepairs;
+  long nRetiled;
+  double repairTime;
+} sweep_stats_t;
+
+typedef struct {
+  /* total size of the data structures built, summed over all of the times
+     they are built again (e.g., by each tiling sweep) */
+  long allocated;
+  /* bytes held at the end of the inspection, and at most */
+  long resident;
+  long peak;
+} memory_stats_t;
+
+/*
+ * Statistics of an inspection. Memory is sampled after each step of the
+ * inspection (e.g., after each projection), so short-lived temporaries are
+ * not accounted for. The trial tiling sweeps run to select the seed loop are
+ * only accounted for in the seed selection phase
+ */
+typedef struct {
+  /* seconds spent in the whole inspection, and in each phase */
+  double totalTime;
+  double times[N_PHASES];
+  /* statistics of each loop, tiling sweep, and tracked data structure */
+  std::vector<loop_stats_t> loops;
+  std::vector<sweep_stats_t> sweeps;
+  memory_stats_t memory[N_MEMORY];
+  /* statistics of each color. When tiles are executed color by color, each
+     color takes as long as its largest tile, or as its iterations divided by
+     the number of threads, whichever is larger: the sum over the colors is the
+     critical path, in iterations, and /efficiency/ is the fraction of it that
+     threads spend executing iterations */
+  std::vector<color_stats_t> colors;
+  long criticalPath;
+  double efficiency;
+} insp_stats_t;
+
+/*
+ * Initialize empty statistics
+ */
+insp_stats_t* stats_init();
+
+/*
+ * Reset /stats/ for a new inspection of /loops/
+ */
+void stats_reset (insp_stats_t* stats,
+                  loop_list* loops);
+
+/*
+ * Add /time/ seconds to /phase/ and, if /loopIndex/ is not -1, to the same
+ * phase of that loop. Like /stats_reset/, /stats_sweep/, /stats_repair/ and
+ * /stats_memory/, it does nothing if /stats/ is NULL
+ */
+void stats_time (insp_stats_t* stats,
+                 stats_phase phase,
+                 double time,
+                 int loopIndex = -1);
+
+/*
+ * Record a new tiling sweep, which took /time/ seconds
+ */
+void stats_sweep (insp_stats_t* stats,
+                  double time,
+                  int nColors,
+                  int nTiles,
+                  int nConflicts);
+
+/*
+ * Record a conflict repair following the last tiling sweep
+ */
+void stats_repair (insp_stats_t* stats,
+                   double time,
+                   long nRetiled);
+
+/*
+ * Record that the data structures of kind /kind/ now hold /resident/ bytes,
+ * /allocated/ of which have just been built
+ */
+void stats_memory (insp_stats_t* stats,
+                   stats_data kind,
+                   long allocated,
+                   long resident);
+
+/*
+ * Measure the quality of a tiling: the iterations of each tile in each loop,
+ * the data touched by each tile, and the balance of the work within each color.
+ * Any measure previously taken is replaced
+ *
+ * @param stats
+ *   the statistics in which the measures are stored
+ * @param loops
+ *   the loops crossed by the tiles
+ * @param tiles
+ *   the tiles, with their iterations and local maps for each loop
+ * @param seed
+ *   the seed loop
+ * @param nCore
+ *   the number of core tiles, which come first in /tiles/
+ * @param nThreads
+ *   the number of threads executing the tiles of a color
+ */
+void stats_quality (insp_stats_t* stats,
+                    loop_list* loops,
+                    tile_list* tiles,
+                    int seed,
+                    int nCore,
+                    int nThreads);
+
+/*
+ * Write /stats/ to /out/ as a JSON object. The number of elements touched by
+ * each tile is summarized by its minimum, average and maximum
+ */
+void stats_json (insp_stats_t* stats,
+                 std::ostream& out);
+
+/*
+ * Destroy statistics
+ */
+void stats_free (insp_stats_t* stats);
+
+#endif
@@ -14,26 +14,53 @@
 #include "descriptor.h"
 #include "parloop.h"
 
-typedef std::vector<int> iterations_list;
-typedef std::unordered_map<std::string, iterations_list*> mapname_iterations;
-typedef std::pair<std::string, iterations_list*> mi_pair;
+typedef std::vector<index_t> iterations_list;
 
 enum tile_region {LOCAL, EXEC_HALO, NON_EXEC_HALO};
 
+/* Local indirection maps of a parloop, shared by all tiles. For each global
+ * (i.e., parloop's) indirection map, the local maps of all tiles are stored one
+ * after the other in a single 64-byte aligned array: the local map of tile /t/
+ * starts at values[m] + offsets[t]*arities[m]. If the global map is irregular,
+ * /arities[m]/ is 0 and the elements of the iterations of all tiles, one after
+ * the other, are delimited by /mapOffsets[m]/, as in an irregular map: the local
+ * map of tile /t/ starts at values[m] + mapOffsets[m][offsets[t]] */
 typedef struct {
+  /* number of tiles */
+  int nTiles;
+  /* number of tiles still referring to the local maps; the last one frees them */
+  int nRefs;
+  /* number of local maps, one per global indirection map */
+  int nMaps;
+  /* names and arities of the global indirection maps */
+  std::string* names;
+  int* arities;
+  /* position of each tile's first iteration, of size nTiles + 1 */
+  index_t* offsets;
+  /* the local maps */
+  index_t** values;
+  /* for each irregular global map, the position in /values[m]/ of the elements
+   * of each iteration, of size offsets[nTiles] + 1; NULL for the other maps */
+  index_t** mapOffsets;
+} local_maps_t;
+
+typedef struct {
+  /* position of the tile in the list of tiles */
+  int ID;
   /* number of parloops crossed by the tile */
   int crossedLoops;
   /* list of iterations owned by the tile, for each parloop */
   iterations_list** iterations;
-  /* local indirection maps; for each loop crossed, there's one local map for each
-   * global (i.e., parloop's) indirection map */
-  mapname_iterations** localMaps;
+  /* local indirection maps, for each loop crossed */
+  local_maps_t** localMaps;
   /* color of the tile */
   int color;
   /* number of extra iterations per loop, useful for SW prefetching */
   int prefetchHalo;
   /* a tile can either be local, exec_halo, or non_exec_halo */
   tile_region region;
+  /* bytes of data touched across all loops crossed, or 0 if unknown */
+  long footprint;
 
 } tile_t;
 
@@ -42,6 +69,8 @@ typedef std::vector<tile_t*> tile_list;
 /*
  * Initialize a tile
  *
+ * @param ID
+ *   the position of the tile in the list of tiles
  * @param crossedLoops
  *   number of loops the tile crosses
  * @param region
@@ -53,10 +82,61 @@ typedef std::vector<tile_t*> tile_list;
  * @return
  *   a new empty tile
  */
-tile_t* tile_init (int crossedLoops,
+tile_t* tile_init (int ID,
+                   int crossedLoops,
                    tile_region region,
                    int prefetchHalo = 1);
 
+/*
+ * Initialize the local indirection maps of a parloop. The values of the local
+ * maps are allocated, but not initialized
+ *
+ * @param nTiles
+ *   number of tiles sharing the local maps
+ * @param names
+ *   names of the global indirection maps
+ * @param arities
+ *   arities of the global indirection maps, or 0 for the irregular ones
+ * @param offsets
+ *   position of each tile's first iteration, of size nTiles + 1; ownership is
+ *   transferred to the local maps
+ * @param mapOffsets
+ *   for each irregular global map, the position of the elements of each
+ *   iteration in the local maps (see /local_maps_t/), and NULL for the others;
+ *   ownership is transferred to the local maps. Can be NULL if no global map is
+ *   irregular
+ * @return
+ *   the local maps of a parloop
+ */
+local_maps_t* local_maps_init (int nTiles,
+                               std::vector<std::string>& names,
+                               std::vector<int>& arities,
+                               index_t* offsets,
+                               std::vector<index_t*>* mapOffsets = NULL);
+
+/*
+ * Return the position in the local map /m/ of the first element of the tile in
+ * position /pos/ (/pos/ == nTiles for the size of the local map)
+ */
+inline index_t local_map_start (local_maps_t* localMaps,
+                                int m,
+                                int pos)
+{
+  index_t* mapOffsets = localMaps->mapOffsets[m];
+  index_t offset = localMaps->offsets[pos];
+  return mapOffsets ? mapOffsets[offset] : offset*localMaps->arities[m];
+}
+
+/*
+ * Free the local indirection maps of a parloop
+ */
+void local_maps_free (local_maps_t* localMaps);
+
+/*
+ * Return the bytes held by the local indirection maps of a parloop
+ */
+long local_maps_bytes (local_maps_t* localMaps);
+
 /*
  * Retrieve a local map given a loop index and a map name
  *
@@ -67,11 +147,31 @@ tile_t* tile_init (int crossedLoops,
  * @param mapName
  *   name of the map to be retrieved
  * @return
- *   a reference to a local map of name mapName
+ *   a pointer to the local map of name mapName, or NULL if no such map exists
  */
-iterations_list& tile_get_local_map (tile_t* tile,
-                                     int loopIndex,
-                                     std::string mapName);
+index_t* tile_get_local_map (tile_t* tile,
+                             int loopIndex,
+                             std::string mapName);
+
+/*
+ * Retrieve the offsets of a local map of an irregular global map: the elements
+ * touched by the e-th iteration of /tile/ are those in positions from
+ * offsets[e] - offsets[0] to offsets[e + 1] - offsets[0] (excluded) in the local
+ * map returned by /tile_get_local_map/
+ *
+ * @param tile
+ *   the tile for which the offsets are retrieved
+ * @param loopIndex
+ *   the index of a loop crossed by tile
+ * @param mapName
+ *   name of the map whose offsets are retrieved
+ * @return
+ *   a pointer to the offsets, of size tile_loop_size (tile, loopIndex) + 1, or
+ *   NULL if no such map exists or it is not irregular
+ */
+index_t* tile_get_local_offsets (tile_t* tile,
+                                 int loopIndex,
+                                 std::string mapName);
 
 /*
  * Retrieve the iterations list for a given loop
@@ -99,6 +199,27 @@ iterations_list& tile_get_iterations (tile_t* tile,
 int tile_loop_size (tile_t* tile,
                     int loopIndex);
 
+/*
+ * Compute the /footprint/ of each tile, i.e. the bytes of data touched by its
+ * iterations across all of the loops crossed. Only the access descriptors with
+ * a known number of bytes (see /desc/) contribute to the footprint
+ *
+ * @param tiles
+ *   the tiles, with their iterations for each loop
+ * @param loops
+ *   the loops crossed by the tiles
+ */
+void tile_footprints (tile_list* tiles,
+                      loop_list* loops);
+
+/*
+ * Return the bytes held by the iterations of /tile/ in loop /loopIndex/, or by
+ * the whole tile if /loopIndex/ is -1. Local maps, which are shared by all
+ * tiles, are not included (see /local_maps_bytes/)
+ */
+long tile_bytes (tile_t* tile,
+                 int loopIndex = -1);
+
 /*
  * Free resources associated with the tile
  */
@@ -8,9 +8,12 @@
 #define _TILING_H_
 
 #include <set>
+#include <vector>
 #include <unordered_map>
 #include <string>
 
+#include <stdint.h>
+
 #include "parloop.h"
 #include "tile.h"
 #include "utils.h"
@@ -30,9 +33,71 @@
  * tile 1 is in conflict with tiles 2 and 3.
  */
 
-/* Tracker: a map from tile IDs to a set of tile IDs */
-typedef std::set<int> index_set;
-typedef std::map<int, index_set> tracker_t;
+/* Tracker: a graph of conflicting tiles. While tiling, conflicts are appended
+ * to /edges/ as (tile, conflicting tile) pairs, possibly duplicated; these are
+ * then compacted into a CSR graph, in which the tiles conflicting with tile i
+ * are adjncy[offsets[i]], ..., adjncy[offsets[i + 1] - 1], in increasing order */
+typedef struct {
+  /* number of tiles */
+  int nTiles;
+  /* conflicts not compacted yet, packed as (tile << 32 | conflicting tile) */
+  std::vector<uint64_t> edges;
+  /* CSR graph of conflicts, of size nTiles + 1 and offsets[nTiles] */
+  std::vector<int> offsets;
+  std::vector<int> adjncy;
+} tracker_t;
+
+/*
+ * Initialize an empty tracker for /nTiles/ tiles
+ */
+tracker_t* tracker_init (int nTiles);
+
+/*
+ * Sort and unique the conflicts appended to /tracker->edges/, and add them to
+ * the CSR graph of conflicts
+ */
+void tracker_compact (tracker_t* tracker);
+
+/*
+ * Add all conflicts in /source/ to /tracker/, which is then compacted
+ */
+void tracker_merge (tracker_t* tracker,
+                    tracker_t* source);
+
+/*
+ * Return /true/ if a compacted tracker has no conflicts, /false/ otherwise
+ */
+inline bool tracker_empty (tracker_t* tracker)
+{
+  return tracker->adjncy.empty();
+}
+
+/*
+ * Destroy a tracker
+ */
+void tracker_free (tracker_t* tracker);
+
+/*
+ * Return the bytes held by a tracker
+ */
+long tracker_bytes (tracker_t* tracker);
+
+/* Trace of a tiling sweep: a copy of each schedule computed while tiling, in
+ * the order in which they are computed. That is, the seed loop schedule; then,
+ * for the seed loop and each loop tiled forward, the loop schedule (except for
+ * the seed loop) followed by the projections computed from it; then the same
+ * for the seed loop and each loop tiled backward */
+typedef std::vector<schedule_t*> trace_t;
+
+/*
+ * Destroy the schedules in a trace, leaving it empty
+ */
+void trace_clear (trace_t* trace);
+
+/*
+ * Return the bytes held by the schedules in a trace
+ */
+long trace_bytes (trace_t* trace);
 
 /*
  * Project tiling and coloring of an iteration set to all sets that are
@@ -55,17 +120,24 @@ typedef std::map<int, index_set> tracker_t;
  *   accessed as tiling forward that has to be used for backward tiling.
  * @param conflictsTracker
  *   track conflicting tiles encountered by each tile during the tiling process
+ * @param inverseMaps
+ *   inverse maps computed so far. Projections are computed through inverse maps,
+ *   which are shared by all loops and all tiling sweeps
  * @param ignoreWAR
  *   if true, avoid tracking write-after-read dependencies, which decreases
  *   inspection time and, potentially, improves load balancing. This may be useful
  *   in unstructured mesh codes.
+ * @param trace (optional)
+ *   if not NULL, a copy of each projection computed is appended to it
  */
 void project_forward (loop_t* tiledLoop,
                       schedule_t* tilingInfo,
                       projection_t* prevLoopProj,
                       projection_t* seedLoopProj,
                       tracker_t* conflictsTracker,
-                      bool ignoreWAR);
+                      inverse_maps* inverseMaps,
+                      bool ignoreWAR,
+                      trace_t* trace = NULL);
 
 /*
  * Project tiling and coloring of an iteration set to all sets that are
@@ -83,16 +155,23 @@ void project_forward (loop_t* tiledLoop,
  *   projection of tiling at loop_{i+1}.
  * @param conflictsTracker
  *   track conflicting tiles encountered by each tile during the tiling process
+ * @param inverseMaps
+ *   inverse maps computed so far. Projections are computed through inverse maps,
+ *   which are shared by all loops and all tiling sweeps
  * @param ignoreWAR
  *   if true, avoid tracking write-after-read dependencies, which decreases
  *   inspection time and, potentially, improves load balancing. This may be useful
  *   in unstructured mesh codes.
+ * @param trace (optional)
+ *   if not NULL, a copy of each projection computed is appended to it
  */
 void project_backward (loop_t* tiledLoop,
                        schedule_t* tilingInfo,
                        projection_t* prevLoopProj,
                        tracker_t* conflictsTracker,
-                       bool ignoreWAR);
+                       inverse_maps* inverseMaps,
+                       bool ignoreWAR,
+                       trace_t* trace = NULL);
 
 /*
  * Tile a parloop moving forward along the loop chain.
@@ -101,9 +180,13 @@ void project_backward (loop_t* tiledLoop,
  *   the loop whose iterations will be colored and assigned a tile
  * @param prevLoopProj
  *   the projection of tiling up to curLoop
+ * @param conflictsTracker
+ *   track tiles that reach an iteration of curLoop with the same color as the
+ *   tile the iteration is assigned to
  */
 schedule_t* tile_forward (loop_t* curLoop,
-                         projection_t* prevLoopProj);
+                         projection_t* prevLoopProj,
+                         tracker_t* conflictsTracker);
 
 /*
  * Tile a parloop moving backward along the loop chain.
@@ -112,9 +195,13 @@ schedule_t* tile_forward (loop_t* curLoop,
  *   the loop whose iterations will be colored and assigned a tile
  * @param prevLoopProj
  *   the projection of tiling up to curLoop
+ * @param conflictsTracker
+ *   track tiles that reach an iteration of curLoop with the same color as the
+ *   tile the iteration is assigned to
  */
 schedule_t* tile_backward (loop_t* curLoop,
-                          projection_t* prevLoopProj);
+                          projection_t* prevLoopProj,
+                          tracker_t* conflictsTracker);
 
 /*
  * Distribute the iterations of a tiled loop to tiles
@@ -125,17 +212,57 @@ schedule_t* tile_backward (loop_t* curLoop,
  *   the loop chain
  * @param tiles
  *   the list of tiles to be populated
- * @param iter2tile
- *   an integer map from iterations to tiles
+ * @param iter2tc
+ *   the tiling and coloring of the loop iterations, as packed words
  * @param direction
  *  the tiling direction
  */
 void assign_loop (loop_t* loop,
                   loop_list* loops,
                   tile_list* tiles,
-                  int* iter2tile,
+                  tc_t* iter2tc,
                   direction_t direction);
 
+/*
+ * Repair the tiling of a loop chain after the color of some seed loop iterations
+ * changed. Rather than tiling the whole loop chain again, only the iterations
+ * (of any loop or projected set) adjacent to an iteration whose tile or color
+ * changed are tiled again, which propagates the changes along the loop chain.
+ * The resulting tiling, as well as the conflicts found, is the same that a new
+ * tiling sweep with the new seed loop coloring would produce.
+ *
+ * @param loops
+ *   the loop chain
+ * @param seed
+ *   the index of the seed loop
+ * @param tiles
+ *   the tiles, whose iterations are distributed again in the loops whose
+ *   tiling changed
+ * @param iter2color
+ *   the new coloring of the seed loop
+ * @param recolored
+ *   the seed loop iterations whose color changed
+ * @param trace
+ *   the trace of the tiling to be repaired, which is updated in place
+ * @param conflictsTracker
+ *   track conflicting tiles encountered by each retiled iteration
+ * @param inverseMaps
+ *   inverse maps computed so far
+ * @param ignoreWAR
+ *   as for the tiling sweep being repaired
+ * @return
+ *   the number of loop iterations tiled again
+ */
+long retile (loop_list* loops,
+             int seed,
+             tile_list* tiles,
+             index_t* iter2color,
+             std::vector<index_t>& recolored,
+             trace_t* trace,
+             tracker_t* conflictsTracker,
+             inverse_maps* inverseMaps,
+             bool ignoreWAR);
+
 /**************************************************************************/
 
 #endif
@@ -0,0 +1,118 @@
+/*
+ *  tuner.h
+ *
+ * Select the tile size, either empirically, by timing the executor for a set of
+ * candidate tile sizes, or such that the data touched by a tile fits in cache
+ */
+
+#ifndef _TUNER_H_
+#define _TUNER_H_
+
+#include <string>
+
+#include "inspector.h"
+#include "executor.h"
+
+/*
+ * A function executing the whole loop chain once through /exec/, e.g. by calling
+ * /exec_run/. /args/ is passed through by /insp_tune/
+ */
+typedef void (*tune_kernel) (executor_t* exec,
+                             void* args);
+
+/*
+ * The outcome of /insp_tune/
+ */
+typedef struct {
+  /* the best tile size */
+  int avgTileSize;
+  /* the time, in seconds, of an execution of the loop chain with the best tile
+     size, or 0 if the best tile size was read from file */
+  double execTime;
+  /* the number of tile sizes tried, or 0 if the best tile size was read from file */
+  int nTried;
+} tuning_t;
+
+/*
+ * Run the inspection for each candidate tile size, and time the execution of
+ * the loop chain through /kernel/: the fastest tile size is kept, and the
+ * inspection is run a last time with it, as /insp_run/ would do. The remaining
+ * inspector settings (e.g., the coloring) are those given to /insp_init/.
+ *
+ * For each candidate tile size, /kernel/ is called once to warm up, and then
+ * /nRuns/ times; the fastest run is the execution time of that tile size. Note
+ * that /kernel/ is therefore executed several times, so it must be safe to do so
+ * (e.g., by working on a copy of the data).
+ *
+ * @param insp
+ *   the inspector data structure, already initialized with some parloops
+ * @param suggestedSeed
+ *   the seed loop passed to /insp_run/
+ * @param kernel
+ *   a function executing the loop chain once
+ * @param args
+ *   user data passed to /kernel/
+ * @param tuning
+ *   if not NULL, filled with the outcome of the tuning
+ * @param tileSizes
+ *   the candidate tile sizes. If NULL, the tile size given to /insp_init/ is
+ *   tried together with a quarter, half, double, and four times that size
+ * @param nTileSizes
+ *   the number of candidate tile sizes in /tileSizes/
+ * @param nRuns
+ *   the number of timed executions of the loop chain for each tile size
+ * @param mode
+ *   the execution mode passed to /exec_init/
+ * @param fileName
+ *   if not empty, a file in which the best tile size is stored, keyed by the
+ *   fingerprint of the inspection problem (see /cache_fingerprint/) regardless
+ *   of the tile size. A loop chain whose best tile size is already in the file
+ *   is not tuned again. The file can be shared by several loop chains
+ * @return
+ *   INSP_OK once the inspection has been run with the best tile size; INSP_ERR
+ *   if there are no valid candidate tile sizes, in which case /insp/ is untouched
+ */
+insp_info insp_tune (inspector_t* insp,
+                     int suggestedSeed,
+                     tune_kernel kernel,
+                     void* args,
+                     tuning_t* tuning = NULL,
+                     int* tileSizes = NULL,
+                     int nTileSizes = 0,
+                     int nRuns = 3,
+                     exec_mode mode = EXEC_COLORS,
+                     std::string fileName = "");
+
+/*
+ * Run the inspection with a tile size such that the data footprint of a given
+ * fraction of the tiles (see /tile_footprints/) fits in a given cache level.
+ * Starting from the tile size given to /insp_init/, the tile size is rescaled by
+ * the ratio between the cache size and the footprint that the target fraction of
+ * tiles does not exceed, and the inspection is run again; the largest tile size
+ * meeting the target is kept. Unless given, the cache size is that of the cache
+ * level, a cache shared by several CPUs being split among the threads (see
+ * /cpu_cache_size/).
+ *
+ * @param insp
+ *   the inspector data structure, already initialized with some parloops, some
+ *   of whose access descriptors have a known number of bytes (see /desc/)
+ * @param suggestedSeed
+ *   the seed loop passed to /insp_run/
+ * @param cacheLevel
+ *   the cache level the tiles should fit in
+ * @param fraction
+ *   the fraction of core tiles, between 0 and 1, that should fit in cache
+ * @param cacheSize
+ *   the bytes of cache available to each thread; if 0, /cacheLevel/ is queried
+ * @return
+ *   INSP_OK once the inspection has been run with the selected tile size;
+ *   INSP_ERR if either the cache size or the data sizes are not available, in
+ *   which case /insp/ is untouched
+ */
+insp_info insp_fit_cache (inspector_t* insp,
+                          int suggestedSeed,
+                          int cacheLevel = 2,
+                          double fraction = 0.9,
+                          long cacheSize = 0);
+
+#endif
@@ -58,11 +58,16 @@
       projection_t::const_iterator it, end; \
       for (it = _projection->begin(), end = _projection->end(); it != end; it++) { \
         std::cout << "    " << (*it)->name  << std::endl \
-                  << "      size: " << (*it)->itSetSize << std::endl \
-                  << "      tiling: "; \
-        PRINT_INTARR((*it)->iter2tile, 0, (*it)->itSetSize); \
+                  << "      size: " << (*it)->itSetSize << std::endl; \
+        int* _iter2tile = new int[(*it)->itSetSize]; \
+        int* _iter2color = new int[(*it)->itSetSize]; \
+        schedule_unpack (*it, _iter2tile, _iter2color); \
+        std::cout << "      tiling: "; \
+        PRINT_INTARR(_iter2tile, 0, (*it)->itSetSize); \
         std::cout << "      coloring: "; \
-        PRINT_INTARR((*it)->iter2color, 0, (*it)->itSetSize); \
+        PRINT_INTARR(_iter2color, 0, (*it)->itSetSize); \
+        delete[] _iter2tile; \
+        delete[] _iter2color; \
       } \
     } while (false)
 
@@ -81,13 +86,11 @@
 #   define PRINT_TRACKER(tracker) \
     do { \
       std::cout << "Tracker `" #tracker "`:" << std::endl; \
-      int iTrack = 0; \
-      for (iTrack = 0; iTrack < tracker.size(); iTrack++) { \
+      for (int iTrack = 0; iTrack < tracker->nTiles; iTrack++) { \
         std::cout << "  " << iTrack << ": "; \
-        index_set tracked = tracker[iTrack]; \
-        index_set::const_iterator isIt, isEnd; \
-        for (isIt = tracked.begin(), isEnd = tracked.end(); isIt != isEnd; isIt++) { \
-          std::cout << *isIt << ", "; \
+        for (int jTrack = tracker->offsets[iTrack]; \
+             jTrack < tracker->offsets[iTrack + 1]; jTrack++) { \
+          std::cout << tracker->adjncy[jTrack] << ", "; \
         } \
         std::cout << std::endl; \
       } \
@@ -127,6 +130,21 @@ inline double time_stamp()
   return tv.tv_sec + (tv.tv_nsec) / (1000.0*1000.0*1000.0);
 }
 
+/*
+ * Return the size, in bytes, of the data (or unified) cache of a given level,
+ * as reported by /sys/devices/system/cpu for the first CPU
+ *
+ * @param level
+ *   the cache level, starting from 1
+ * @param nThreads
+ *   the number of threads running on the CPUs sharing the cache, which
+ *   split it evenly
+ * @return
+ *   the cache size available to each thread, or 0 if not available
+ */
+long cpu_cache_size (int level,
+                     int nThreads = 1);
+
 /*
  * Generate a VTK file showing the coloring of each tiled parloop once opened
  * with a program such as Paraview.
@@ -182,8 +200,6 @@ inline double time_stamp()
 #define VTK_DIR "vtkfiles"
 #endif
 
-enum dimension {DIM1 = 1, DIM2 = 2, DIM3 = 3};
-
 void generate_vtk (inspector_t* insp,
                    insp_verbose level,
                    set_t* nodes,
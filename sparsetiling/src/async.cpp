@@ -0,0 +1,112 @@
+/*
+ *  async.cpp
+ *
+ * Implement the inspection in the background
+ */
+
+#ifdef SLOPE_OMP
+#include <omp.h>
+#endif
+
+#include "async.h"
+#include "cache.h"
+#include "utils.h"
+
+// prototypes of static functions
+static void* async_inspect (void* args);
+static void async_run (insp_async_t* handle);
+
+
+insp_async_t* insp_run_async (inspector_t* insp, int suggestedSeed, int nThreads,
+                              std::string fileName)
+{
+  ASSERT(insp != NULL, "Invalid NULL pointer to inspector");
+
+  insp_async_t* handle = new insp_async_t;
+  handle->insp = insp;
+  handle->suggestedSeed = suggestedSeed;
+  handle->nThreads = nThreads;
+  handle->fileName = fileName;
+  handle->done = false;
+  handle->result = INSP_ERR;
+  handle->time = 0.0;
+  pthread_mutex_init (&handle->lock, NULL);
+
+  // if no thread can be spawned, inspect straight away
+  handle->spawned = ! pthread_create (&handle->thread, NULL, async_inspect, handle);
+  if (! handle->spawned) {
+    async_run (handle);
+  }
+
+  return handle;
+}
+
+bool insp_ready (insp_async_t* handle)
+{
+  ASSERT(handle != NULL, "Invalid NULL pointer to background inspection");
+
+  pthread_mutex_lock (&handle->lock);
+  bool done = handle->done;
+  pthread_mutex_unlock (&handle->lock);
+  return done;
+}
+
+insp_info insp_wait (insp_async_t* handle, double* time)
+{
+  ASSERT(handle != NULL, "Invalid NULL pointer to background inspection");
+
+  if (handle->spawned) {
+    pthread_join (handle->thread, NULL);
+  }
+
+  insp_info result = handle->result;
+  if (time) {
+    *time = handle->time;
+  }
+  pthread_mutex_destroy (&handle->lock);
+  delete handle;
+  return result;
+}
+
+
+/***** Static / utility functions *****/
+
+static void* async_inspect (void* args)
+{
+  insp_async_t* handle = (insp_async_t*)args;
+
+#ifdef SLOPE_OMP
+  // the number of threads only affects this thread's parallel regions; the
+  // tiling itself depends on /insp->nThreads/, fixed by /insp_init/
+  if (handle->nThreads > 0) {
+    omp_set_num_threads (handle->nThreads);
+  }
+#endif
+  async_run (handle);
+
+  return NULL;
+}
+
+static void async_run (insp_async_t* handle)
+{
+  // aliases
+  inspector_t* insp = handle->insp;
+  int suggestedSeed = handle->suggestedSeed;
+  std::string fileName = handle->fileName;
+
+  double start = time_stamp();
+  insp_info result = INSP_OK;
+  if (fileName.empty() || insp_load (insp, suggestedSeed, fileName) != INSP_OK) {
+    result = insp_run (insp, suggestedSeed);
+    if (! fileName.empty() && result == INSP_OK) {
+      insp_save (insp, suggestedSeed, fileName);
+    }
+  }
+  double end = time_stamp();
+
+  pthread_mutex_lock (&handle->lock);
+  handle->result = result;
+  handle->time = end - start;
+  handle->done = true;
+  pthread_mutex_unlock (&handle->lock);
+}
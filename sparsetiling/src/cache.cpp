@@ -0,0 +1,579 @@
+/*
+ *  cache.cpp
+ *
+ * Implement the on-disk cache of inspection results
+ */
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "cache.h"
+#include "partitioner.h"
+#include "utils.h"
+
+/*
+ * File layout (native endianness, all integers are 4 bytes unless stated, and
+ * indices, marked with [i], are sizeof(index_t) bytes):
+ *
+ *   magic (8 bytes) | fingerprint (8 bytes) | version
+ *   seed | nSweeps | nLoops | nColors | sizeof(index_t)
+ *   seedSetSize [i] | nCore [i] | nExec [i] | nNonExec [i]
+ *   partitioningMode (string)
+ *   iter2tile[seedSetSize] [i] | iter2color[seedSetSize] [i]
+ *   for each tile:
+ *     color | region | prefetchHalo
+ *     for each loop: nIterations [i] | iterations[nIterations] [i]
+ *   for each loop:
+ *     offsets[nTiles + 1] [i] | nLocalMaps
+ *     for each local map: name (string) | arity | values[offsets[nTiles]*arity] [i]
+ *     or, for a local map of an irregular global map (arity == 0):
+ *                         name (string) | 0 | mapOffsets[offsets[nTiles] + 1] [i] |
+ *                         values[mapOffsets[offsets[nTiles]]] [i]
+ *
+ * A string is stored as its length followed by its characters, padded to a
+ * multiple of 4 bytes so that the mapped file can be read as an array of ints.
+ * Indices are preceded by 4 bytes of padding, if needed, so that they are
+ * aligned in the mapped file.
+ */
+
+static const char cacheMagic[8] = {'S', 'L', 'O', 'P', 'E', 'I', 'N', 'S'};
+static const int cacheVersion = 4;
+
+// cursor over a memory-mapped cache file
+typedef struct {
+  const char* base;
+  const int* cur;
+  const int* end;
+} cache_reader;
+
+// prototypes of static functions
+static uint64_t hash_ints (uint64_t h, const int* values, index_t size);
+static uint64_t hash_indices (uint64_t h, const index_t* values, index_t size);
+static uint64_t hash_string (uint64_t h, std::string s);
+static uint64_t hash_set (set_t* set);
+static uint64_t hash_map (map_t* map, std::map<map_t*, uint64_t>& hashedMaps);
+static void write_ints (std::ofstream& file, const int* values, int size);
+static void write_indices (std::ofstream& file, const index_t* values, index_t size);
+static void write_string (std::ofstream& file, std::string s);
+static const int* read_ints (cache_reader& reader, int size);
+static const index_t* read_indices (cache_reader& reader, index_t size);
+static bool read_int (cache_reader& reader, int* value);
+static bool read_index (cache_reader& reader, index_t* value);
+static bool read_string (cache_reader& reader, std::string* s);
+static bool valid_indices (const index_t* values, index_t size, index_t bound);
+
+
+uint64_t cache_fingerprint (inspector_t* insp, int suggestedSeed)
+{
+  ASSERT(insp != NULL, "Invalid NULL pointer to inspector");
+
+  // aliases
+  loop_list* loops = insp->loops;
+
+  // the same map is usually accessed by several descriptors, so hash it only once
+  std::map<map_t*, uint64_t> hashedMaps;
+
+  uint64_t h = 14695981039346656037ULL;
+  int parameters[] = {cacheVersion, insp->avgTileSize, insp->strategy, insp->coloring,
+                      insp->maxColors, insp->prefetchHalo, insp->ignoreWAR, insp->nThreads,
+                      insp->repairConflicts, suggestedSeed, (int)loops->size(),
+                      (int)sizeof(index_t)};
+  h = hash_ints (h, parameters, sizeof(parameters) / sizeof(int));
+#ifdef SLOPE_METIS
+  // whether METIS is available changes the partitioning
+  h = hash_string (h, "metis");
+#endif
+
+  loop_list::const_iterator lIt, lEnd;
+  for (lIt = loops->begin(), lEnd = loops->end(); lIt != lEnd; lIt++) {
+    h = hash_string (h, (*lIt)->name);
+    h = hash_ints (h, &(*lIt)->index, 1);
+    h ^= hash_set ((*lIt)->set);
+    // descriptors are stored in a set of pointers, so their order changes from
+    // run to run; sort their hashes to make the fingerprint order-independent
+    std::vector<uint64_t> descHashes;
+    desc_list* descriptors = (*lIt)->descriptors;
+    desc_list::const_iterator dIt, dEnd;
+    for (dIt = descriptors->begin(), dEnd = descriptors->end(); dIt != dEnd; dIt++) {
+      map_t* map = (*dIt)->map;
+      int mode = (*dIt)->mode;
+      uint64_t descHash = (map == DIRECT) ? 0 : hash_map (map, hashedMaps);
+      descHashes.push_back (hash_ints (descHash, &mode, 1));
+    }
+    std::sort (descHashes.begin(), descHashes.end());
+    h = hash_ints (h, (int*)descHashes.data(), descHashes.size()*2);
+  }
+
+  // optional inputs affecting the seed partitioning
+  map_list* optionalMaps[] = {insp->meshMaps, insp->partitionings};
+  for (int i = 0; i < 2; i++) {
+    if (! optionalMaps[i]) {
+      h = hash_string (h, "none");
+      continue;
+    }
+    std::vector<uint64_t> mapHashes;
+    map_list::const_iterator mIt, mEnd;
+    for (mIt = optionalMaps[i]->begin(), mEnd = optionalMaps[i]->end(); mIt != mEnd; mIt++) {
+      mapHashes.push_back (hash_map (*mIt, hashedMaps));
+    }
+    std::sort (mapHashes.begin(), mapHashes.end());
+    h = hash_ints (h, (int*)mapHashes.data(), mapHashes.size()*2);
+  }
+  int partitioning[] = {insp->partitioning, insp->meshDim};
+  h = hash_ints (h, partitioning, 2);
+  if (insp->coordinates && insp->meshMaps && ! insp->meshMaps->empty()) {
+    index_t nNodes = (*insp->meshMaps->begin())->outSet->size;
+    h = hash_ints (h, (int*)insp->coordinates, nNodes*insp->meshDim*2);
+  }
+
+  return h;
+}
+
+insp_info insp_save (inspector_t* insp, int suggestedSeed, std::string fileName)
+{
+  ASSERT(insp != NULL, "Invalid NULL pointer to inspector");
+
+  if (! insp->tiles || ! insp->tiles->size() || ! insp->iter2tile || ! insp->iter2color) {
+    // nothing to save, /insp_run/ has not been called yet
+    return INSP_ERR;
+  }
+
+  // aliases
+  loop_list* loops = insp->loops;
+  tile_list* tiles = insp->tiles;
+  set_t* tileRegions = insp->tileRegions;
+  int nLoops = loops->size();
+  int nTiles = tiles->size();
+  index_t seedSetSize = insp->iter2tile->inSet->size;
+
+  std::ofstream file (fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (! file.is_open()) {
+    return INSP_ERR;
+  }
+
+  uint64_t key = cache_fingerprint (insp, suggestedSeed);
+  file.write (cacheMagic, sizeof(cacheMagic));
+  file.write ((const char*)&key, sizeof(key));
+  int header[] = {cacheVersion, insp->seed, insp->nSweeps, nLoops,
+                  (int)insp->iter2color->outSet->size, (int)sizeof(index_t)};
+  index_t sizes[] = {seedSetSize, tileRegions->core, tileRegions->execHalo,
+                     tileRegions->nonExecHalo};
+  write_ints (file, header, sizeof(header) / sizeof(int));
+  write_indices (file, sizes, 4);
+  write_string (file, insp->partitioningMode);
+  write_indices (file, insp->iter2tile->values, seedSetSize);
+  write_indices (file, insp->iter2color->values, seedSetSize);
+
+  tile_list::const_iterator tIt, tEnd;
+  for (tIt = tiles->begin(), tEnd = tiles->end(); tIt != tEnd; tIt++) {
+    tile_t* tile = *tIt;
+    int tileInfo[] = {tile->color, tile->region, tile->prefetchHalo};
+    write_ints (file, tileInfo, 3);
+    for (int i = 0; i < nLoops; i++) {
+      iterations_list& iterations = *(tile->iterations[i]);
+      index_t nIterations = iterations.size();
+      write_indices (file, &nIterations, 1);
+      write_indices (file, iterations.data(), nIterations);
+    }
+  }
+
+  // the local maps are shared by all tiles, so they are written once per loop
+  for (int i = 0; i < nLoops; i++) {
+    local_maps_t* localMaps = tiles->at(0)->localMaps[i];
+    index_t* offsets = localMaps->offsets;
+    write_indices (file, offsets, nTiles + 1);
+    write_ints (file, &localMaps->nMaps, 1);
+    for (int m = 0; m < localMaps->nMaps; m++) {
+      write_string (file, localMaps->names[m]);
+      write_ints (file, &localMaps->arities[m], 1);
+      if (localMaps->mapOffsets[m]) {
+        write_indices (file, localMaps->mapOffsets[m], offsets[nTiles] + 1);
+      }
+      write_indices (file, localMaps->values[m], local_map_start (localMaps, m, nTiles));
+    }
+  }
+
+  file.close();
+  return file.fail() ? INSP_ERR : INSP_OK;
+}
+
+insp_info insp_load (inspector_t* insp, int suggestedSeed, std::string fileName)
+{
+  ASSERT(insp != NULL, "Invalid NULL pointer to inspector");
+
+  // aliases
+  loop_list* loops = insp->loops;
+  int nLoops = loops->size();
+
+  double start = time_stamp();
+
+  int fd = open (fileName.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return INSP_ERR;
+  }
+  struct stat st;
+  if (fstat (fd, &st) == -1 || st.st_size < (off_t)(sizeof(cacheMagic) + sizeof(uint64_t))) {
+    close (fd);
+    return INSP_ERR;
+  }
+  size_t fileSize = st.st_size;
+  void* mapped = mmap (NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (mapped == MAP_FAILED) {
+    return INSP_ERR;
+  }
+
+  // check this is a cache file for the very same inspection problem
+  const char* bytes = (const char*)mapped;
+  uint64_t key;
+  memcpy (&key, bytes + sizeof(cacheMagic), sizeof(key));
+  if (memcmp (bytes, cacheMagic, sizeof(cacheMagic)) ||
+      key != cache_fingerprint (insp, suggestedSeed)) {
+    munmap (mapped, fileSize);
+    return INSP_ERR;
+  }
+
+  // parse the file; nothing in /insp/ is touched until parsing succeeds
+  cache_reader reader;
+  reader.base = bytes;
+  reader.cur = (const int*)(bytes + sizeof(cacheMagic) + sizeof(key));
+  reader.end = reader.cur + (fileSize - sizeof(cacheMagic) - sizeof(key)) / sizeof(int);
+
+  tile_list* tiles = NULL;
+  bool valid = false;
+  do {
+    const int* header = read_ints (reader, 6);
+    if (! header || header[0] != cacheVersion || header[1] < 0 || header[1] >= nLoops ||
+        header[3] != nLoops || header[4] <= 0 || header[5] != sizeof(index_t)) {
+      break;
+    }
+    const index_t* regions = read_indices (reader, 4);
+    if (! regions || regions[0] != loops->at(header[1])->set->size) {
+      break;
+    }
+    int seed = header[1];
+    int nColors = header[4];
+    index_t seedSetSize = regions[0];
+    index_t nTiles = regions[1] + regions[2] + regions[3];
+    if (regions[1] < 0 || regions[2] < 0 || regions[3] < 0 || nTiles <= 0 ||
+        nTiles > reader.end - reader.cur) {
+      break;
+    }
+
+    std::string partitioningMode;
+    const index_t* iter2tile;
+    const index_t* iter2color;
+    if (! read_string (reader, &partitioningMode) ||
+        ! (iter2tile = read_indices (reader, seedSetSize)) ||
+        ! (iter2color = read_indices (reader, seedSetSize)) ||
+        ! valid_indices (iter2tile, seedSetSize, nTiles) ||
+        ! valid_indices (iter2color, seedSetSize, nColors)) {
+      break;
+    }
+
+    // the iterations of each tile and loop, which must belong to the loop's set
+    std::vector<const int*> tileInfos (nTiles);
+    std::vector<std::vector<index_t> > sizes (nTiles, std::vector<index_t>(nLoops));
+    std::vector<std::vector<const index_t*> > iterations (nTiles,
+                                                          std::vector<const index_t*>(nLoops));
+    bool validTiles = true;
+    for (int t = 0; t < nTiles && validTiles; t++) {
+      validTiles = (tileInfos[t] = read_ints (reader, 3)) != NULL &&
+                   tileInfos[t][0] >= 0 && tileInfos[t][0] < nColors &&
+                   tileInfos[t][1] >= LOCAL && tileInfos[t][1] <= NON_EXEC_HALO &&
+                   tileInfos[t][2] >= 0;
+      for (int i = 0; i < nLoops && validTiles; i++) {
+        validTiles = read_index (reader, &sizes[t][i]) &&
+                     (iterations[t][i] = read_indices (reader, sizes[t][i])) != NULL &&
+                     valid_indices (iterations[t][i], sizes[t][i], loops->at(i)->set->size);
+      }
+    }
+    if (! validTiles) {
+      break;
+    }
+
+    // the local maps of each loop, whose values must belong to the target set of
+    // the global map of the same name
+    std::vector<const index_t*> offsets (nLoops);
+    std::vector<std::vector<std::string> > mapNames (nLoops);
+    std::vector<std::vector<int> > arities (nLoops);
+    std::vector<std::vector<const index_t*> > mapValues (nLoops);
+    std::vector<std::vector<const index_t*> > mapOffsets (nLoops);
+    bool validMaps = true;
+    for (int i = 0; i < nLoops && validMaps; i++) {
+      int nLocalMaps = 0;
+      validMaps = (offsets[i] = read_indices (reader, nTiles + 1)) != NULL &&
+                  read_int (reader, &nLocalMaps) && nLocalMaps >= 0;
+      for (int t = 0; t < nTiles && validMaps; t++) {
+        validMaps = offsets[i][0] == 0 &&
+                    offsets[i][t + 1] - offsets[i][t] == sizes[t][i];
+      }
+      for (int m = 0; m < nLocalMaps && validMaps; m++) {
+        std::string mapName;
+        int arity;
+        const index_t* values;
+        const index_t* iterOffsets = NULL;
+        index_t nValues = 0;
+        validMaps = read_string (reader, &mapName) && read_int (reader, &arity) &&
+                    arity >= 0;
+        map_t* globalMap = NULL;
+        desc_list::const_iterator dIt, dEnd;
+        desc_list* descriptors = loops->at(i)->descriptors;
+        for (dIt = descriptors->begin(), dEnd = descriptors->end(); dIt != dEnd; dIt++) {
+          if ((*dIt)->map != DIRECT && (*dIt)->map->name == mapName) {
+            globalMap = (*dIt)->map;
+          }
+        }
+        validMaps = validMaps && globalMap;
+        if (validMaps && arity == 0) {
+          // irregular map: the offsets must be non-decreasing, starting from 0
+          index_t nIters = offsets[i][nTiles];
+          validMaps = (iterOffsets = read_indices (reader, nIters + 1)) != NULL &&
+                      iterOffsets[0] == 0;
+          for (index_t e = 0; e < nIters && validMaps; e++) {
+            validMaps = iterOffsets[e + 1] >= iterOffsets[e];
+          }
+          nValues = validMaps ? iterOffsets[nIters] : 0;
+        }
+        else {
+          nValues = offsets[i][nTiles]*arity;
+        }
+        validMaps = validMaps && (values = read_indices (reader, nValues)) &&
+                    valid_indices (values, nValues, globalMap->outSet->size);
+        if (validMaps) {
+          mapNames[i].push_back (mapName);
+          arities[i].push_back (arity);
+          mapValues[i].push_back (values);
+          mapOffsets[i].push_back (iterOffsets);
+        }
+      }
+    }
+    if (! validMaps || reader.cur != reader.end) {
+      break;
+    }
+
+    // all good, build the tiles and their local maps
+    tiles = new tile_list (nTiles);
+    for (int t = 0; t < nTiles; t++) {
+      tile_t* tile = tile_init (t, nLoops, (tile_region)tileInfos[t][1], tileInfos[t][2]);
+      tile->color = tileInfos[t][0];
+      for (int i = 0; i < nLoops; i++) {
+        tile->iterations[i]->assign (iterations[t][i], iterations[t][i] + sizes[t][i]);
+      }
+      tiles->at(t) = tile;
+    }
+    for (int i = 0; i < nLoops; i++) {
+      index_t* loopOffsets = new index_t[nTiles + 1];
+      memcpy (loopOffsets, offsets[i], sizeof(index_t)*(nTiles + 1));
+      std::vector<index_t*> loopMapOffsets (mapNames[i].size(), (index_t*)NULL);
+      for (size_t m = 0; m < mapNames[i].size(); m++) {
+        if (mapOffsets[i][m]) {
+          loopMapOffsets[m] = new index_t[loopOffsets[nTiles] + 1];
+          memcpy (loopMapOffsets[m], mapOffsets[i][m],
+                  sizeof(index_t)*(loopOffsets[nTiles] + 1));
+        }
+      }
+      local_maps_t* localMaps = local_maps_init (nTiles, mapNames[i], arities[i], loopOffsets,
+                                                 &loopMapOffsets);
+      for (int m = 0; m < localMaps->nMaps; m++) {
+        memcpy (localMaps->values[m], mapValues[i][m],
+                sizeof(index_t)*local_map_start (localMaps, m, nTiles));
+      }
+      for (int t = 0; t < nTiles; t++) {
+        tiles->at(t)->localMaps[i] = localMaps;
+      }
+    }
+
+    // all good, populate the inspector, discarding any previous inspection
+    partition_free (insp);
+    stats_reset (insp->stats, loops);
+    loop_t* seedLoop = loops->at(seed);
+    set_t* tileRegions = set ("tiles", regions[1], regions[2], regions[3]);
+    index_t* iter2tileValues = new index_t[seedSetSize];
+    index_t* iter2colorValues = new index_t[seedSetSize];
+    memcpy (iter2tileValues, iter2tile, sizeof(index_t)*seedSetSize);
+    memcpy (iter2colorValues, iter2color, sizeof(index_t)*seedSetSize);
+
+    insp->seed = seed;
+    insp->nSweeps = header[2];
+    insp->partitioningMode = partitioningMode;
+    insp->tileRegions = tileRegions;
+    insp->tiles = tiles;
+    insp->iter2tile = map ("i2t", set_cpy(seedLoop->set), set_cpy(tileRegions),
+                           iter2tileValues, seedSetSize);
+    insp->iter2color = map ("i2c", set_cpy(seedLoop->set), set("colors", header[4]),
+                            iter2colorValues, seedSetSize);
+    valid = true;
+  } while (false);
+
+  munmap (mapped, fileSize);
+
+  if (! valid) {
+    return INSP_ERR;
+  }
+
+  // footprints are not stored, as the data sizes do not affect the tiling
+  tile_footprints (insp->tiles, loops);
+
+  insp->partitioningTime = 0.0;
+  insp->totalInspectionTime = time_stamp() - start;
+
+  return INSP_OK;
+}
+
+/***** Static / utility functions *****/
+
+static uint64_t hash_ints (uint64_t h, const int* values, index_t size)
+{
+  // FNV-1a, applied to 4-byte words rather than single bytes
+  for (index_t i = 0; i < size; i++) {
+    h ^= (uint32_t)values[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static uint64_t hash_indices (uint64_t h, const index_t* values, index_t size)
+{
+  return hash_ints (h, (const int*)values, size*(sizeof(index_t) / sizeof(int)));
+}
+
+static uint64_t hash_string (uint64_t h, std::string s)
+{
+  for (size_t i = 0; i < s.size(); i++) {
+    h ^= (unsigned char)s[i];
+    h *= 1099511628211ULL;
+  }
+  // terminator, so that ("ab", "c") and ("a", "bc") differ
+  int terminator = 0;
+  return hash_ints (h, &terminator, 1);
+}
+
+static uint64_t hash_set (set_t* set)
+{
+  uint64_t h = hash_string (14695981039346656037ULL, set->name);
+  index_t sizes[] = {set->core, set->execHalo, set->nonExecHalo};
+  h = hash_indices (h, sizes, 3);
+  if (set_super (set)) {
+    h = hash_string (h, set_super (set)->name);
+  }
+  return h;
+}
+
+static uint64_t hash_map (map_t* map, std::map<map_t*, uint64_t>& hashedMaps)
+{
+  std::map<map_t*, uint64_t>::const_iterator it = hashedMaps.find (map);
+  if (it != hashedMaps.end()) {
+    return it->second;
+  }
+
+  uint64_t h = hash_string (14695981039346656037ULL, map->name);
+  h ^= hash_set (map->inSet);
+  h = hash_indices (h, &map->size, 1);
+  h ^= hash_set (map->outSet) * 31;
+  h = hash_indices (h, map->values, map->size);
+  if (map->offsets) {
+    h = hash_indices (h, map->offsets, map->inSet->size + 1);
+  }
+
+  hashedMaps[map] = h;
+  return h;
+}
+
+static void write_ints (std::ofstream& file, const int* values, int size)
+{
+  file.write ((const char*)values, sizeof(int)*size);
+}
+
+static void write_indices (std::ofstream& file, const index_t* values, index_t size)
+{
+  int padding = 0;
+  while (file.tellp() % sizeof(index_t)) {
+    write_ints (file, &padding, 1);
+  }
+  file.write ((const char*)values, sizeof(index_t)*size);
+}
+
+static void write_string (std::ofstream& file, std::string s)
+{
+  int size = s.size();
+  int padding = (sizeof(int) - size % sizeof(int)) % sizeof(int);
+  write_ints (file, &size, 1);
+  file.write (s.data(), size);
+  file.write ("\0\0\0", padding);
+}
+
+static const int* read_ints (cache_reader& reader, int size)
+{
+  if (size < 0 || reader.end - reader.cur < size) {
+    return NULL;
+  }
+  const int* values = reader.cur;
+  reader.cur += size;
+  return values;
+}
+
+static const index_t* read_indices (cache_reader& reader, index_t size)
+{
+  // skip the padding written by /write_indices/
+  while (((const char*)reader.cur - reader.base) % sizeof(index_t)) {
+    if (! read_ints (reader, 1)) {
+      return NULL;
+    }
+  }
+  const int wordsPerIndex = sizeof(index_t) / sizeof(int);
+  if (size < 0 || (reader.end - reader.cur) / wordsPerIndex < size) {
+    return NULL;
+  }
+  const index_t* values = (const index_t*)reader.cur;
+  reader.cur += size*wordsPerIndex;
+  return values;
+}
+
+static bool read_int (cache_reader& reader, int* value)
+{
+  const int* values = read_ints (reader, 1);
+  if (! values) {
+    return false;
+  }
+  *value = *values;
+  return true;
+}
+
+static bool read_index (cache_reader& reader, index_t* value)
+{
+  const index_t* values = read_indices (reader, 1);
+  if (! values) {
+    return false;
+  }
+  *value = *values;
+  return true;
+}
+
+static bool read_string (cache_reader& reader, std::string* s)
+{
+  int size;
+  if (! read_int (reader, &size) || size < 0) {
+    return false;
+  }
+  const int* chars = read_ints (reader, (size + sizeof(int) - 1) / sizeof(int));
+  if (! chars) {
+    return false;
+  }
+  s->assign ((const char*)chars, size);
+  return true;
+}
+
+static bool valid_indices (const index_t* values, index_t size, index_t bound)
+{
+  for (index_t i = 0; i < size; i++) {
+    if (values[i] < 0 || values[i] >= bound) {
+      return false;
+    }
+  }
+  return true;
+}
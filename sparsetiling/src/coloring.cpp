@@ -3,26 +3,31 @@
  *
  */
 
+#include <limits.h>
+
 #include <set>
+#include <vector>
 #include <algorithm>
 
 #include "coloring.h"
 #include "utils.h"
 
-static int* color_apply (tile_list* tiles, map_t* tile2iter, int* colors)
+#define COLOR_BLOCK_SIZE 256
+
+static index_t* color_apply (tile_list* tiles, map_t* tile2iter, int* colors)
 {
   // aliases
-  int itSetSize = tile2iter->outSet->size;
+  index_t itSetSize = tile2iter->outSet->size;
   int nTiles = tile2iter->inSet->size;
 
-  int* iter2color = new int[itSetSize];
+  index_t* iter2color = new index_t[itSetSize];
 
   for (int i = 0; i < nTiles; i++ ) {
     // determine the tile iteration space
-    int prevOffset = tile2iter->offsets[i];
-    int nextOffset = tile2iter->offsets[i + 1];
+    index_t prevOffset = tile2iter->offsets[i];
+    index_t nextOffset = tile2iter->offsets[i + 1];
 
-    for (int j = prevOffset; j < nextOffset; j++) {
+    for (index_t j = prevOffset; j < nextOffset; j++) {
       iter2color[tile2iter->values[j]] = colors[i];
     }
     tiles->at(i)->color = colors[i];
@@ -45,13 +50,14 @@ void color_sequential (inspector_t* insp)
     colors[i] = i;
   }
 
-  map_t* tile2iter = map_invert (iter2tile, NULL);
-  int* iter2color = color_apply(tiles, tile2iter, colors);
+  map_t* tile2iter = map_invert_cached (iter2tile, insp->inverseMaps);
+  index_t* iter2color = color_apply(tiles, tile2iter, colors);
 
-  map_free (tile2iter, true);
   delete[] colors;
 
   // note we have as many colors as the number of tiles
+  // replace the coloring of a previous sweep, if any
+  map_free (insp->iter2color, true);
   insp->iter2color = map ("i2c", set_cpy(iter2tile->inSet), set("colors", nTiles),
                           iter2color, iter2tile->inSet->size*1);
 }
@@ -72,13 +78,14 @@ void color_rand (inspector_t* insp)
   }
   std::random_shuffle (colors, colors + nCore);
 
-  map_t* tile2iter = map_invert (iter2tile, NULL);
-  int* iter2color = color_apply(tiles, tile2iter, colors);
+  map_t* tile2iter = map_invert_cached (iter2tile, insp->inverseMaps);
+  index_t* iter2color = color_apply(tiles, tile2iter, colors);
 
-  map_free (tile2iter, true);
   delete[] colors;
 
   // note we have as many colors as the number of tiles
+  // replace the coloring of a previous sweep, if any
+  map_free (insp->iter2color, true);
   insp->iter2color = map ("i2c", set_cpy(iter2tile->inSet), set("colors", nTiles),
                           iter2color, iter2tile->inSet->size*1);
 }
@@ -106,115 +113,389 @@ void color_fully_parallel (inspector_t* insp)
     }
   }
 
-  map_t* tile2iter = map_invert (iter2tile, NULL);
-  int* iter2color = color_apply(tiles, tile2iter, colors);
+  map_t* tile2iter = map_invert_cached (iter2tile, insp->inverseMaps);
+  index_t* iter2color = color_apply(tiles, tile2iter, colors);
 
-  map_free (tile2iter, true);
   delete[] colors;
 
+  // replace the coloring of a previous sweep, if any
+  map_free (insp->iter2color, true);
   insp->iter2color = map ("i2c", set_cpy(iter2tile->inSet), set("colors", nTiles),
                           iter2color, iter2tile->inSet->size*1);
 }
 
-void color_diff_adj (inspector_t* insp, map_t* seedMap,
+map_t* color_tile_graph (inspector_t* insp, map_t* seedMap)
+{
+  // aliases
+  map_t* iter2tile = insp->iter2tile;
+  int nTiles = iter2tile->outSet->size;
+  index_t* seedIndMap = seedMap->values;
+
+  map_t* tile2iter = map_invert_cached (iter2tile, insp->inverseMaps);
+
+  // the elements touched by each tile, through /seedMap/
+  index_t* tile2elemOffsets = new index_t[nTiles + 1];
+  index_t* tile2elem = NULL;
+  tile2elemOffsets[0] = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    #pragma omp parallel
+    {
+      std::vector<index_t> elements;
+      #pragma omp for schedule(dynamic, 16)
+      for (int i = 0; i < nTiles; i++) {
+        elements.clear();
+        for (index_t e = tile2iter->offsets[i]; e < tile2iter->offsets[i + 1]; e++) {
+          index_t offset;
+          int size;
+          map_ofs (seedMap, tile2iter->values[e], &offset, &size);
+          for (int j = 0; j < size; j++) {
+            if (seedIndMap[offset + j] != -1) {
+              elements.push_back (seedIndMap[offset + j]);
+            }
+          }
+        }
+        std::sort (elements.begin(), elements.end());
+        index_t size = std::unique (elements.begin(), elements.end()) - elements.begin();
+        if (! tile2elem) {
+          tile2elemOffsets[i + 1] = size;
+        }
+        else {
+          std::copy (elements.begin(), elements.begin() + size, tile2elem + tile2elemOffsets[i]);
+        }
+      }
+    }
+    if (! tile2elem) {
+      for (int i = 0; i < nTiles; i++) {
+        tile2elemOffsets[i + 1] += tile2elemOffsets[i];
+      }
+      tile2elem = new index_t[tile2elemOffsets[nTiles]];
+    }
+  }
+
+  // two tiles are adjacent if they touch a same element
+  map_t* tile2elemMap = imap ("t2e", set_cpy(iter2tile->outSet), set_cpy(seedMap->outSet),
+                              tile2elem, tile2elemOffsets);
+  index_t* offsets;
+  index_t* adjncy;
+  map_line_graph (tile2elemMap, nTiles, &offsets, &adjncy);
+  map_free (tile2elemMap, true);
+
+  return imap ("t2t", set_cpy(iter2tile->outSet), set_cpy(iter2tile->outSet),
+               adjncy, offsets);
+}
+
+/*
+ * Add to the tile adjacency graph /tileGraph/ the conflicts in /conflictsTracker/,
+ * that is pairs of tiles that must not be assigned the same color even though
+ * they are not adjacent. The conflicts are also transposed, so the resulting graph,
+ * returned in CSR format, is symmetric even if the tracker is not.
+ */
+static void add_conflicts (map_t* tileGraph, tracker_t* conflictsTracker,
+                           int** offsets, int** adjncy)
+{
+  // aliases
+  int nTiles = tileGraph->inSet->size;
+  index_t* adjOffsets = tileGraph->offsets;
+  index_t* adj = tileGraph->values;
+  int* conflictOffsets = conflictsTracker->offsets.data();
+  int* conflicts = conflictsTracker->adjncy.data();
+
+  int* conflictsTOffsets = new int[nTiles + 1]();
+  int* conflictsT = new int[conflictOffsets[nTiles]];
+  for (int k = 0; k < conflictOffsets[nTiles]; k++) {
+    conflictsTOffsets[conflicts[k] + 1]++;
+  }
+  for (int i = 0; i < nTiles; i++) {
+    conflictsTOffsets[i + 1] += conflictsTOffsets[i];
+  }
+  int* inserted = new int[nTiles]();
+  for (int i = 0; i < nTiles; i++) {
+    for (int k = conflictOffsets[i]; k < conflictOffsets[i + 1]; k++) {
+      conflictsT[conflictsTOffsets[conflicts[k]] + inserted[conflicts[k]]++] = i;
+    }
+  }
+  delete[] inserted;
+
+  int* tileOffsets = new int[nTiles + 1];
+  int* tileAdjncy = NULL;
+  tileOffsets[0] = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    #pragma omp parallel
+    {
+      std::vector<int> neighbours;
+      #pragma omp for schedule(static)
+      for (int i = 0; i < nTiles; i++) {
+        neighbours.assign (adj + adjOffsets[i], adj + adjOffsets[i + 1]);
+        neighbours.insert (neighbours.end(), conflicts + conflictOffsets[i],
+                           conflicts + conflictOffsets[i + 1]);
+        neighbours.insert (neighbours.end(), conflictsT + conflictsTOffsets[i],
+                           conflictsT + conflictsTOffsets[i + 1]);
+        std::sort (neighbours.begin(), neighbours.end());
+        neighbours.erase (std::unique (neighbours.begin(), neighbours.end()), neighbours.end());
+        neighbours.erase (std::remove (neighbours.begin(), neighbours.end(), i), neighbours.end());
+        if (! tileAdjncy) {
+          tileOffsets[i + 1] = neighbours.size();
+        }
+        else {
+          std::copy (neighbours.begin(), neighbours.end(), tileAdjncy + tileOffsets[i]);
+        }
+      }
+    }
+    if (! tileAdjncy) {
+      for (int i = 0; i < nTiles; i++) {
+        tileOffsets[i + 1] += tileOffsets[i];
+      }
+      tileAdjncy = new int[tileOffsets[nTiles]];
+    }
+  }
+
+  delete[] conflictsTOffsets;
+  delete[] conflictsT;
+
+  *offsets = tileOffsets;
+  *adjncy = tileAdjncy;
+}
+
+/*
+ * Return the color, among those with fewer than /maxCount/ tiles, not used by
+ * any of the core neighbours of tile /i/ and holding the fewest tiles, or -1 if
+ * there is no such color. Empty colors and /exclude/ are never returned.
+ */
+static int find_move (int i, int nCore, int* offsets, int* adjncy, int* colors,
+                      std::vector<int>& count, int exclude, int maxCount,
+                      std::vector<int>& forbidden)
+{
+  for (int j = offsets[i]; j < offsets[i + 1]; j++) {
+    if (adjncy[j] < nCore) {
+      forbidden[colors[adjncy[j]]] = i;
+    }
+  }
+  int best = -1;
+  int nColors = count.size();
+  for (int c = 0; c < nColors; c++) {
+    if (c != exclude && forbidden[c] != i && count[c] > 0 && count[c] < maxCount &&
+        (best == -1 || count[c] < count[best])) {
+      best = c;
+    }
+  }
+  return best;
+}
+
+/*
+ * Move core tiles across colors so that the number of tiles per color is as
+ * even as possible, without ever assigning the same color to two adjacent tiles.
+ * First, the colors with fewer than /minTiles/ tiles are merged into the others,
+ * if all of their tiles can be moved; then, tiles are moved from the colors
+ * above the average size to those below. Return the number of core colors.
+ */
+static int color_balance (int nCore, int* offsets, int* adjncy, int* colors,
+                          int nColors, int minTiles)
+{
+  std::vector<int> count (nColors, 0);
+  std::vector<std::vector<int> > members (nColors);
+  for (int i = 0; i < nCore; i++) {
+    count[colors[i]]++;
+    members[colors[i]].push_back (i);
+  }
+  std::vector<int> forbidden (nColors, -1);
+
+  // merge the small colors into the others, starting from the smallest
+  std::vector<std::pair<int, int> > order;
+  int nCoreColors = 0;
+  for (int c = 0; c < nColors; c++) {
+    order.push_back (std::make_pair (count[c], c));
+    nCoreColors += count[c] > 0;
+  }
+  std::sort (order.begin(), order.end());
+  for (int k = 0; k < nColors && nCoreColors > 1; k++) {
+    int c = order[k].second;
+    if (count[c] == 0 || count[c] >= minTiles) {
+      continue;
+    }
+    std::vector<int> moved;
+    for (size_t m = 0; m < members[c].size(); m++) {
+      int i = members[c][m];
+      if (colors[i] != c) {
+        continue;
+      }
+      int dest = find_move (i, nCore, offsets, adjncy, colors, count, c, INT_MAX, forbidden);
+      if (dest == -1) {
+        break;
+      }
+      colors[i] = dest;
+      count[c]--;
+      count[dest]++;
+      members[dest].push_back (i);
+      moved.push_back (i);
+    }
+    if (count[c] > 0) {
+      // not all tiles could be moved, so the color is kept as it was
+      for (int m = moved.size() - 1; m >= 0; m--) {
+        int i = moved[m];
+        count[colors[i]]--;
+        members[colors[i]].pop_back();
+        colors[i] = c;
+        count[c]++;
+      }
+    }
+    else {
+      nCoreColors--;
+    }
+  }
+
+  // renumber the remaining colors, preserving their order
+  std::vector<int> newColor (nColors, -1);
+  std::vector<int> newCount;
+  for (int c = 0; c < nColors; c++) {
+    if (count[c] > 0) {
+      newColor[c] = newCount.size();
+      newCount.push_back (count[c]);
+    }
+  }
+  for (int i = 0; i < nCore; i++) {
+    colors[i] = newColor[colors[i]];
+  }
+  count.swap (newCount);
+  if (nCoreColors == 0) {
+    return 0;
+  }
+
+  // move tiles from the colors above the average size to those below
+  int target = (nCore + nCoreColors - 1) / nCoreColors;
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < nCore; i++) {
+      int c = colors[i];
+      if (count[c] <= target) {
+        continue;
+      }
+      int dest = find_move (i, nCore, offsets, adjncy, colors, count, c, target, forbidden);
+      if (dest != -1) {
+        colors[i] = dest;
+        count[c]--;
+        count[dest]++;
+      }
+    }
+  }
+
+  return nCoreColors;
+}
+
+void color_diff_adj (inspector_t* insp, map_t* tileGraph,
                      tracker_t* conflictsTracker, bool onlyCore)
 {
   // aliases
   tile_list* tiles = insp->tiles;
   map_t* iter2tile = insp->iter2tile;
   int nTiles = tiles->size();
-  int seedSetSize = seedMap->inSet->size;
-  int outSetSize = seedMap->outSet->size;
-  int* seedIndMap = seedMap->values;
+  index_t seedSetSize = iter2tile->inSet->size;
+
+  map_t* tile2iter = map_invert_cached (iter2tile, insp->inverseMaps);
 
-  map_t* tile2iter = map_invert (iter2tile, NULL);
+  int* offsets;
+  int* adjncy;
+  add_conflicts (tileGraph, conflictsTracker, &offsets, &adjncy);
 
   // init colors
   int* colors = new int[nTiles];
   std::fill_n (colors, nTiles, -1);
 
-  bool repeat = true;
-  int nColor = 0;
-  int nColors = 0;
-
-  // array to work out the colors
-  int* work = new int[outSetSize];
-
-  // coloring algorithm
-  while (repeat)
-  {
-    repeat = false;
-
-    // zero out color array
-    std::fill_n (work, outSetSize, 0);
+  // speculative coloring: the tiles to be colored are split into blocks of
+  // COLOR_BLOCK_SIZE consecutive tiles, which are colored in parallel. Within a
+  // block, tiles are colored greedily in order, taking the smallest color not used
+  // by neighbours that are either already colored or earlier in the same block.
+  // Adjacent tiles in different blocks may end up with the same color: the one
+  // coming later is then colored again in the next round. Since blocks do not
+  // depend on the number of threads, neither does the coloring
+  std::vector<int> pending (nTiles);
+  std::vector<int> position (nTiles, -1);
+  std::vector<char> recolor (nTiles);
+  for (int i = 0; i < nTiles; i++) {
+    pending[i] = i;
+  }
+  while (! pending.empty()) {
+    int nPending = pending.size();
+    int nBlocks = (nPending + COLOR_BLOCK_SIZE - 1) / COLOR_BLOCK_SIZE;
+    for (int k = 0; k < nPending; k++) {
+      position[pending[k]] = k;
+    }
 
-    // start coloring tiles
-    for (int i = 0; i < nTiles; i++)
+    #pragma omp parallel
     {
-      // determine the tile iteration space
-      int prevOffset = tile2iter->offsets[i];
-      int nextOffset = tile2iter->offsets[i + 1];
-
-      if (colors[i] == -1)
-      {
-        unsigned int mask = 0;
-
-        // prevent tiles that are known to conflict if a "standard" coloring is
-        // employed from being assigned the same color. For this, access the color,
-        // in the work array, of the first iteration of each conflicting tile
-        index_set tileConflicts = (*conflictsTracker)[i];
-        index_set::const_iterator it, end;
-        for (it = tileConflicts.begin(), end = tileConflicts.end(); it != end; it++) {
-          int offset, size, element = tile2iter->offsets[*it];
-          map_ofs(seedMap, element, &offset, &size);
-          mask |= work[seedIndMap[offset + 0]];
-
-          // When the frontier of a tile expands (at most k vertices), the given conflicts
-          // cannot be captured by considering the adjacent tiles in the seed loop's iteration space.
-          // Hence the colors of the conflicting tiles are added to the mask, in case they are not
-          // adjacent in the seed loop's iteration space.
-          if(colors[*it] != -1){
-            mask |= 1 << colors[*it];
+      // the colors used by the neighbours of tile /i/ are marked with /i/
+      std::vector<int> forbidden;
+      #pragma omp for schedule(dynamic, 1)
+      for (int b = 0; b < nBlocks; b++) {
+        int blockStart = b*COLOR_BLOCK_SIZE;
+        int blockEnd = MIN(blockStart + COLOR_BLOCK_SIZE, nPending);
+        for (int k = blockStart; k < blockEnd; k++) {
+          int i = pending[k];
+          int degree = offsets[i + 1] - offsets[i];
+          if (forbidden.size() < (size_t)degree + 1) {
+            forbidden.resize (degree + 1, -1);
           }
-        }
-
-        for (int e = prevOffset; e < nextOffset; e++) {
-          int offset, size, element = tile2iter->values[e];
-          map_ofs(seedMap, element, &offset, &size);
-          for (int j = 0; j < size; j++) {
-            // set bits of mask
-            mask |= work[seedIndMap[offset + j]];
+          for (int j = offsets[i]; j < offsets[i + 1]; j++) {
+            int p = position[adjncy[j]];
+            if (p != -1 && (p < blockStart || p >= k)) {
+              // colored in this round, but by another block, or not colored yet
+              continue;
+            }
+            int color = colors[adjncy[j]];
+            if (color <= degree) {
+              forbidden[color] = i;
+            }
+          }
+          int color = 0;
+          while (forbidden[color] == i) {
+            color++;
           }
+          colors[i] = color;
         }
+      }
 
-        // find first bit not set
-        int color = ffs(~mask) - 1;
-        if (color == -1) {
-          // run out of colors on this pass
-          repeat = true;
-        }
-        else
-        {
-          colors[i] = nColor + color;
-          mask = 1 << color;
-          nColors = MAX(nColors, nColor + color + 1);
-          for (int e = prevOffset; e < nextOffset; e++) {
-            int offset, size, element = tile2iter->values[e];
-            map_ofs(seedMap, element, &offset, &size);
-            for (int j = 0; j < size; j++) {
-              work[seedIndMap[offset + j]] |= mask;
-            }
-          }
+      // find the conflicts between blocks
+      #pragma omp for schedule(static)
+      for (int k = 0; k < nPending; k++) {
+        int i = pending[k];
+        int blockStart = k - k % COLOR_BLOCK_SIZE;
+        recolor[k] = false;
+        for (int j = offsets[i]; j < offsets[i + 1] && ! recolor[k]; j++) {
+          int p = position[adjncy[j]];
+          recolor[k] = p != -1 && p < blockStart && colors[adjncy[j]] == colors[i];
         }
       }
     }
-    // increment base level
-    nColor += 32;
+
+    // the tiles in conflict are colored again in the next round
+    int nConflicts = 0;
+    for (int k = 0; k < nPending; k++) {
+      position[pending[k]] = -1;
+      if (recolor[k]) {
+        pending[nConflicts++] = pending[k];
+      }
+    }
+    pending.resize (nConflicts);
+  }
+  int nColors = 0;
+  for (int i = 0; i < nTiles; i++) {
+    nColors = MAX(nColors, colors[i] + 1);
   }
 
+  // even out the number of tiles per color, so that each color, if possible,
+  // keeps all threads busy
+  set_t* tileRegions = insp->tileRegions;
+  if (insp->coloring == COL_BALANCED) {
+    color_balance (tileRegions->core, offsets, adjncy, colors, nColors, insp->nThreads);
+    nColors = 0;
+    for (int i = 0; i < nTiles; i++) {
+      nColors = MAX(nColors, colors[i] + 1);
+    }
+  }
+
+  delete[] offsets;
+  delete[] adjncy;
+
   // shift up the halo tile colors, since these tiles must be executed after all core tiles
   int maxExecHaloColor = nColors;
-  set_t* tileRegions = insp->tileRegions;
   if (onlyCore) {
     for (int i = 0; i < tileRegions->execHalo; i++) {
       colors[tileRegions->core + i] = maxExecHaloColor++;
@@ -222,6 +503,8 @@ void color_diff_adj (inspector_t* insp, map_t* seedMap,
     maxExecHaloColor --;
   }
   else {
+    // without exec halo tiles, no color follows those of the core tiles
+    maxExecHaloColor = nColors - 1;
     for (int i = 0; i < tileRegions->execHalo; i++) {
       int newHaloColor = colors[tileRegions->core + i] + nColors;
       maxExecHaloColor = MAX(maxExecHaloColor, newHaloColor);
@@ -235,12 +518,96 @@ void color_diff_adj (inspector_t* insp, map_t* seedMap,
   nColors = maxExecHaloColor + 1;
 
   // create the iteration to colors map
-  int* iter2color = color_apply(tiles, tile2iter, colors);
+  index_t* iter2color = color_apply(tiles, tile2iter, colors);
 
-  delete[] work;
   delete[] colors;
-  map_free (tile2iter, true);
 
+  // replace the coloring of a previous sweep, if any
+  map_free (insp->iter2color, true);
   insp->iter2color = map ("i2c", set_cpy(iter2tile->inSet), set("colors", nColors),
                           iter2color, seedSetSize*1);
 }
+
+bool color_repair (inspector_t* insp, map_t* tileGraph, tracker_t* conflictsTracker,
+                   std::vector<index_t>& recolored)
+{
+  // aliases
+  tile_list* tiles = insp->tiles;
+  map_t* iter2color = insp->iter2color;
+  int nTiles = tiles->size();
+  int nCore = insp->tileRegions->core;
+
+  map_t* tile2iter = map_invert_cached (insp->iter2tile, insp->inverseMaps);
+
+  int* offsets;
+  int* adjncy;
+  add_conflicts (tileGraph, conflictsTracker, &offsets, &adjncy);
+
+  // the halo tiles must keep being executed after all core tiles
+  int haloColor = INT_MAX;
+  std::vector<int> colors (nTiles);
+  for (int i = 0; i < nTiles; i++) {
+    colors[i] = tiles->at(i)->color;
+    if (i >= nCore) {
+      haloColor = MIN(haloColor, colors[i]);
+    }
+  }
+
+  // recolor greedily, in order, the tiles having the same color as a neighbour;
+  // the colors used by the neighbours of tile /i/ are marked with /i/
+  std::vector<int> toRecolor;
+  std::vector<int> forbidden;
+  bool repaired = true;
+  for (int i = 0; i < nTiles && repaired; i++) {
+    bool clash = false;
+    for (int j = offsets[i]; j < offsets[i + 1] && ! clash; j++) {
+      clash = colors[adjncy[j]] == colors[i];
+    }
+    if (! clash) {
+      continue;
+    }
+    int degree = offsets[i + 1] - offsets[i];
+    if (forbidden.size() < (size_t)degree + 1) {
+      forbidden.resize (degree + 1, -1);
+    }
+    for (int j = offsets[i]; j < offsets[i + 1]; j++) {
+      int color = colors[adjncy[j]];
+      if (color <= degree) {
+        forbidden[color] = i;
+      }
+    }
+    int color = 0;
+    while (forbidden[color] == i) {
+      color++;
+    }
+    repaired = i < nCore && color < haloColor;
+    colors[i] = color;
+    toRecolor.push_back (i);
+  }
+
+  delete[] offsets;
+  delete[] adjncy;
+
+  if (! repaired) {
+    return false;
+  }
+
+  // recolor the seed loop iterations of the tiles concerned
+  int nColors = iter2color->outSet->size;
+  recolored.clear();
+  for (size_t k = 0; k < toRecolor.size(); k++) {
+    int i = toRecolor[k];
+    tiles->at(i)->color = colors[i];
+    for (index_t j = tile2iter->offsets[i]; j < tile2iter->offsets[i + 1]; j++) {
+      iter2color->values[tile2iter->values[j]] = colors[i];
+      recolored.push_back (tile2iter->values[j]);
+    }
+    nColors = MAX(nColors, colors[i] + 1);
+  }
+  if (nColors > iter2color->outSet->size) {
+    set_free (iter2color->outSet);
+    iter2color->outSet = set ("colors", nColors);
+  }
+
+  return true;
+}
@@ -3,13 +3,37 @@
  *
  */
 
+#include <algorithm>
+#include <deque>
+
+#include <string.h>
+#include <sched.h>
+
+#ifdef SLOPE_OMP
+#include <omp.h>
+#endif
+
 #include "executor.h"
 #include "utils.h"
 
-executor_t* exec_init (inspector_t* insp)
+// a queue of tiles ready for execution, owned by a thread
+typedef struct {
+  std::deque<int> tiles;
+#ifdef SLOPE_OMP
+  omp_lock_t lock;
+#endif
+} tile_queue;
+
+// prototypes of static functions
+static void run_dag (executor_t* exec, tile_kernel kernel, void* args);
+static void queue_push (tile_queue* queue, int tile);
+static int queue_pop (tile_queue* queue, bool steal);
+
+executor_t* exec_init (inspector_t* insp, exec_mode mode)
 {
   // aliases
   tile_list* tiles = insp->tiles;
+  loop_list* loops = insp->loops;
   int nTiles = tiles->size();
   set_t* tileSet = set_cpy (insp->iter2tile->outSet);
   set_t* colorSet = set_cpy (insp->iter2color->outSet);
@@ -17,7 +41,7 @@ executor_t* exec_init (inspector_t* insp)
   executor_t* exec = new executor_t;
 
   // compute a map from colors to tiles IDs
-  int* tile2colorIndMap = new int[nTiles];
+  index_t* tile2colorIndMap = new index_t[nTiles];
   for (int i = 0; i < nTiles; i++) {
     tile2colorIndMap[i] = tiles->at(i)->color;
   }
@@ -28,9 +52,138 @@ executor_t* exec_init (inspector_t* insp)
 
   map_free (tile2color, true);
 
+  // build the executor plans, in which tiles are stored by color
+  index_t* pos2tile = exec->color2tile->values;
+  int nLoops = loops->size();
+  exec->nLoops = nLoops;
+  exec->prefetchHalo = insp->prefetchHalo;
+  exec->regions = new tile_region[nTiles];
+  exec->plans = new exec_plan_t[nLoops];
+  for (int p = 0; p < nTiles; p++) {
+    exec->regions[p] = tiles->at(pos2tile[p])->region;
+  }
+  for (int i = 0; i < nLoops; i++) {
+    // the local maps of a loop are shared by all tiles
+    local_maps_t* tileMaps = nTiles ? tiles->at(0)->localMaps[i] : NULL;
+    std::vector<std::string> names;
+    std::vector<int> arities;
+    if (tileMaps) {
+      names.assign (tileMaps->names, tileMaps->names + tileMaps->nMaps);
+      arities.assign (tileMaps->arities, tileMaps->arities + tileMaps->nMaps);
+    }
+
+    index_t* offsets = new index_t[nTiles + 1];
+    offsets[0] = 0;
+    for (int p = 0; p < nTiles; p++) {
+      int tileID = pos2tile[p];
+      offsets[p + 1] = offsets[p] + tiles->at(tileID)->iterations[i]->size();
+    }
+
+    // the offsets of the irregular local maps are rebuilt in execution order:
+    // the elements of the tiles are prefix-summed in that order, and then each
+    // tile copies its offsets, shifted, in parallel
+    std::vector<index_t*> mapOffsets (names.size(), (index_t*)NULL);
+    index_t* tileStarts = new index_t[nTiles + 1];
+    for (size_t m = 0; m < names.size(); m++) {
+      if (! tileMaps->mapOffsets[m]) {
+        continue;
+      }
+      index_t* iterOffsets = new index_t[offsets[nTiles] + 1];
+      tileStarts[0] = 0;
+      for (int p = 0; p < nTiles; p++) {
+        int tileID = pos2tile[p];
+        tileStarts[p + 1] = tileStarts[p] + local_map_start (tileMaps, m, tileID + 1) -
+                            local_map_start (tileMaps, m, tileID);
+      }
+      iterOffsets[0] = 0;
+      #pragma omp parallel for schedule(static)
+      for (int p = 0; p < nTiles; p++) {
+        int tileID = pos2tile[p];
+        index_t* tileMapOffsets = tileMaps->mapOffsets[m] + tileMaps->offsets[tileID];
+        index_t start = tileStarts[p];
+        for (index_t e = 0; e < offsets[p + 1] - offsets[p]; e++) {
+          iterOffsets[offsets[p] + e + 1] = start + tileMapOffsets[e + 1] - tileMapOffsets[0];
+        }
+      }
+      mapOffsets[m] = iterOffsets;
+    }
+    delete[] tileStarts;
+    local_maps_t* localMaps = local_maps_init (nTiles, names, arities, offsets, &mapOffsets);
+    index_t* iterations = new index_t[offsets[nTiles]];
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int p = 0; p < nTiles; p++) {
+      int tileID = pos2tile[p];
+      iterations_list& tileIterations = *(tiles->at(tileID)->iterations[i]);
+      std::copy (tileIterations.begin(), tileIterations.end(), iterations + offsets[p]);
+      for (int m = 0; m < localMaps->nMaps; m++) {
+        std::copy (tileMaps->values[m] + local_map_start (tileMaps, m, tileID),
+                   tileMaps->values[m] + local_map_start (tileMaps, m, tileID + 1),
+                   localMaps->values[m] + local_map_start (localMaps, m, p));
+      }
+    }
+
+    exec->plans[i].iterations = iterations;
+    exec->plans[i].localMaps = localMaps;
+  }
+
+  // in EXEC_DAG mode, renumber the DAG of tiles according to the execution order
+  exec->mode = mode;
+  exec->tileDag = NULL;
+  exec->nPredecessors = NULL;
+  if (mode == EXEC_DAG) {
+    map_t* tileDag = insp_tile_dag (insp);
+    int* tile2pos = new int[nTiles];
+    for (int p = 0; p < nTiles; p++) {
+      tile2pos[pos2tile[p]] = p;
+    }
+    index_t* offsets = new index_t[nTiles + 1];
+    index_t* successors = new index_t[tileDag->size];
+    int* nPredecessors = new int[nTiles]();
+    offsets[0] = 0;
+    for (int p = 0; p < nTiles; p++) {
+      int tileID = pos2tile[p];
+      int nSuccessors = tileDag->offsets[tileID + 1] - tileDag->offsets[tileID];
+      for (int k = 0; k < nSuccessors; k++) {
+        int successor = tile2pos[tileDag->values[tileDag->offsets[tileID] + k]];
+        successors[offsets[p] + k] = successor;
+        nPredecessors[successor]++;
+      }
+      offsets[p + 1] = offsets[p] + nSuccessors;
+    }
+    exec->tileDag = imap ("tile_dag", set_cpy(tileDag->inSet), set_cpy(tileDag->outSet),
+                          successors, offsets);
+    exec->nPredecessors = nPredecessors;
+    delete[] tile2pos;
+    map_free (tileDag, true);
+  }
+
+  // the tiles are now owned by the executor
+  insp->tiles = NULL;
+
   return exec;
 }
 
+void exec_run (executor_t* exec, tile_kernel kernel, void* args)
+{
+  ASSERT(exec != NULL, "Invalid NULL pointer to executor");
+
+  if (exec->mode == EXEC_DAG) {
+    run_dag (exec, kernel, args);
+    return;
+  }
+
+  int nColors = exec_num_colors (exec);
+  for (int i = 0; i < nColors; i++) {
+    const int nTilesPerColor = exec_tiles_per_color (exec, i);
+
+    #pragma omp parallel for
+    for (int j = 0; j < nTilesPerColor; j++) {
+      kernel (exec, i, j, args);
+    }
+  }
+}
+
 int exec_num_colors (executor_t* exec)
 {
   ASSERT(exec != NULL, "Invalid NULL pointer to executor");
@@ -42,25 +195,187 @@ int exec_tiles_per_color (executor_t* exec, int color)
 {
   ASSERT ((color >= 0) && (color < exec_num_colors(exec)), "Invalid color provided");
 
-  int* offsets = exec->color2tile->offsets;
+  index_t* offsets = exec->color2tile->offsets;
   return offsets[color + 1] - offsets[color];
 }
 
 tile_t* exec_tile_at (executor_t* exec, int color, int ithTile, tile_region region)
 {
+  ASSERT(exec->tiles != NULL, "Tiles already freed");
+
   int tileID = exec->color2tile->values[exec->color2tile->offsets[color] + ithTile];
   tile_t* tile = exec->tiles->at (tileID);
   return (tile->region == region) ? tile : NULL;
 }
 
-void exec_free (executor_t* exec)
+int exec_map_handle (executor_t* exec, int loopIndex, std::string mapName)
+{
+  ASSERT((loopIndex >= 0) && (loopIndex < exec->nLoops), "Invalid loop index");
+
+  local_maps_t* localMaps = exec->plans[loopIndex].localMaps;
+  for (int m = 0; m < localMaps->nMaps; m++) {
+    if (localMaps->names[m] == mapName) {
+      return m;
+    }
+  }
+  return -1;
+}
+
+exec_plan_t* exec_plan (executor_t* exec, int loopIndex)
+{
+  ASSERT((loopIndex >= 0) && (loopIndex < exec->nLoops), "Invalid loop index");
+
+  return exec->plans + loopIndex;
+}
+
+void exec_free_tiles (executor_t* exec)
 {
   tile_list* tiles = exec->tiles;
+  if (! tiles) {
+    return;
+  }
   tile_list::const_iterator it, end;
   for (it = tiles->begin(), end = tiles->end(); it != end; it++) {
     tile_free (*it);
   }
   delete tiles;
+  exec->tiles = NULL;
+}
+
+void exec_free (executor_t* exec)
+{
+  exec_free_tiles (exec);
+  for (int i = 0; i < exec->nLoops; i++) {
+    delete[] exec->plans[i].iterations;
+    local_maps_free (exec->plans[i].localMaps);
+  }
+  delete[] exec->plans;
+  delete[] exec->regions;
+  delete[] exec->nPredecessors;
+  map_free (exec->tileDag, true);
   map_free (exec->color2tile, true);
   delete exec;
 }
+
+
+/***** Static / utility functions *****/
+
+static void run_dag (executor_t* exec, tile_kernel kernel, void* args)
+{
+  // aliases
+  int nTiles = exec->tileDag->inSet->size;
+  index_t* offsets = exec->tileDag->offsets;
+  index_t* successors = exec->tileDag->values;
+  index_t* colorOffsets = exec->color2tile->offsets;
+  int nColors = exec_num_colors (exec);
+
+  // the color of each tile, and the number of tiles it is still waiting for
+  int* colors = new int[nTiles];
+  for (int i = 0; i < nColors; i++) {
+    std::fill (colors + colorOffsets[i], colors + colorOffsets[i + 1], i);
+  }
+  int* waiting = new int[nTiles];
+  memcpy (waiting, exec->nPredecessors, sizeof(int)*nTiles);
+  int executed = 0;
+
+  int nThreads = 1;
+#ifdef SLOPE_OMP
+  nThreads = omp_get_max_threads();
+#endif
+  tile_queue* queues = new tile_queue[nThreads];
+#ifdef SLOPE_OMP
+  for (int i = 0; i < nThreads; i++) {
+    omp_init_lock (&queues[i].lock);
+  }
+#endif
+
+  // the tiles without predecessors are ready straight away
+  for (int p = 0, i = 0; p < nTiles; p++) {
+    if (! waiting[p]) {
+      queue_push (&queues[i++ % nThreads], p);
+    }
+  }
+
+  #pragma omp parallel num_threads(nThreads)
+  {
+    int thread = 0;
+#ifdef SLOPE_OMP
+    thread = omp_get_thread_num();
+#endif
+    while (true) {
+      // take the most recently readied tile, or steal the oldest from another
+      // thread (including queues of threads that might not have been spawned)
+      int p = queue_pop (&queues[thread], false);
+      for (int k = 1; p == -1 && k < nThreads; k++) {
+        p = queue_pop (&queues[(thread + k) % nThreads], true);
+      }
+      if (p == -1) {
+        int nExecuted;
+        #pragma omp atomic read seq_cst
+        nExecuted = executed;
+        if (nExecuted == nTiles) {
+          break;
+        }
+        // nothing to steal: give up the core rather than spinning on the locks
+        sched_yield();
+        continue;
+      }
+
+      kernel (exec, colors[p], p - colorOffsets[colors[p]], args);
+
+      for (int k = offsets[p]; k < offsets[p + 1]; k++) {
+        int successor = successors[k];
+        int nWaiting;
+        #pragma omp atomic capture seq_cst
+        nWaiting = --waiting[successor];
+        if (! nWaiting) {
+          queue_push (&queues[thread], successor);
+        }
+      }
+      #pragma omp atomic update seq_cst
+      executed++;
+    }
+  }
+
+#ifdef SLOPE_OMP
+  for (int i = 0; i < nThreads; i++) {
+    omp_destroy_lock (&queues[i].lock);
+  }
+#endif
+  delete[] queues;
+  delete[] waiting;
+  delete[] colors;
+}
+
+static void queue_push (tile_queue* queue, int tile)
+{
+#ifdef SLOPE_OMP
+  omp_set_lock (&queue->lock);
+#endif
+  queue->tiles.push_back (tile);
+#ifdef SLOPE_OMP
+  omp_unset_lock (&queue->lock);
+#endif
+}
+
+static int queue_pop (tile_queue* queue, bool steal)
+{
+  int tile = -1;
+#ifdef SLOPE_OMP
+  omp_set_lock (&queue->lock);
+#endif
+  if (! queue->tiles.empty()) {
+    if (steal) {
+      tile = queue->tiles.front();
+      queue->tiles.pop_front();
+    }
+    else {
+      tile = queue->tiles.back();
+      queue->tiles.pop_back();
+    }
+  }
+#ifdef SLOPE_OMP
+  omp_unset_lock (&queue->lock);
+#endif
+  return tile;
+}
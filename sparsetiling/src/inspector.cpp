@@ -5,6 +5,8 @@
  */
 
 #include <string>
+#include <algorithm>
+#include <set>
 
 #ifdef SLOPE_OMP
 #include <omp.h>
@@ -22,17 +24,55 @@
 
 using namespace std;
 
+#define MAX_MERGES 8
+// loops tiled on either side of a candidate seed loop by a trial tiling sweep
+#define TRIAL_WINDOW 2
+
+/*
+ * Track how the seed loop has been re-partitioned to meet /insp->maxColors/
+ */
+typedef struct {
+  /* number of times tiles have been merged */
+  int nMerges;
+  /* the partitioning before splitting tiles, if tiles have just been split */
+  index_t* unsplit;
+  int unsplitCore;
+  /* number of colors with fewer tiles than threads before splitting tiles */
+  int nStarved;
+  /* true once no more re-partitioning is allowed */
+  bool done;
+  /* true if the last tiling has more colors than allowed */
+  bool missed;
+} reshape_t;
+
 
 // prototypes of static functions
 static int select_seed_loop (insp_strategy strategy, insp_coloring coloring,
                              loop_list* loops, int suggestedSeed);
 static void print_tiled_loop (tile_list* tiles, loop_t* loop, int verbosityTiles);
-static void compute_local_ind_maps(loop_list* loops, tile_list* tiles);
+static void compute_local_ind_maps(loop_list* loops, tile_list* tiles, insp_stats_t* stats);
+static bool reshape_tiles (inspector_t* insp, map_t* tileGraph, reshape_t* reshape);
+static int auto_seed_loop (inspector_t* insp);
+static void tile_growth (inspector_t* insp, double* growthFwd, double* growthBwd,
+                         int window = -1);
+static bool tile_sweep (inspector_t* insp, map_t** tileGraph,
+                        tracker_t* crossSweepConflictsTracker, trace_t* trace = NULL,
+                        int window = -1);
+static bool repair_conflicts (inspector_t* insp, map_t* tileGraph,
+                              tracker_t* crossSweepConflictsTracker, trace_t* trace,
+                              bool* foundConflicts);
+static void track_projections (insp_stats_t* stats, projection_t* prevLoopProj,
+                               projection_t* seedLoopProj,
+                               std::map<std::string, schedule_t*>* known,
+                               bool allocated = true);
+static void track_tiles (insp_stats_t* stats, tile_list* tiles, int loopIndex);
 
 
 inspector_t* insp_init (int avgTileSize, insp_strategy strategy, insp_coloring coloring,
                         map_list* meshMaps, map_list* partitionings, int prefetchHalo,
-                        bool ignoreWAR, string name)
+                        bool ignoreWAR, string name, insp_partitioning partitioning,
+                        double* coordinates, dimension meshDim, int maxColors,
+                        bool repairConflicts)
 {
   inspector_t* insp = new inspector_t;
 
@@ -45,15 +85,32 @@ inspector_t* insp_init (int avgTileSize, insp_strategy strategy, insp_coloring c
   insp->iter2tile = NULL;
   insp->iter2color = NULL;
   insp->tiles = NULL;
+  insp->tileRegions = NULL;
   insp->nSweeps = 0;
   insp->partitioningMode = "";
 
   insp->totalInspectionTime = 0.0;
   insp->partitioningTime = 0.0;
+  insp->stats = stats_init();
+
+  insp->autoSeed = false;
+  insp->predictedGrowthFwd = 0.0;
+  insp->predictedGrowthBwd = 0.0;
+  insp->predictedConflicts = 0.0;
+  insp->nConflicts = 0;
+  insp->repairConflicts = repairConflicts;
+  insp->nRepairs = 0;
+  insp->nRetiled = 0;
+  insp->repairTime = 0.0;
 
   insp->coloring = coloring;
+  insp->maxColors = maxColors;
   insp->meshMaps = meshMaps;
   insp->partitionings = partitionings;
+  insp->partitioning = partitioning;
+  insp->coordinates = coordinates;
+  insp->meshDim = meshDim;
+  insp->inverseMaps = inverse_maps_init();
 
   insp->prefetchHalo = prefetchHalo;
 
@@ -96,34 +153,54 @@ insp_info insp_run (inspector_t* insp, int suggestedSeed)
   insp_strategy strategy = insp->strategy;
   loop_list* loops = insp->loops;
   int nLoops = loops->size();
-  bool ignoreWAR = insp->ignoreWAR;
 
   // start timing the inspection
   double start = time_stamp();
+  insp_stats_t* stats = insp->stats;
+  stats_reset (stats, loops);
 
-  // establish the seed loop
-  int seed = select_seed_loop (strategy, coloring, loops, suggestedSeed);
-  insp->seed = seed;
-  loop_t* seedLoop = loops->at(seed);
-  ASSERT(!seedLoop->set->superset || nLoops == 1, "Seed loop cannot be a subset");
-  string seedLoopSetName = seedLoop->set->name;
-  int seedLoopSetSize = seedLoop->set->size;
+  // discard the results of a previous inspection, if any, so that the same
+  // inspector can be run again (e.g., with a different tile size)
+  partition_free (insp);
+  insp->nSweeps = 0;
+  insp->nConflicts = 0;
+  insp->autoSeed = false;
+  insp->predictedGrowthFwd = 0.0;
+  insp->predictedGrowthBwd = 0.0;
+  insp->predictedConflicts = 0.0;
 
   // try load an indirection map for all loops - especially direct loops - as
-  // this may be used for a more sensible tiling when no projections are available
+  // this may be used for a more sensible tiling when no projections are available.
+  // Maps loaded by a previous inspection are kept
   loop_list::const_iterator lIt, lEnd;
   for (lIt = loops->begin(), lEnd = loops->end(); lIt != lEnd; lIt++) {
-    if (! set_super((*lIt)->set)) {
+    if (! set_super((*lIt)->set) && ! (*lIt)->seedMap) {
       loop_load_seed_map (*lIt, loops);
     }
   }
+  stats_time (stats, PHASE_SEED_MAPS, time_stamp() - start);
+
+  // establish the seed loop; the trial tiling sweeps run to select it are only
+  // accounted for in the seed selection phase
+  double startSeed = time_stamp();
+  insp->stats = NULL;
+  int seed = (suggestedSeed == SEED_AUTO) ? auto_seed_loop (insp) :
+             select_seed_loop (strategy, coloring, loops, suggestedSeed);
+  insp->stats = stats;
+  insp->seed = seed;
+  stats_time (stats, PHASE_SEED_SELECTION, time_stamp() - startSeed);
+  loop_t* seedLoop = loops->at(seed);
+  ASSERT(!seedLoop->set->superset || nLoops == 1, "Seed loop cannot be a subset");
 
-  // partition the seed loop iteration set into tiles
+  // partition the seed loop iteration set into tiles, unless the automatic
+  // selection of the seed loop already did
   double startPartitioning = time_stamp();
-  partition (insp);
+  if (! insp->tiles) {
+    partition (insp);
+  }
   double endPartitioning = time_stamp();
+  stats_time (stats, PHASE_PARTITIONING, endPartitioning - startPartitioning);
 
-  map_t* iter2tile = insp->iter2tile;
   tile_list* tiles = insp->tiles;
 
   // /crossSweepConflictsTracker/ tracks color conflicts due to tiling for shared
@@ -131,132 +208,198 @@ insp_info insp_run (inspector_t* insp, int suggestedSeed)
   // After each tiling sweep, it tracks, for each tile /i/, the tiles that, if assigned
   // the same color as /i/, would end up "touching" /i/ (i.e., the "conflicting" tiles),
   // leading to potential race conditions during shared memory parallel execution
-  tracker_t crossSweepConflictsTracker;
-  bool foundConflicts;
+  tracker_t* crossSweepConflictsTracker = tracker_init (tiles->size());
+  // the tile adjacency graph, computed only if needed by the seed coloring
+  map_t* tileGraph = NULL;
+  // the schedules computed by the last tiling sweep, kept to repair conflicts
+  trace_t* trace = insp->repairConflicts ? new trace_t : NULL;
+  reshape_t reshape = {0, NULL, 0, 0, false, false};
+  bool foundConflicts, reshaped;
+  insp->nRepairs = 0;
+  insp->nRetiled = 0;
+  insp->repairTime = 0.0;
   do {
-    // assume there are no color conflicts
-    foundConflicts = false;
+    foundConflicts = tile_sweep (insp, &tileGraph, crossSweepConflictsTracker, trace);
 
-    // color the seed loop iteration set
-    if (nLoops == 1 && loop_is_direct(seedLoop)) {
-      color_fully_parallel (insp);
-    }
-    else if (strategy == SEQUENTIAL || strategy == ONLY_MPI) {
-      if (coloring == COL_RAND) {
-        color_rand (insp);
-      }
-      else if (coloring == COL_MINCOLS) {
-        color_diff_adj (insp, seedLoop->seedMap, &crossSweepConflictsTracker, true);
-      }
-      else {
-        color_sequential (insp);
-      }
-    }
-    else if (strategy == OMP || strategy == OMP_MPI) {
-      color_diff_adj (insp, seedLoop->seedMap, &crossSweepConflictsTracker);
-    }
-    else {
-      ASSERT(false, "Cannot compute a seed coloring");
-    }
-    map_t* iter2color = insp->iter2color;
+    insp->nSweeps++;
 
-#ifdef SLOPE_VTK
-    // track coloring and tiling of a parloop. These can be used for debugging or
-    // visualization purpose, e.g. for generating VTK files.
-    seedLoop->tiling = new int[seedLoopSetSize];
-    seedLoop->coloring = new int[seedLoopSetSize];
-    memcpy (seedLoop->tiling, iter2tile->values, sizeof(int)*seedLoopSetSize);
-    memcpy (seedLoop->coloring, iter2color->values, sizeof(int)*seedLoopSetSize);
-#endif
+    // rather than performing another tiling sweep, try to repair the conflicts;
+    // a repair may find new conflicts, which are repaired in turn
+    bool repaired = true;
+    while (foundConflicts && repaired && trace && ! trace->empty()) {
+      repaired = repair_conflicts (insp, tileGraph, crossSweepConflictsTracker, trace,
+                                   &foundConflicts);
+    }
 
-    // create copies of seed tiling and coloring, which will be used for
-    // backward tiling (forward tiling uses and modifies the original copies)
-    int* tmpIter2tileMap = new int[seedLoopSetSize];
-    int* tmpIter2colorMap = new int[seedLoopSetSize];
-    memcpy (tmpIter2tileMap, iter2tile->values, sizeof(int)*seedLoopSetSize);
-    memcpy (tmpIter2colorMap, iter2color->values, sizeof(int)*seedLoopSetSize);
+    // once a legal tiling is found, check the number of colors. If the seed loop
+    // gets re-partitioned, tiling starts over, with no conflicts known
+    double startReshape = time_stamp();
+    reshaped = ! foundConflicts && tileGraph &&
+               reshape_tiles (insp, tileGraph, &reshape);
+    stats_time (stats, PHASE_RESHAPE, time_stamp() - startReshape);
+    if (reshaped) {
+      tiles = insp->tiles;
+      tracker_free (crossSweepConflictsTracker);
+      crossSweepConflictsTracker = tracker_init (tiles->size());
+      map_free (tileGraph, true);
+      tileGraph = NULL;
+    }
+  } while (foundConflicts || reshaped);
+
+  insp->nConflicts = crossSweepConflictsTracker->adjncy.size();
+  tracker_free (crossSweepConflictsTracker);
+  map_free (tileGraph, true);
+  if (trace) {
+    trace_clear (trace);
+    delete trace;
+  }
+  stats_memory (stats, MEM_TRACKERS, 0, 0);
+  stats_memory (stats, MEM_TRACES, 0, 0);
 
-    // tile the loop chain. First forward, then backward. The algorithm is as follows:
-    // 1- start from the seed loop; for each loop in the forward direction
-    // 2- project the data dependencies that loop /i-1/ induces to loop /i/
-    // 3- tile loop /i/, using the aforementioned projection
-    // 4- go back to point 2, and repeat till there are loop along the direction
-    // do the same for backward tiling
+  // compute local indirection maps (this avoids double indirections in the executor)
+  compute_local_ind_maps (loops, tiles, stats);
+  track_tiles (stats, tiles, -1);
 
-    // the tracker for conflicts arising in this tiling sweep
-    tracker_t conflicts;
+  // compute the data footprint of each tile, if the data sizes are known
+  double startFootprints = time_stamp();
+  tile_footprints (tiles, loops);
+  stats_time (stats, PHASE_FOOTPRINTS, time_stamp() - startFootprints);
 
-    // prepare for forward tiling
-    projection_t* seedLoopProj = projection_init();
-    projection_t* prevLoopProj = projection_init();
-    schedule_t* seedTilingInfo = schedule_init (seedLoopSetName, seedLoopSetSize,
-                                                tmpIter2tileMap, tmpIter2colorMap, SEED);
-    schedule_t* seedTilingInfoCpy = schedule_cpy (seedTilingInfo);
+  // inspection finished, stop timer
+  double end = time_stamp();
+  // track time spent in various sections of the inspection
+  insp->partitioningTime = endPartitioning - startPartitioning;
+  insp->totalInspectionTime = end - start;
+  stats->totalTime = end - start;
 
-    // compute forward projection from the seed loop
-    project_forward (seedLoop, seedTilingInfoCpy, prevLoopProj, seedLoopProj,
-                     &conflicts, ignoreWAR);
+  // the tiles are legal even if the cap on the number of colors is not met
+  return reshape.missed ? INSP_ERR : INSP_OK;
+}
 
-    // forward tiling
-    for (int i = seed + 1; i < nLoops; i++) {
-      loop_t* curLoop = loops->at(i);
+map_t* insp_tile_dag (inspector_t* insp)
+{
+  ASSERT(insp != NULL, "Invalid NULL pointer to inspector");
+  ASSERT(insp->tiles != NULL, "Tiles not available, was insp_run called ?");
 
-      // tile loop /i/
-      schedule_t* tilingInfo = tile_forward (curLoop, prevLoopProj);
-      assign_loop (curLoop, loops, tiles, tilingInfo->iter2tile, tilingInfo->direction);
+  // aliases
+  loop_list* loops = insp->loops;
+  tile_list* tiles = insp->tiles;
+  int nLoops = loops->size();
+  int nTiles = tiles->size();
 
-      // compute projection from loop /i-1/ for tiling loop /i/
-      project_forward (curLoop, tilingInfo, prevLoopProj, seedLoopProj,
-                       &conflicts, ignoreWAR);
+  // give each element of each set touched by the loop chain a unique ID
+  // (the iteration set of each loop, followed by the target set of each of
+  // its local maps, are assigned consecutive positions in /touchedOffsets/)
+  std::unordered_map<std::string, index_t> setOffsets;
+  std::vector<index_t> touchedOffsets;
+  index_t nElements = 0;
+  for (int i = 0; i < nLoops; i++) {
+    loop_t* loop = loops->at(i);
+    local_maps_t* localMaps = tiles->at(0)->localMaps[i];
+    for (int m = -1; m < localMaps->nMaps; m++) {
+      set_t* touchedSet = (m == -1) ? loop->set : NULL;
+      desc_list::const_iterator dIt, dEnd;
+      for (dIt = loop->descriptors->begin(), dEnd = loop->descriptors->end(); dIt != dEnd; dIt++) {
+        map_t* map = (*dIt)->map;
+        if (m != -1 && map != DIRECT && map->name == localMaps->names[m]) {
+          touchedSet = map->outSet;
+          break;
+        }
+      }
+      ASSERT(touchedSet != NULL, "Local map without a global map");
+      if (setOffsets.find(touchedSet->name) == setOffsets.end()) {
+        setOffsets[touchedSet->name] = nElements;
+        nElements += touchedSet->size;
+      }
+      touchedOffsets.push_back (setOffsets[touchedSet->name]);
     }
-
-    // prepare for backward tiling
-    projection_free (prevLoopProj);
-    prevLoopProj = seedLoopProj;
-
-    // compute backward projection from the seed loop
-    project_backward (seedLoop, seedTilingInfo, prevLoopProj, &conflicts, ignoreWAR);
-
-    // backward tiling
-    for (int i = seed - 1; i >= 0; i--) {
-      loop_t* curLoop = loops->at(i);
-
-      // tile loop /i/
-      schedule_t* tilingInfo = tile_backward (curLoop, prevLoopProj);
-      assign_loop (curLoop, loops, tiles, tilingInfo->iter2tile, tilingInfo->direction);
-
-      // compute projection from loop /i+1/ for tiling loop /i/
-      project_backward (curLoop, tilingInfo, prevLoopProj, &conflicts, ignoreWAR);
+  }
+  ASSERT((uint64_t)nElements <= UINT32_MAX, "Too many elements to build the tile DAG");
+
+  // 1) find the elements touched by more than one tile: /owner/ is -1 if an
+  // element is not touched, the touching tile if a single tile touches it, and
+  // -2 if several tiles touch it
+  int* owner = new int[nElements];
+  std::fill (owner, owner + nElements, -1);
+  std::vector<uint64_t> touches;
+  for (int pass = 0; pass < 2; pass++) {
+    for (int t = 0; t < nTiles; t++) {
+      tile_t* tile = tiles->at(t);
+      for (int i = 0, k = 0; i < nLoops; i++) {
+        local_maps_t* localMaps = tile->localMaps[i];
+        index_t loopSize = tile->iterations[i]->size();
+        for (int m = -1; m < localMaps->nMaps; m++, k++) {
+          index_t offset = touchedOffsets[k];
+          index_t* elements = tile->iterations[i]->data();
+          index_t nTouched = loopSize;
+          if (m != -1) {
+            index_t start = local_map_start (localMaps, m, t);
+            elements = localMaps->values[m] + start;
+            nTouched = local_map_start (localMaps, m, t + 1) - start;
+          }
+          for (index_t e = 0; e < nTouched; e++) {
+            if (elements[e] == -1) {
+              // off-processor element
+              continue;
+            }
+            index_t element = offset + elements[e];
+            if (pass == 0) {
+              owner[element] = (owner[element] == -1 || owner[element] == t) ? t : -2;
+            }
+            else if (owner[element] == -2) {
+              // 2) track all tiles touching a shared element
+              touches.push_back (((uint64_t)element << 32) | t);
+            }
+          }
+        }
+      }
     }
-
-    // free memory
-    projection_free (prevLoopProj);
-
-    // if color conflicts are found, we need to perform another tiling sweep this
-    // time starting off with a "constrained" seed coloring
-    tracker_t::const_iterator it, end;
-    for (it = conflicts.begin(), end = conflicts.end(); it != end; it++) {
-      if (it->second.size() > 0) {
-        // at least one conflict, so execute another tiling sweep
-        foundConflicts = true;
+  }
+  delete[] owner;
+  std::sort (touches.begin(), touches.end());
+  touches.erase (std::unique (touches.begin(), touches.end()), touches.end());
+
+  // 3) tiles touching the same element are ordered by color: each tile is linked
+  // to the tiles with the next color touching the element, as the order with
+  // any later color then follows by transitivity
+  std::vector<uint64_t> edges;
+  std::vector<std::pair<int, int> > group;
+  int nTouches = touches.size();
+  for (int start = 0, end = 0; start < nTouches; start = end) {
+    uint64_t element = touches[start] >> 32;
+    group.clear();
+    for (end = start; end < nTouches && (touches[end] >> 32) == element; end++) {
+      int t = (uint32_t)touches[end];
+      group.push_back (std::make_pair (tiles->at(t)->color, t));
+    }
+    std::sort (group.begin(), group.end());
+    int nGroup = group.size();
+    for (int prev = 0, cur = 0, next = 0; cur < nGroup; prev = cur, cur = next) {
+      for (next = cur + 1; next < nGroup && group[next].first == group[cur].first; next++);
+      for (int j = prev; j < cur; j++) {
+        for (int k = cur; k < next; k++) {
+          edges.push_back (((uint64_t)group[j].second << 32) | group[k].second);
+        }
       }
-      // update the cross-sweep tracker, in case there will be another sweep
-      crossSweepConflictsTracker[it->first].insert(it->second.begin(), it->second.end());
     }
+  }
+  std::sort (edges.begin(), edges.end());
+  edges.erase (std::unique (edges.begin(), edges.end()), edges.end());
+
+  // 4) build the DAG
+  int nEdges = edges.size();
+  index_t* offsets = new index_t[nTiles + 1]();
+  index_t* successors = new index_t[nEdges];
+  for (int k = 0; k < nEdges; k++) {
+    offsets[(edges[k] >> 32) + 1]++;
+    successors[k] = (uint32_t)edges[k];
+  }
+  for (int t = 0; t < nTiles; t++) {
+    offsets[t + 1] += offsets[t];
+  }
 
-    insp->nSweeps++;
-  } while (foundConflicts);
-
-  // compute local indirection maps (this avoids double indirections in the executor)
-  compute_local_ind_maps (loops, tiles);
-
-  // inspection finished, stop timer
-  double end = time_stamp();
-  // track time spent in various sections of the inspection
-  insp->partitioningTime = endPartitioning - startPartitioning;
-  insp->totalInspectionTime = end - start;
-
-  return INSP_OK;
+  return imap ("tile_dag", set_cpy(insp->tileRegions), set_cpy(insp->tileRegions),
+               successors, offsets);
 }
 
 void insp_print (inspector_t* insp, insp_verbose level, int loopIndex)
@@ -279,7 +422,7 @@ void insp_print (inspector_t* insp, insp_verbose level, int loopIndex)
   int avgTileSize = insp->avgTileSize;
   int nTiles = tiles->size();
   int nLoops = loops->size();
-  int itSetSize = loops->at(seed)->set->size;
+  index_t itSetSize = loops->at(seed)->set->size;
   int nThreads = insp->nThreads;
 
   cout << endl << "<<<< SLOPE inspection summary >>>>" << endl << endl;
@@ -338,6 +481,9 @@ void insp_print (inspector_t* insp, insp_verbose level, int loopIndex)
     case COL_MINCOLS:
       coloringMode = "mincols";
       break;
+    case COL_BALANCED:
+      coloringMode = "balanced";
+      break;
   }
 
   cout << "Backend: " << backend << endl;
@@ -346,21 +492,72 @@ void insp_print (inspector_t* insp, insp_verbose level, int loopIndex)
        << "  Number of tiles: " << nTiles << endl
        << "  Initial tile size: " << avgTileSize << endl;
   cout << "Seed loop" << endl
-       << "  ID: " << seed << endl
+       << "  ID: " << seed << (insp->autoSeed ? " (automatic)" : "") << endl
        << "  Partitioning: " << partitioningMode << endl
        << "  Coloring: " << coloringMode << endl;
+  if (insp->maxColors > 0) {
+    cout << "  Maximum number of colors: " << insp->maxColors << endl;
+  }
+  if (insp->autoSeed) {
+    // the prediction comes from a single tiling sweep, hence fewer conflicts,
+    // over the loops closest to the seed loop
+    double growthFwd, growthBwd;
+    tile_growth (insp, &growthFwd, &growthBwd, TRIAL_WINDOW);
+    cout << "  Tile growth (forward, backward): " << insp->predictedGrowthFwd << ", "
+         << insp->predictedGrowthBwd << " predicted, " << growthFwd << ", "
+         << growthBwd << " actual" << endl
+         << "  Conflicts per tile: " << insp->predictedConflicts << " predicted, "
+         << (nTiles ? (double)insp->nConflicts / nTiles : 0.0) << " actual" << endl;
+  }
   cout << "Inspection performance" << endl
        << "  Number of threads: " << nThreads << endl
        << "  Partitioning time: " << partitioningTime << " s" << endl
-       << "  Sweeps required for tiling: " << nSweeps << endl
-       << "  Total inspection time: " << totalInspectionTime << " s" << endl;
+       << "  Sweeps required for tiling: " << nSweeps << endl;
+  if (insp->nRepairs > 0) {
+    long nIterations = 0;
+    for (int i = 0; i < nLoops; i++) {
+      nIterations += loops->at(i)->set->size;
+    }
+    cout << "  Conflict repairs: " << insp->nRepairs << ", each tiling again "
+         << (100.0 * insp->nRetiled / MAX(insp->nRepairs * nIterations, 1L))
+         << "% of the loop iterations on average" << endl
+         << "  Conflict repair time: " << insp->repairTime << " s" << endl;
+  }
+  cout << "  Total inspection time: " << totalInspectionTime << " s" << endl;
+
+  // the data footprint of the core tiles, if the data sizes are known
+  int nCore = insp->tileRegions ? insp->tileRegions->core : 0;
+  long minFootprint = LONG_MAX, maxFootprint = 0, sumFootprint = 0;
+  for (int t = 0; t < nCore; t++) {
+    long footprint = tiles->at(t)->footprint;
+    minFootprint = MIN(minFootprint, footprint);
+    maxFootprint = MAX(maxFootprint, footprint);
+    sumFootprint += footprint;
+  }
+  if (maxFootprint > 0) {
+    cout << "Tile footprints" << endl
+         << "  Min, avg, max: " << minFootprint << ", " << sumFootprint / nCore
+         << ", " << maxFootprint << " bytes" << endl;
+    for (int cacheLevel = 1; cacheLevel <= 3; cacheLevel++) {
+      long cacheSize = cpu_cache_size (cacheLevel, nThreads);
+      if (cacheSize <= 0) {
+        continue;
+      }
+      int nFitting = 0;
+      for (int t = 0; t < nCore; t++) {
+        nFitting += tiles->at(t)->footprint <= cacheSize;
+      }
+      cout << "  Fitting in L" << cacheLevel << " (" << cacheSize << " bytes per thread): "
+           << 100.0 * nFitting / nCore << "% of tiles" << endl;
+    }
+  }
 
   if (level != VERY_LOW && level != MINIMAL) {
     if (iter2tile && iter2color) {
       cout << endl << "Printing partioning of the seed loop iteration set:" << endl;
       cout << "  Iteration  |  Tile |  Color" << endl;
-      for (int i = 0; i < itSetSize / avgTileSize; i++) {
-        int offset = i*avgTileSize;
+      for (index_t i = 0; i < itSetSize / avgTileSize; i++) {
+        index_t offset = i*avgTileSize;
         for (int j = 0; j < verbosityItSet; j++) {
           cout << "         " << offset + j
                << "   |   " << iter2tile->values[offset + j]
@@ -370,7 +567,7 @@ void insp_print (inspector_t* insp, insp_verbose level, int loopIndex)
         cout << separator;
       }
       int itSetReminder = itSetSize % avgTileSize;
-      int offset = itSetSize - itSetReminder;
+      index_t offset = itSetSize - itSetReminder;
       for (int i = 0; i < MIN(verbosityItSet, itSetReminder); i++) {
         cout << "         " << offset + i
              << "   |   " << iter2tile->values[offset + i]
@@ -383,15 +580,28 @@ void insp_print (inspector_t* insp, insp_verbose level, int loopIndex)
   }
 
   if (level != VERY_LOW && level != MINIMAL) {
-    cout << endl << "Coloring summary (color:#tiles):" << endl;
-    std::map<int, int> colors;
+    cout << endl << "Coloring summary (color:#tiles:#iterations):" << endl;
+    std::map<int, std::pair<int, index_t> > colors;
     tile_list::const_iterator it, end;
     for (it = tiles->begin(), end = tiles->end(); it != end; it++) {
-      colors[(*it)->color]++;
+      std::pair<int, index_t>& colorSize = colors[(*it)->color];
+      colorSize.first++;
+      for (int i = 0; i < nLoops; i++) {
+        colorSize.second += tile_loop_size (*it, i);
+      }
     }
-    std::map<int, int>::const_iterator mIt, mEnd;
+    std::map<int, std::pair<int, index_t> >::const_iterator mIt, mEnd;
     for (mIt = colors.begin(), mEnd = colors.end(); mIt != mEnd; mIt++) {
-      cout << mIt->first << " : " << mIt->second << endl;
+      cout << mIt->first << " : " << mIt->second.first
+           << " : " << mIt->second.second << endl;
+    }
+  }
+
+  if (level != VERY_LOW && level != MINIMAL && maxFootprint > 0) {
+    cout << endl << "Tile footprints (tile:bytes):" << endl;
+    tile_list::const_iterator it, end;
+    for (it = tiles->begin(), end = tiles->end(); it != end; it++) {
+      cout << (*it)->ID << " : " << (*it)->footprint << endl;
     }
   }
 
@@ -430,6 +640,44 @@ void insp_print (inspector_t* insp, insp_verbose level, int loopIndex)
   cout << endl << "<<<< SLOPE inspection summary end >>>>" << endl << endl;
 }
 
+void insp_measure_quality (inspector_t* insp)
+{
+  ASSERT(insp != NULL, "Invalid NULL pointer to inspector");
+  ASSERT(insp->tiles != NULL, "Measuring the quality of a tiling before inspection");
+
+  // aliases
+  insp_stats_t* stats = insp->stats;
+  loop_list* loops = insp->loops;
+
+  // the statistics are not sized to the loop chain if the tiles were loaded
+  if (stats->loops.size() != loops->size()) {
+    stats_reset (stats, loops);
+  }
+
+  double start = time_stamp();
+  stats_quality (stats, loops, insp->tiles, insp->seed, insp->tileRegions->core,
+                 insp->nThreads);
+  stats->times[PHASE_QUALITY] = time_stamp() - start;
+}
+
+insp_info insp_print_stats (inspector_t* insp, string fileName)
+{
+  ASSERT(insp != NULL, "Invalid NULL pointer to inspector");
+
+  if (fileName.empty()) {
+    stats_json (insp->stats, cout);
+    return INSP_OK;
+  }
+
+  ofstream out (fileName.c_str(), ios::out | ios::trunc);
+  if (! out) {
+    return INSP_ERR;
+  }
+  stats_json (insp->stats, out);
+  out.close();
+  return out ? INSP_OK : INSP_ERR;
+}
+
 void insp_free (inspector_t* insp)
 {
   ASSERT(insp != NULL, "Invalid NULL pointer to inspector");
@@ -440,6 +688,9 @@ void insp_free (inspector_t* insp)
   // aliases
   loop_list* loops = insp->loops;
 
+  // inverse maps must go first, as they are indexed by the maps freed below
+  inverse_maps_free (insp->inverseMaps);
+
   // delete tiled loops, access descriptors, maps, and sets
   // freed data structures are tracked so that freeing twice the same pointer
   // is avoided
@@ -494,6 +745,8 @@ void insp_free (inspector_t* insp)
 
   map_free (insp->iter2tile, true);
   map_free (insp->iter2color, true);
+  set_free (insp->tileRegions);
+  stats_free (insp->stats);
   delete insp;
 }
 
@@ -503,7 +756,7 @@ static void print_tiled_loop (tile_list* tiles, loop_t* loop, int verbosityTiles
 {
   // aliases
   int nTiles = tiles->size();
-  int totalIterationsAssigned = 0;
+  index_t totalIterationsAssigned = 0;
 
   cout << "  Loop " << loop->index << " - " << loop->name << endl;
   cout << "       Tile  |  Color  |  tot : {Iterations} " << endl;
@@ -525,7 +778,7 @@ static void print_tiled_loop (tile_list* tiles, loop_t* loop, int verbosityTiles
       cout << ", " << tiles->at(i)->iterations[loop->index]->at(j);
     }
     if (tileLoopSize > verbosityTiles) {
-      int lastIterID = tiles->at(i)->iterations[loop->index]->at(tileLoopSize - 1);
+      index_t lastIterID = tiles->at(i)->iterations[loop->index]->at(tileLoopSize - 1);
       cout << "..., " << lastIterID;
     }
     cout << "}" << endl;
@@ -567,7 +820,7 @@ static int select_seed_loop (insp_strategy strategy, insp_coloring coloring,
       }
       ASSERT (suggestedSeed != -1, "Invalid loop chain iterating over supersets only");
     }
-    if (coloring == COL_MINCOLS) {
+    if (coloring == COL_MINCOLS || coloring == COL_BALANCED) {
       ASSERT (loop_load_seed_map (loops->at(suggestedSeed), loops),
               "Couldn't load a map for coloring");
     }
@@ -598,19 +851,539 @@ static int select_seed_loop (insp_strategy strategy, insp_coloring coloring,
   int legalSeed = 0;
   ASSERT (! loops->at(legalSeed)->set->superset || nLoops == 1, "Illegal subset seed loop");
   ASSERT (loops->at(legalSeed)->set->execHalo != 0, "Invalid HALO region");
-  if (strategy == OMP_MPI || coloring == COL_MINCOLS) {
+  if (strategy == OMP_MPI || coloring == COL_MINCOLS || coloring == COL_BALANCED) {
     ASSERT (loop_load_seed_map (loops->at(legalSeed), loops),
             "Couldn't load a map for coloring");
   }
   return legalSeed;
 }
 
-static void compute_local_ind_maps(loop_list* loops, tile_list* tiles)
+/*
+ * Re-partition the seed loop if the tiling just computed does not meet
+ * /insp->maxColors/: if there are too many colors, merge the tiles of the colors
+ * beyond the cap and their neighbours in pairs, or split the tiles of the colors
+ * with fewer tiles than threads otherwise. Tiles are merged at most MAX_MERGES
+ * times; they are split at most once, and only if they were never merged. If
+ * splitting does not reduce the number of such colors, the previous partitioning
+ * is restored. Return true if the seed loop was re-partitioned.
+ */
+static bool reshape_tiles (inspector_t* insp, map_t* tileGraph, reshape_t* reshape)
+{
+  // aliases
+  tile_list* tiles = insp->tiles;
+  int maxColors = insp->maxColors;
+  int nThreads = insp->nThreads;
+  int nCore = insp->tileRegions->core;
+  int nTiles = tiles->size();
+
+  if (maxColors <= 0) {
+    return false;
+  }
+
+  int nColors = 0;
+  for (int t = 0; t < nTiles; t++) {
+    nColors = MAX(nColors, tiles->at(t)->color + 1);
+  }
+  reshape->missed = nColors > maxColors;
+  if (reshape->done) {
+    return false;
+  }
+  int* tilesPerColor = new int[nColors]();
+  for (int t = 0; t < nCore; t++) {
+    tilesPerColor[tiles->at(t)->color]++;
+  }
+  int nStarved = 0;
+  for (int c = 0; c < nColors; c++) {
+    nStarved += (tilesPerColor[c] > 0 && tilesPerColor[c] < nThreads) ? 1 : 0;
+  }
+
+  bool reshaped = false;
+  if (reshape->unsplit) {
+    // tiles were split in the previous round: undo it, unless it paid off
+    reshape->done = true;
+    if (nColors > maxColors || nStarved >= reshape->nStarved) {
+      partition_replace (insp, reshape->unsplit, reshape->unsplitCore);
+      reshaped = true;
+    }
+    else {
+      delete[] reshape->unsplit;
+    }
+    reshape->unsplit = NULL;
+  }
+  else if (nColors > maxColors) {
+    // too many colors: larger tiles are less likely to conflict with each other.
+    // Only the tiles of the colors beyond the cap, and the tiles they clash
+    // with, are merged
+    bool* merge = new bool[nCore]();
+    int nMerged = 0;
+    for (int t = 0; t < nCore; t++) {
+      if (tiles->at(t)->color < maxColors) {
+        continue;
+      }
+      merge[t] = true;
+      nMerged++;
+      for (index_t j = tileGraph->offsets[t]; j < tileGraph->offsets[t + 1]; j++) {
+        int n = tileGraph->values[j];
+        if (n < nCore) {
+          merge[n] = true;
+        }
+      }
+    }
+    if (reshape->nMerges < MAX_MERGES && nMerged > 0) {
+      partition_merge (insp, tileGraph, merge);
+      reshape->nMerges++;
+      reshaped = true;
+    }
+    delete[] merge;
+  }
+  else if (reshape->nMerges == 0 && nStarved > 0) {
+    // colors that cannot keep all threads busy: split their tiles
+    index_t seedSetSize = insp->iter2tile->inSet->size;
+    reshape->unsplit = new index_t[seedSetSize];
+    reshape->unsplitCore = nCore;
+    reshape->nStarved = nStarved;
+    memcpy (reshape->unsplit, insp->iter2tile->values, sizeof(index_t)*seedSetSize);
+    bool* split = new bool[nCore];
+    for (int t = 0; t < nCore; t++) {
+      split[t] = tilesPerColor[tiles->at(t)->color] < nThreads;
+    }
+    partition_split (insp, split);
+    delete[] split;
+    reshaped = true;
+  }
+
+  delete[] tilesPerColor;
+  return reshaped;
+}
+
+/*
+ * Return true if tiling the loop chain starting from /seed/ never requires a
+ * projection that is not available, which is a requirement when a loop over a
+ * subset is tiled (see /project_forward/ and /project_backward/)
+ */
+static bool seed_is_tileable (loop_list* loops, int seed, bool ignoreWAR)
+{
+  int nLoops = loops->size();
+
+  // the names of the sets with a projection, in the forward and backward
+  // directions; backward tiling starts with all of the forward projections
+  std::set<std::string> projected;
+  for (int k = 0; k < nLoops; k++) {
+    int i = (k <= nLoops - seed - 1) ? seed + k : nLoops - 1 - k;
+    loop_t* loop = loops->at(i);
+    set_t* superset = set_super(loop->set);
+    desc_list::const_iterator it, end;
+    for (it = loop->descriptors->begin(), end = loop->descriptors->end(); it != end; it++) {
+      map_t* map = (*it)->map;
+      if (map == DIRECT) {
+        projected.insert (loop->set->name);
+        continue;
+      }
+      if (map->inSet->size == 0 || ((*it)->mode == READ && ignoreWAR)) {
+        continue;
+      }
+      set_t* outSuperset = set_super(map->outSet);
+      if (projected.find(map->outSet->name) == projected.end() && superset &&
+          (! outSuperset || map->outSet->size != superset->size)) {
+        return false;
+      }
+      projected.insert (map->outSet->name);
+    }
+  }
+  return true;
+}
+
+/*
+ * Compute how much tiles grow away from the seed loop, in either direction, as
+ * the average over the loops in that direction of the ratio between the largest
+ * and the average number of iterations per core tile. Only the /window/ loops
+ * closest to the seed loop in either direction count, if /window/ is not negative
+ */
+static void tile_growth (inspector_t* insp, double* growthFwd, double* growthBwd,
+                         int window)
+{
+  // aliases
+  loop_list* loops = insp->loops;
+  tile_list* tiles = insp->tiles;
+  int nLoops = loops->size();
+  int seed = insp->seed;
+  int nCore = insp->tileRegions->core;
+  int first = (window < 0) ? 0 : MAX(0, seed - window);
+  int last = (window < 0) ? nLoops - 1 : MIN(nLoops - 1, seed + window);
+
+  double sumFwd = 0.0, sumBwd = 0.0;
+  for (int i = first; i <= last && nCore > 0; i++) {
+    if (i == seed) {
+      continue;
+    }
+    index_t maxSize = 0, sumSize = 0;
+    for (int t = 0; t < nCore; t++) {
+      int size = tile_loop_size (tiles->at(t), i);
+      maxSize = MAX(maxSize, size);
+      sumSize += size;
+    }
+    double growth = (sumSize > 0) ? (double)maxSize * nCore / sumSize : 1.0;
+    *((i < seed) ? &sumBwd : &sumFwd) += growth;
+  }
+  *growthFwd = (seed < last) ? sumFwd / (last - seed) : 1.0;
+  *growthBwd = (seed > first) ? sumBwd / (seed - first) : 1.0;
+}
+
+/*
+ * Predict how tiles grow, and how many conflicts arise, if /seed/ is the seed
+ * loop, through a trial inspection limited to a single tiling sweep over the
+ * TRIAL_WINDOW loops on either side of the seed loop. The number of colors of
+ * the trial seed coloring is returned in /nColors/. The seed loop is left
+ * partitioned.
+ */
+static void estimate_seed_loop (inspector_t* insp, int seed, double* growthFwd,
+                                double* growthBwd, double* conflicts, int* nColors)
+{
+  insp->seed = seed;
+  partition (insp);
+
+  tracker_t* trialConflictsTracker = tracker_init (insp->tiles->size());
+  map_t* tileGraph = NULL;
+  tile_sweep (insp, &tileGraph, trialConflictsTracker, NULL, TRIAL_WINDOW);
+
+  tile_growth (insp, growthFwd, growthBwd, TRIAL_WINDOW);
+  *conflicts = (double)trialConflictsTracker->adjncy.size() / insp->tiles->size();
+  *nColors = 0;
+  for (int t = 0; t < insp->tileRegions->core; t++) {
+    *nColors = MAX(*nColors, insp->tiles->at(t)->color + 1);
+  }
+
+  tracker_free (trialConflictsTracker);
+  map_free (tileGraph, true);
+}
+
+/*
+ * Select the seed loop through /estimate_seed_loop/: among the loops that can
+ * be a seed loop for the inspection strategy, pick the one with the lowest
+ * number of colors, scaled by the predicted conflicts per tile, then the one
+ * with the smallest predicted growth. Conflicts turn into more edges in the
+ * tile graph, so both more colors and more conflicts make it likely that the
+ * final coloring needs more colors and more sweeps. The seed loop is left
+ * partitioned as in the trial of the selected loop.
+ */
+static int auto_seed_loop (inspector_t* insp)
+{
+  // aliases
+  insp_strategy strategy = insp->strategy;
+  insp_coloring coloring = insp->coloring;
+  loop_list* loops = insp->loops;
+  int nLoops = loops->size();
+
+  // with one loop, or with MPI, there is nothing to choose
+  if (nLoops == 1 || strategy == ONLY_MPI || strategy == OMP_MPI) {
+    return select_seed_loop (strategy, coloring, loops, 0);
+  }
+
+  bool needsSeedMap = strategy == OMP || coloring == COL_MINCOLS || coloring == COL_BALANCED;
+  int best = -1;
+  double bestScore = 0.0, bestGrowth = 0.0;
+  // the partitioning of the best seed loop so far
+  index_t* bestIndMap = NULL;
+  int bestCore = 0, bestExec = 0, bestNonExec = 0;
+  string bestMode;
+  for (int i = 0; i < nLoops; i++) {
+    loop_t* loop = loops->at(i);
+    if (loop->set->superset || loop->set->core == 0 ||
+        (needsSeedMap && ! loop->seedMap) ||
+        ! seed_is_tileable (loops, i, insp->ignoreWAR)) {
+      continue;
+    }
+    double growthFwd, growthBwd, conflicts;
+    int nColors;
+    estimate_seed_loop (insp, i, &growthFwd, &growthBwd, &conflicts, &nColors);
+    double score = nColors * (1.0 + conflicts);
+    double growth = (growthFwd*(nLoops - 1 - i) + growthBwd*i) / (nLoops - 1);
+    if (best == -1 || score < bestScore || (score == bestScore && growth < bestGrowth)) {
+      best = i;
+      bestScore = score;
+      bestGrowth = growth;
+      insp->predictedGrowthFwd = growthFwd;
+      insp->predictedGrowthBwd = growthBwd;
+      insp->predictedConflicts = conflicts;
+      index_t setSize = insp->iter2tile->inSet->size;
+      delete[] bestIndMap;
+      bestIndMap = new index_t[setSize];
+      std::copy (insp->iter2tile->values, insp->iter2tile->values + setSize, bestIndMap);
+      bestCore = insp->tileRegions->core;
+      bestExec = insp->tileRegions->execHalo;
+      bestNonExec = insp->tileRegions->nonExecHalo;
+      bestMode = insp->partitioningMode;
+    }
+    partition_free (insp);
+  }
+  ASSERT(best != -1, "Couldn't find a legal seed loop");
+  insp->autoSeed = true;
+
+  // the trial tiles only cover the loops close to their seed loop, so they are
+  // rebuilt, but the seed loop is not partitioned again
+  insp->seed = best;
+  partition_from (insp, bestIndMap, bestCore, bestExec, bestNonExec);
+  insp->partitioningMode = bestMode;
+
+  return select_seed_loop (strategy, coloring, loops, best);
+}
+
+/*
+ * Perform a tiling sweep: color the seed loop iteration set, then tile the loop
+ * chain forward and backward from the seed loop. The conflicts found are added to
+ * /crossSweepConflictsTracker/; the tile graph is computed in /tileGraph/, if
+ * needed by the seed coloring and not computed yet. If /trace/ is not NULL, it is
+ * replaced by the trace of this sweep, unless the seed coloring does not depend
+ * on the tile graph (and so conflicts cannot arise), in which case it is left
+ * empty. If /window/ is not negative, only the /window/ loops closest to the seed
+ * loop in either direction are tiled. Return true if conflicts were found, in
+ * which case another sweep, or a repair, is needed.
+ */
+static bool tile_sweep (inspector_t* insp, map_t** tileGraph,
+                        tracker_t* crossSweepConflictsTracker, trace_t* trace,
+                        int window)
+{
+  // aliases
+  insp_coloring coloring = insp->coloring;
+  insp_strategy strategy = insp->strategy;
+  loop_list* loops = insp->loops;
+  int nLoops = loops->size();
+  bool ignoreWAR = insp->ignoreWAR;
+  inverse_maps* inverseMaps = insp->inverseMaps;
+  int seed = insp->seed;
+  loop_t* seedLoop = loops->at(seed);
+  string seedLoopSetName = seedLoop->set->name;
+  index_t seedLoopSetSize = seedLoop->set->size;
+  map_t* iter2tile = insp->iter2tile;
+  tile_list* tiles = insp->tiles;
+  insp_stats_t* stats = insp->stats;
+  int first = (window < 0) ? 0 : MAX(0, seed - window);
+  int last = (window < 0) ? nLoops - 1 : MIN(nLoops - 1, seed + window);
+
+  double start = time_stamp();
+
+  // color the seed loop iteration set
+  if (nLoops == 1 && loop_is_direct(seedLoop)) {
+    color_fully_parallel (insp);
+  }
+  else if (strategy == SEQUENTIAL || strategy == ONLY_MPI) {
+    if (coloring == COL_RAND) {
+      color_rand (insp);
+    }
+    else if (coloring == COL_MINCOLS || coloring == COL_BALANCED) {
+      *tileGraph = *tileGraph ? *tileGraph : color_tile_graph (insp, seedLoop->seedMap);
+      color_diff_adj (insp, *tileGraph, crossSweepConflictsTracker, true);
+    }
+    else {
+      color_sequential (insp);
+    }
+  }
+  else if (strategy == OMP || strategy == OMP_MPI) {
+    *tileGraph = *tileGraph ? *tileGraph : color_tile_graph (insp, seedLoop->seedMap);
+    color_diff_adj (insp, *tileGraph, crossSweepConflictsTracker);
+  }
+  else {
+    ASSERT(false, "Cannot compute a seed coloring");
+  }
+  map_t* iter2color = insp->iter2color;
+  stats_time (stats, PHASE_COLORING, time_stamp() - start);
+
+  if (trace) {
+    trace_clear (trace);
+    trace = *tileGraph ? trace : NULL;
+  }
+
+#ifdef SLOPE_VTK
+  // track coloring and tiling of a parloop. These can be used for debugging or
+  // visualization purpose, e.g. for generating VTK files.
+  seedLoop->tiling = new int[seedLoopSetSize];
+  seedLoop->coloring = new int[seedLoopSetSize];
+  std::copy (iter2tile->values, iter2tile->values + seedLoopSetSize, seedLoop->tiling);
+  std::copy (iter2color->values, iter2color->values + seedLoopSetSize, seedLoop->coloring);
+#endif
+
+#ifdef SLOPE_NARROW_SCHEDULES
+  // the tile IDs and the colors must fit in half a packed word
+  int maxColor = 0;
+  for (size_t t = 0; t < tiles->size(); t++) {
+    maxColor = MAX(maxColor, tiles->at(t)->color);
+  }
+  ASSERT((int)tiles->size() <= TC_MAX && maxColor < TC_MAX,
+         "Too many tiles or colors for SLOPE_NARROW_SCHEDULES");
+#endif
+
+  // pack the seed tiling and coloring, which will be used for backward tiling
+  // (forward tiling uses a copy)
+  tc_t* seedIter2tc = new tc_t[seedLoopSetSize];
+  for (index_t i = 0; i < seedLoopSetSize; i++) {
+    seedIter2tc[i] = tc_pack (iter2tile->values[i], iter2color->values[i]);
+  }
+
+  // tile the loop chain. First forward, then backward. The algorithm is as follows:
+  // 1- start from the seed loop; for each loop in the forward direction
+  // 2- project the data dependencies that loop /i-1/ induces to loop /i/
+  // 3- tile loop /i/, using the aforementioned projection
+  // 4- go back to point 2, and repeat till there are loop along the direction
+  // do the same for backward tiling
+
+  // the tracker for conflicts arising in this tiling sweep
+  tracker_t* conflicts = tracker_init (tiles->size());
+
+  // prepare for forward tiling
+  projection_t* seedLoopProj = projection_init();
+  projection_t* prevLoopProj = projection_init();
+  schedule_t* seedTilingInfo = schedule_init (seedLoopSetName, seedLoopSetSize,
+                                              seedIter2tc, SEED);
+  schedule_t* seedTilingInfoCpy = schedule_cpy (seedTilingInfo);
+  if (trace) {
+    trace->push_back (schedule_cpy (seedTilingInfo));
+  }
+
+  // the last schedule seen for each set, to tell the projections just computed
+  std::map<std::string, schedule_t*> knownProj;
+
+  // compute forward projection from the seed loop
+  double startLoop = time_stamp();
+  project_forward (seedLoop, seedTilingInfoCpy, prevLoopProj, seedLoopProj,
+                   conflicts, inverseMaps, ignoreWAR, trace);
+  stats_time (stats, PHASE_PROJECTION, time_stamp() - startLoop, seed);
+  track_projections (stats, prevLoopProj, seedLoopProj, &knownProj);
+
+  // forward tiling
+  for (int i = seed + 1; i <= last; i++) {
+    loop_t* curLoop = loops->at(i);
+
+    // tile loop /i/
+    double startTiling = time_stamp();
+    schedule_t* tilingInfo = tile_forward (curLoop, prevLoopProj, conflicts);
+    double startAssignment = time_stamp();
+    assign_loop (curLoop, loops, tiles, tilingInfo->iter2tc, tilingInfo->direction);
+    if (trace) {
+      trace->push_back (schedule_cpy (tilingInfo));
+    }
+    double startProjection = time_stamp();
+    stats_time (stats, PHASE_TILING, startAssignment - startTiling, i);
+    stats_time (stats, PHASE_ASSIGNMENT, startProjection - startAssignment, i);
+    track_tiles (stats, tiles, i);
+
+    // compute projection from loop /i-1/ for tiling loop /i/
+    project_forward (curLoop, tilingInfo, prevLoopProj, seedLoopProj,
+                     conflicts, inverseMaps, ignoreWAR, trace);
+    stats_time (stats, PHASE_PROJECTION, time_stamp() - startProjection, i);
+    track_projections (stats, prevLoopProj, seedLoopProj, &knownProj);
+  }
+
+  // prepare for backward tiling; the projections closest to the seed loop are
+  // shared with /seedLoopProj/
+  projection_free (prevLoopProj, seedLoopProj);
+  prevLoopProj = seedLoopProj;
+  track_projections (stats, prevLoopProj, NULL, &knownProj, false);
+
+  // compute backward projection from the seed loop
+  startLoop = time_stamp();
+  project_backward (seedLoop, seedTilingInfo, prevLoopProj, conflicts,
+                    inverseMaps, ignoreWAR, trace);
+  stats_time (stats, PHASE_PROJECTION, time_stamp() - startLoop, seed);
+  track_projections (stats, prevLoopProj, NULL, &knownProj);
+
+  // backward tiling
+  for (int i = seed - 1; i >= first; i--) {
+    loop_t* curLoop = loops->at(i);
+
+    // tile loop /i/
+    double startTiling = time_stamp();
+    schedule_t* tilingInfo = tile_backward (curLoop, prevLoopProj, conflicts);
+    double startAssignment = time_stamp();
+    assign_loop (curLoop, loops, tiles, tilingInfo->iter2tc, tilingInfo->direction);
+    if (trace) {
+      trace->push_back (schedule_cpy (tilingInfo));
+    }
+    double startProjection = time_stamp();
+    stats_time (stats, PHASE_TILING, startAssignment - startTiling, i);
+    stats_time (stats, PHASE_ASSIGNMENT, startProjection - startAssignment, i);
+    track_tiles (stats, tiles, i);
+
+    // compute projection from loop /i+1/ for tiling loop /i/
+    project_backward (curLoop, tilingInfo, prevLoopProj, conflicts,
+                      inverseMaps, ignoreWAR, trace);
+    stats_time (stats, PHASE_PROJECTION, time_stamp() - startProjection, i);
+    track_projections (stats, prevLoopProj, NULL, &knownProj);
+  }
+
+  // free memory
+  projection_free (prevLoopProj);
+  stats_memory (stats, MEM_PROJECTIONS, 0, 0);
+
+  // if color conflicts are found, we need to perform another tiling sweep this
+  // time starting off with a "constrained" seed coloring
+  tracker_compact (conflicts);
+  bool foundConflicts = ! tracker_empty (conflicts);
+  // update the cross-sweep tracker, in case there will be another sweep
+  tracker_merge (crossSweepConflictsTracker, conflicts);
+  stats_memory (stats, MEM_TRACKERS, tracker_bytes (conflicts),
+                tracker_bytes (conflicts) + tracker_bytes (crossSweepConflictsTracker));
+  if (trace) {
+    long traceBytes = stats ? trace_bytes (trace) : 0;
+    stats_memory (stats, MEM_TRACES, traceBytes, traceBytes);
+  }
+  stats_sweep (stats, time_stamp() - start, iter2color->outSet->size, tiles->size(),
+               conflicts->adjncy.size());
+  tracker_free (conflicts);
+
+  return foundConflicts;
+}
+
+/*
+ * Repair the conflicts found by the last tiling sweep, or by the last repair, and
+ * tracked in /crossSweepConflictsTracker/: the tiles in conflict are recolored and
+ * the tiling in /trace/ is repaired accordingly (see /retile/). The conflicts found
+ * while retiling are added to /crossSweepConflictsTracker/, and /foundConflicts/ is
+ * set accordingly. Return false, leaving the tiling untouched, if the conflicts
+ * cannot be repaired without recoloring the halo tiles.
+ */
+static bool repair_conflicts (inspector_t* insp, map_t* tileGraph,
+                              tracker_t* crossSweepConflictsTracker, trace_t* trace,
+                              bool* foundConflicts)
+{
+  // aliases
+  tile_list* tiles = insp->tiles;
+
+  double start = time_stamp();
+
+  std::vector<index_t> recolored;
+  if (! color_repair (insp, tileGraph, crossSweepConflictsTracker, recolored)) {
+    return false;
+  }
+
+  tracker_t* conflicts = tracker_init (tiles->size());
+  long nRetiled = retile (insp->loops, insp->seed, tiles, insp->iter2color->values,
+                          recolored, trace, conflicts, insp->inverseMaps,
+                          insp->ignoreWAR);
+  tracker_compact (conflicts);
+  *foundConflicts = ! tracker_empty (conflicts);
+  tracker_merge (crossSweepConflictsTracker, conflicts);
+  stats_memory (insp->stats, MEM_TRACKERS, tracker_bytes (conflicts),
+                tracker_bytes (conflicts) + tracker_bytes (crossSweepConflictsTracker));
+  tracker_free (conflicts);
+
+  double time = time_stamp() - start;
+  insp->nRetiled += nRetiled;
+  insp->nRepairs++;
+  insp->repairTime += time;
+  stats_time (insp->stats, PHASE_REPAIR, time);
+  stats_repair (insp->stats, time, nRetiled);
+
+  return true;
+}
+
+static void compute_local_ind_maps(loop_list* loops, tile_list* tiles, insp_stats_t* stats)
 {
   // aliases
   int nLoops = loops->size();
   int nTiles = tiles->size();
 
+  long resident = 0;
+
   /* For each loop spanned by a tile, take the global maps used in that loop and,
    * for each of them:
    * - access it by an iteration index
@@ -621,41 +1394,154 @@ static void compute_local_ind_maps(loop_list* loops, tile_list* tiles)
    * prefetching, instead of accessing a list of non-contiguous indices in a
    * global mapping.
    */
-  loop_list::const_iterator lIt, lEnd;
-  int i = 0;
-  for (lIt = loops->begin(), lEnd = loops->end(); lIt != lEnd; lIt++, i++) {
-    desc_list* descriptors = (*lIt)->descriptors;
+  for (int i = 0; i < nLoops; i++) {
+    desc_list* descriptors = loops->at(i)->descriptors;
+    double start = time_stamp();
+
+    // avoid computing same local map more than once
+    std::vector<std::string> names;
+    std::vector<int> arities;
+    std::vector<map_t*> globalMaps;
+    desc_list::const_iterator dIt, dEnd;
+    for (dIt = descriptors->begin(), dEnd = descriptors->end(); dIt != dEnd; dIt++) {
+      map_t* globalMap = (*dIt)->map;
+      if (globalMap == DIRECT ||
+          std::find (names.begin(), names.end(), globalMap->name) != names.end()) {
+        continue;
+      }
+      names.push_back (globalMap->name);
+      arities.push_back (globalMap->offsets ? 0 : globalMap->size / globalMap->inSet->size);
+      globalMaps.push_back (globalMap);
+    }
+    int nMaps = names.size();
 
-    tile_list::const_iterator tIt, tEnd;
-    for (tIt = tiles->begin(), tEnd = tiles->end(); tIt != tEnd; tIt++) {
-      mapname_iterations* localMaps = new mapname_iterations;
-      desc_list::const_iterator dIt, dEnd;
-      for (dIt = descriptors->begin(), dEnd = descriptors->end(); dIt != dEnd; dIt++) {
-        map_t* globalMap = (*dIt)->map;
+    // the local maps of all tiles are stored contiguously
+    index_t* offsets = new index_t[nTiles + 1];
+    offsets[0] = 0;
+    for (int t = 0; t < nTiles; t++) {
+      offsets[t + 1] = offsets[t] + tiles->at(t)->iterations[i]->size();
+    }
 
-        if (globalMap == DIRECT) {
-          continue;
+    // for the irregular maps, the elements of each iteration are counted first,
+    // within each tile and in parallel; the counts of the tiles are then
+    // prefix-summed, and each tile shifts its offsets by the elements of the
+    // tiles before it
+    std::vector<index_t*> mapOffsets (nMaps, (index_t*)NULL);
+    index_t* tileCounts = new index_t[nTiles + 1];
+    for (int m = 0; m < nMaps; m++) {
+      index_t* globalOffsets = globalMaps[m]->offsets;
+      if (! globalOffsets) {
+        continue;
+      }
+      index_t* iterOffsets = new index_t[offsets[nTiles] + 1];
+      #pragma omp parallel for schedule(dynamic)
+      for (int t = 0; t < nTiles; t++) {
+        iterations_list& iterations = *(tiles->at(t)->iterations[i]);
+        index_t* tileOffsets = iterOffsets + offsets[t];
+        index_t count = 0;
+        for (size_t k = 0; k < iterations.size(); k++) {
+          index_t element = iterations[k];
+          count += globalOffsets[element + 1] - globalOffsets[element];
+          tileOffsets[k + 1] = count;
         }
-        if (localMaps->find(globalMap->name) != localMaps->end()) {
-          // avoid computing same local map more than once
+        tileCounts[t + 1] = count;
+      }
+      tileCounts[0] = 0;
+      for (int t = 0; t < nTiles; t++) {
+        tileCounts[t + 1] += tileCounts[t];
+      }
+      iterOffsets[0] = 0;
+      #pragma omp parallel for schedule(static)
+      for (int t = 0; t < nTiles; t++) {
+        for (index_t e = offsets[t] + 1; e <= offsets[t + 1]; e++) {
+          iterOffsets[e] += tileCounts[t];
+        }
+      }
+      mapOffsets[m] = iterOffsets;
+    }
+    delete[] tileCounts;
+    local_maps_t* localMaps = local_maps_init (nTiles, names, arities, offsets, &mapOffsets);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int t = 0; t < nTiles; t++) {
+      tile_t* tile = tiles->at(t);
+      index_t* iterations = tile->iterations[i]->data();
+      index_t tileLoopSize = offsets[t + 1] - offsets[t];
+      for (int m = 0; m < nMaps; m++) {
+        index_t* globalIndMap = globalMaps[m]->values;
+        index_t* localMap = localMaps->values[m] + local_map_start (localMaps, m, t);
+        int arity = arities[m];
+        if (arity == 0) {
+          // irregular map: copy the elements of each iteration one after the other
+          index_t* globalOffsets = globalMaps[m]->offsets;
+          index_t j = 0;
+          for (index_t e = 0; e < tileLoopSize; e++) {
+            index_t element = iterations[e];
+            for (index_t k = globalOffsets[element]; k < globalOffsets[element + 1]; k++) {
+              localMap[j++] = globalIndMap[k];
+            }
+          }
           continue;
         }
-
-        int tileLoopSize = (*tIt)->iterations[i]->size();
-        int* globalIndMap = globalMap->values;
-        int arity = (tileLoopSize > 0) ? globalMap->size / globalMap->inSet->size : 0;
-
-        iterations_list* localMap = new iterations_list (tileLoopSize*arity);
-        localMaps->insert (mi_pair(globalMap->name, localMap));
-
-        for (int e = 0; e < tileLoopSize; e++) {
-          int element = (*tIt)->iterations[i]->at(e);
+        for (index_t e = 0; e < tileLoopSize; e++) {
+          index_t element = iterations[e];
           for (int j = 0; j < arity; j++) {
-            localMap->at(e*arity + j) = globalIndMap[element*arity + j];
+            localMap[e*arity + j] = globalIndMap[element*arity + j];
           }
         }
       }
-      (*tIt)->localMaps[i] = localMaps;
+      tile->localMaps[i] = localMaps;
     }
+
+    long bytes = local_maps_bytes (localMaps);
+    resident += bytes;
+    stats_time (stats, PHASE_LOCAL_MAPS, time_stamp() - start, i);
+    stats_memory (stats, MEM_LOCAL_MAPS, bytes, resident);
+  }
+}
+
+/*
+ * Record in /stats/ the memory held by the projections /prevLoopProj/ and
+ * /seedLoopProj/, which may share schedules. /known/ tracks the last schedule
+ * seen for each set in /prevLoopProj/: any other schedule has just been
+ * computed, and so it is also recorded as allocated, unless /allocated/ is
+ * false. Note that a new schedule is computed before the one it replaces is
+ * freed, so the two cannot share the same address
+ */
+static void track_projections (insp_stats_t* stats, projection_t* prevLoopProj,
+                               projection_t* seedLoopProj,
+                               std::map<std::string, schedule_t*>* known,
+                               bool allocated)
+{
+  if (! stats) {
+    return;
+  }
+
+  long bytes = 0;
+  projection_t::const_iterator it, end;
+  for (it = prevLoopProj->begin(), end = prevLoopProj->end(); it != end; it++) {
+    schedule_t*& last = (*known)[(*it)->name];
+    bytes += (allocated && last != *it) ? schedule_bytes (*it) : 0;
+    last = *it;
+  }
+  stats_memory (stats, MEM_PROJECTIONS, bytes, projection_bytes (prevLoopProj, seedLoopProj));
+}
+
+/*
+ * Record in /stats/ the memory held by /tiles/, the iterations of loop
+ * /loopIndex/ having just been assigned to them (unless /loopIndex/ is -1)
+ */
+static void track_tiles (insp_stats_t* stats, tile_list* tiles, int loopIndex)
+{
+  if (! stats) {
+    return;
+  }
+
+  long allocated = 0, resident = 0;
+  tile_list::const_iterator it, end;
+  for (it = tiles->begin(), end = tiles->end(); it != end; it++) {
+    allocated += (loopIndex != -1) ? tile_bytes (*it, loopIndex) : 0;
+    resident += tile_bytes (*it);
   }
+  stats_memory (stats, MEM_TILES, allocated, resident);
 }
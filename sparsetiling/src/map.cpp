@@ -4,14 +4,21 @@
  */
 
 #include <algorithm>
+#include <vector>
 
 #include <stdlib.h>
 
+#ifdef SLOPE_OMP
+#include <omp.h>
+#endif
+
 #include "map.h"
 #include "utils.h"
 #include "common.h"
 
-map_t* map (std::string name, set_t* inSet, set_t* outSet, int* values, int size)
+#define INVERT_GRAIN 65536
+
+map_t* map (std::string name, set_t* inSet, set_t* outSet, index_t* values, index_t size)
 {
   map_t* map = new map_t;
 
@@ -25,7 +32,7 @@ map_t* map (std::string name, set_t* inSet, set_t* outSet, int* values, int size
   return map;
 }
 
-map_t* imap (std::string name, set_t* inSet, set_t* outSet, int* values, int* offsets)
+map_t* imap (std::string name, set_t* inSet, set_t* outSet, index_t* values, index_t* offsets)
 {
   map_t* map = new map_t;
 
@@ -47,14 +54,17 @@ map_t* map_cpy (std::string name, map_t* map)
   new_map->inSet = set_cpy (map->inSet);
   new_map->outSet = set_cpy (map->outSet);
 
-  new_map->values = new int[map->size];
+  new_map->values = new index_t[map->size];
   std::copy (map->values, map->values + map->size, new_map->values);
   new_map->size = map->size;
 
+  new_map->offsets = NULL;
   if (map->offsets) {
-    new_map->offsets = new int[map->inSet->size];
-    std::copy (map->offsets, map->offsets + map->inSet->size, new_map->offsets);
+    new_map->offsets = new index_t[map->inSet->size + 1];
+    std::copy (map->offsets, map->offsets + map->inSet->size + 1, new_map->offsets);
   }
+
+  return new_map;
 }
 
 void map_free (map_t* map, bool freeIndMap)
@@ -72,7 +82,7 @@ void map_free (map_t* map, bool freeIndMap)
   delete map;
 }
 
-void map_ofs (map_t* map, int element, int* offset, int* size)
+void map_ofs (map_t* map, index_t element, index_t* offset, int* size)
 {
   ASSERT(element < map->inSet->size, "Invalid element passed to map_ofs");
 
@@ -91,48 +101,256 @@ void map_ofs (map_t* map, int element, int* offset, int* size)
 map_t* map_invert (map_t* x2y, int* maxIncidence)
 {
   // aliases
-  int xSize = x2y->inSet->size;
-  int ySize = x2y->outSet->size;
-  int* x2yMap = x2y->values;
-  int x2yMapSize = x2y->size;
+  index_t xSize = x2y->inSet->size;
+  index_t ySize = x2y->outSet->size;
+  index_t* x2yMap = x2y->values;
+  index_t* x2yOffsets = x2y->offsets;
+  index_t x2yMapSize = x2y->size;
 
-  int x2yArity = x2yMapSize / xSize;
+  int x2yArity = x2yOffsets ? 0 : x2yMapSize / xSize;
 
-  int* y2xMap = new int[x2yMapSize];
-  int* y2xOffset = new int[ySize + 1]();
-  int incidence = 0;
+  // the elements in /x/ are split into contiguous blocks, inverted in parallel.
+  // Each block has its own histogram, as large as /y/, so there is little point
+  // in having more blocks than the average number of entries per /y/ element
+  int nBlocks = 1;
+#ifdef SLOPE_OMP
+  if (x2yMapSize >= INVERT_GRAIN) {
+    nBlocks = MIN(omp_get_max_threads(), MAX(x2yMapSize / MAX(ySize, 1), 1));
+  }
+#endif
+  long histSize = ySize + 1;
 
-  // compute the offsets in y2x
   // note: some entries in /x2yMap/ might be set to -1 to indicate that an element
   // in /x/ is on the boundary, and it is touching some off-processor elements in /y/;
-  // so here we have to reset /y2xOffset[0]/ to 0
-  for (int i = 0; i < x2yMapSize; i++) {
-    y2xOffset[x2yMap[i] + 1]++;
-  }
-  y2xOffset[0] = 0;
-  for (int i = 1; i < ySize + 1; i++) {
-    y2xOffset[i] += y2xOffset[i - 1];
-    incidence = MAX(incidence, y2xOffset[i] - y2xOffset[i - 1]);
-  }
-
-  // compute y2x
-  int* inserted = new int[ySize + 1]();
-  for (int i = 0; i < x2yMapSize; i += x2yArity) {
-    for (int j = 0; j < x2yArity; j++) {
-      int entry = x2yMap[i + j];
-      if (entry == -1) {
-        // as explained before, off-processor elements are ignored. In the end,
-        // /y2xMap/ might just be slightly larger than strictly necessary
-        continue;
+  // such entries are counted in the first slot of the histograms, which is then
+  // ignored, and are left out of /y2xMap/
+  int* counts = new int[nBlocks*histSize];
+  index_t* y2xOffset = new index_t[ySize + 1];
+  index_t* chunkOffsets = new index_t[nBlocks + 1];
+  index_t* y2xMap = NULL;
+  int incidence = 0;
+
+  #pragma omp parallel num_threads(nBlocks)
+  {
+    // 1) count the entries of each block of /x/ pointing to each /y/ element
+    #pragma omp for schedule(static, 1)
+    for (int b = 0; b < nBlocks; b++) {
+      int* blockCounts = counts + b*histSize;
+      std::fill (blockCounts, blockCounts + histSize, 0);
+      index_t xStart = (long)xSize*b / nBlocks;
+      index_t xEnd = (long)xSize*(b + 1) / nBlocks;
+      index_t end = x2yOffsets ? x2yOffsets[xEnd] : xEnd*x2yArity;
+      for (index_t j = x2yOffsets ? x2yOffsets[xStart] : xStart*x2yArity; j < end; j++) {
+        blockCounts[x2yMap[j] + 1]++;
+      }
+    }
+
+    // 2) for each /y/ element, turn the per-block counts into the position at
+    // which each block starts writing, relative to the first entry of that
+    // element; the total counts are then prefix-summed into /y2xOffset/, first
+    // within each chunk of /y/ and then across chunks
+    #pragma omp for schedule(static, 1) reduction(max:incidence)
+    for (int b = 0; b < nBlocks; b++) {
+      index_t yStart = (long)ySize*b / nBlocks;
+      index_t yEnd = (long)ySize*(b + 1) / nBlocks;
+      index_t chunkSize = 0;
+      for (index_t i = yStart; i < yEnd; i++) {
+        int total = 0;
+        for (int k = 0; k < nBlocks; k++) {
+          int* count = counts + k*histSize + i + 1;
+          int blockCount = *count;
+          *count = total;
+          total += blockCount;
+        }
+        incidence = MAX(incidence, total);
+        chunkSize += total;
+        y2xOffset[i + 1] = chunkSize;
+      }
+      chunkOffsets[b + 1] = chunkSize;
+    }
+    #pragma omp single
+    {
+      chunkOffsets[0] = 0;
+      for (int b = 0; b < nBlocks; b++) {
+        chunkOffsets[b + 1] += chunkOffsets[b];
+      }
+      y2xOffset[0] = 0;
+      y2xMap = new index_t[chunkOffsets[nBlocks]];
+    }
+    #pragma omp for schedule(static, 1)
+    for (int b = 0; b < nBlocks; b++) {
+      index_t yStart = (long)ySize*b / nBlocks;
+      index_t yEnd = (long)ySize*(b + 1) / nBlocks;
+      for (index_t i = yStart; i < yEnd; i++) {
+        y2xOffset[i + 1] += chunkOffsets[b];
+      }
+    }
+
+    // 3) each block scatters its elements to its own slots: the elements
+    // related to a /y/ element are therefore sorted, as in a sequential inversion
+    #pragma omp for schedule(static, 1)
+    for (int b = 0; b < nBlocks; b++) {
+      int* inserted = counts + b*histSize + 1;
+      index_t xStart = (long)xSize*b / nBlocks;
+      index_t xEnd = (long)xSize*(b + 1) / nBlocks;
+      for (index_t i = xStart; i < xEnd; i++) {
+        index_t end = x2yOffsets ? x2yOffsets[i + 1] : (i + 1)*x2yArity;
+        for (index_t j = x2yOffsets ? x2yOffsets[i] : i*x2yArity; j < end; j++) {
+          index_t entry = x2yMap[j];
+          if (entry == -1) {
+            continue;
+          }
+          y2xMap[y2xOffset[entry] + inserted[entry]] = i;
+          inserted[entry]++;
+        }
       }
-      y2xMap[y2xOffset[entry] + inserted[entry]] = i / x2yArity;
-      inserted[entry]++;
     }
   }
-  delete[] inserted;
+  delete[] counts;
+  delete[] chunkOffsets;
 
   if (maxIncidence)
     *maxIncidence = incidence;
   return imap ("inverse_" + x2y->name, set_cpy(x2y->outSet), set_cpy(x2y->inSet),
                y2xMap, y2xOffset);
 }
+
+void map_line_graph (map_t* map, index_t nElements, index_t** offsets, index_t** adjncy)
+{
+  // aliases
+  index_t* values = map->values;
+  index_t* mapOffsets = map->offsets;
+  index_t nTargets = map->outSet->size;
+  int arity = mapOffsets ? 0 : map->size / map->inSet->size;
+
+  // invert /map/, restricted to the first /nElements/ elements; the order of the
+  // elements in a row of the inverse is irrelevant, since rows of the line graph
+  // are sorted anyway
+  index_t* t2eOffsets = new index_t[nTargets + 1]();
+  #pragma omp parallel for schedule(static)
+  for (index_t i = 0; i < nElements; i++) {
+    index_t end = mapOffsets ? mapOffsets[i + 1] : (i + 1)*arity;
+    for (index_t j = mapOffsets ? mapOffsets[i] : i*arity; j < end; j++) {
+      if (values[j] != -1) {
+        #pragma omp atomic update
+        t2eOffsets[values[j] + 1]++;
+      }
+    }
+  }
+  for (index_t t = 0; t < nTargets; t++) {
+    t2eOffsets[t + 1] += t2eOffsets[t];
+  }
+  index_t* t2e = new index_t[t2eOffsets[nTargets]];
+  int* inserted = new int[nTargets]();
+  #pragma omp parallel for schedule(static)
+  for (index_t i = 0; i < nElements; i++) {
+    index_t end = mapOffsets ? mapOffsets[i + 1] : (i + 1)*arity;
+    for (index_t j = mapOffsets ? mapOffsets[i] : i*arity; j < end; j++) {
+      index_t t = values[j];
+      if (t == -1) {
+        continue;
+      }
+      int position;
+      #pragma omp atomic capture
+      position = inserted[t]++;
+      t2e[t2eOffsets[t] + position] = i;
+    }
+  }
+  delete[] inserted;
+
+  // two passes over the elements: first count the neighbours of each element,
+  // then store them once the offsets are known
+  index_t* e2eOffsets = new index_t[nElements + 1];
+  index_t* e2e = NULL;
+  e2eOffsets[0] = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    #pragma omp parallel
+    {
+      std::vector<index_t> neighbours;
+      #pragma omp for schedule(static)
+      for (index_t i = 0; i < nElements; i++) {
+        neighbours.clear();
+        index_t end = mapOffsets ? mapOffsets[i + 1] : (i + 1)*arity;
+        for (index_t j = mapOffsets ? mapOffsets[i] : i*arity; j < end; j++) {
+          index_t t = values[j];
+          if (t == -1) {
+            continue;
+          }
+          for (index_t k = t2eOffsets[t]; k < t2eOffsets[t + 1]; k++) {
+            if (t2e[k] != i) {
+              neighbours.push_back (t2e[k]);
+            }
+          }
+        }
+        std::sort (neighbours.begin(), neighbours.end());
+        int size = std::unique (neighbours.begin(), neighbours.end()) - neighbours.begin();
+        if (! e2e) {
+          e2eOffsets[i + 1] = size;
+        }
+        else {
+          std::copy (neighbours.begin(), neighbours.begin() + size, e2e + e2eOffsets[i]);
+        }
+      }
+    }
+    if (! e2e) {
+      for (index_t i = 0; i < nElements; i++) {
+        e2eOffsets[i + 1] += e2eOffsets[i];
+      }
+      e2e = new index_t[e2eOffsets[nElements]];
+    }
+  }
+
+  delete[] t2e;
+  delete[] t2eOffsets;
+
+  *offsets = e2eOffsets;
+  *adjncy = e2e;
+}
+
+inverse_maps* inverse_maps_init()
+{
+  return new inverse_maps;
+}
+
+map_t* map_invert_cached (map_t* x2y, inverse_maps* cache, int* maxIncidence)
+{
+  inverse_maps::const_iterator it = cache->find (x2y);
+  if (it == cache->end()) {
+    map_t* y2x = map_invert (x2y, maxIncidence);
+    cache->insert (std::make_pair(x2y, y2x));
+    return y2x;
+  }
+  map_t* y2x = it->second;
+
+  // the incidence of a cached inverse is recovered from its offsets
+  if (maxIncidence) {
+    index_t* offsets = y2x->offsets;
+    int incidence = 0;
+    for (index_t i = 0; i < y2x->inSet->size; i++) {
+      incidence = MAX(incidence, offsets[i + 1] - offsets[i]);
+    }
+    *maxIncidence = incidence;
+  }
+  return y2x;
+}
+
+void inverse_maps_erase (inverse_maps* cache, map_t* x2y)
+{
+  inverse_maps::iterator it = cache->find (x2y);
+  if (it != cache->end()) {
+    map_free (it->second, true);
+    cache->erase (it);
+  }
+}
+
+void inverse_maps_free (inverse_maps* cache)
+{
+  if (! cache) {
+    return;
+  }
+  inverse_maps::iterator it, end;
+  for (it = cache->begin(), end = cache->end(); it != end; it++) {
+    map_free (it->second, true);
+  }
+  delete cache;
+}
@@ -10,10 +10,17 @@
 
 #ifdef SLOPE_METIS
 #include "metis.h"
+// the index arrays are passed to METIS as they are
+#if defined(SLOPE_LONG_INDICES) && IDXTYPEWIDTH != 64
+#error "SLOPE_LONG_INDICES requires METIS to be built with IDXTYPEWIDTH=64"
+#endif
 #endif
 
 #include <algorithm>
 #include <iostream>
+#include <vector>
+
+#include <string.h>
 
 #include "partitioner.h"
 #include "utils.h"
@@ -21,14 +28,24 @@
 #include "tiling.h"
 #include "common.h"
 
-static int* chunk(loop_t* seedLoop, int tileSize,
+static index_t* chunk(loop_t* seedLoop, int tileSize,
                   int* nCore, int* nExec, int* nNonExec, int nThreads);
-static int* inherit(loop_t* seedLoop, int tileSize, map_list* partitionings,
+static index_t* inherit(loop_t* seedLoop, int tileSize, map_list* partitionings,
                     int* nCore, int* nExec, int* nNonExec, int nThreads);
 #ifdef SLOPE_METIS
-static int* metis(loop_t* seedLoop, int tileSize, map_list* meshMaps,
+static index_t* metis(loop_t* seedLoop, int tileSize, map_list* meshMaps,
                   int* nCore, int* nExec, int* nNonExec, int nThreads);
 #endif
+static index_t* sfc(loop_t* seedLoop, int tileSize, map_list* meshMaps,
+                double* coordinates, dimension meshDim, insp_partitioning curve,
+                int* nCore, int* nExec, int* nNonExec, int nThreads);
+static index_t* rcb(loop_t* seedLoop, int tileSize, map_list* meshMaps,
+                double* coordinates, dimension meshDim,
+                int* nCore, int* nExec, int* nNonExec, int nThreads);
+static index_t* graph_grow(loop_t* seedLoop, int tileSize,
+                       int* nCore, int* nExec, int* nNonExec, int nThreads);
+static void build_tiles(inspector_t* insp, index_t* indMap,
+                        int nCore, int nExec, int nNonExec);
 
 void partition (inspector_t* insp)
 {
@@ -37,22 +54,31 @@ void partition (inspector_t* insp)
   map_list* meshMaps = insp->meshMaps;
   map_list* partitionings = insp->partitionings;
   int tileSize = insp->avgTileSize;
-  int prefetchHalo = insp->prefetchHalo;
-  loop_list* loops = insp->loops;
-  int nLoops = loops->size();
   int seed = insp->seed;
   loop_t* seedLoop = insp->loops->at(seed);
-  set_t* seedLoopSet = seedLoop->set;
-  int setSize = seedLoopSet->size;
   int nThreads = insp->nThreads;
 
   // partition the seed loop iteration space
-  int* indMap = NULL;
+  index_t* indMap = NULL;
   int nCore, nExec, nNonExec;
   if (partitionings) {
     indMap = inherit (seedLoop, tileSize, partitionings, &nCore, &nExec, &nNonExec, nThreads);
     insp->partitioningMode = "inherited";
   }
+  if (! indMap && (insp->partitioning == PART_HILBERT || insp->partitioning == PART_MORTON)) {
+    indMap = sfc (seedLoop, tileSize, meshMaps, insp->coordinates, insp->meshDim,
+                  insp->partitioning, &nCore, &nExec, &nNonExec, nThreads);
+    insp->partitioningMode = (insp->partitioning == PART_HILBERT) ? "hilbert" : "morton";
+  }
+  if (! indMap && insp->partitioning == PART_RCB) {
+    indMap = rcb (seedLoop, tileSize, meshMaps, insp->coordinates, insp->meshDim,
+                  &nCore, &nExec, &nNonExec, nThreads);
+    insp->partitioningMode = "rcb";
+  }
+  if (! indMap && insp->partitioning == PART_BFS) {
+    indMap = graph_grow (seedLoop, tileSize, &nCore, &nExec, &nNonExec, nThreads);
+    insp->partitioningMode = "bfs";
+  }
 #ifdef SLOPE_METIS
   if (! indMap && meshMaps) {
     indMap = metis (seedLoop, tileSize, meshMaps, &nCore, &nExec, &nNonExec, nThreads);
@@ -64,23 +90,184 @@ void partition (inspector_t* insp)
     insp->partitioningMode = "chunk";
   }
 
+  build_tiles (insp, indMap, nCore, nExec, nNonExec);
+}
+
+void partition_from (inspector_t* insp, index_t* indMap, int nCore, int nExec, int nNonExec)
+{
+  partition_free (insp);
+
+  build_tiles (insp, indMap, nCore, nExec, nNonExec);
+}
+
+void partition_merge (inspector_t* insp, map_t* tileGraph, bool* merge)
+{
+  // aliases
+  index_t* iter2tile = insp->iter2tile->values;
+  index_t setSize = insp->iter2tile->inSet->size;
+  int nTiles = insp->tiles->size();
+  int nCore = insp->tileRegions->core;
+
+  index_t* sizes = new index_t[nTiles]();
+  for (index_t i = 0; i < setSize; i++) {
+    sizes[iter2tile[i]]++;
+  }
+
+  // match each core tile to be merged with its smallest unmatched core neighbour,
+  // if any; all other tiles are matched with themselves
+  int* match = new int[nCore];
+  std::fill_n (match, nCore, -1);
+  for (int t = 0; t < nCore; t++) {
+    if (match[t] != -1 || ! merge[t]) {
+      continue;
+    }
+    match[t] = t;
+    for (index_t j = tileGraph->offsets[t]; j < tileGraph->offsets[t + 1]; j++) {
+      int n = tileGraph->values[j];
+      if (n < nCore && match[n] == -1 && (match[t] == t || sizes[n] < sizes[match[t]])) {
+        match[t] = n;
+      }
+    }
+    match[match[t]] = t;
+  }
+  for (int t = 0; t < nCore; t++) {
+    match[t] = (match[t] == -1) ? t : match[t];
+  }
+
+  // renumber the tiles, a pair of matched tiles becoming a single tile
+  int* newIDs = new int[nTiles];
+  int newCore = 0;
+  for (int t = 0; t < nCore; t++) {
+    if (match[t] >= t) {
+      newIDs[t] = newIDs[match[t]] = newCore++;
+    }
+  }
+  for (int t = nCore; t < nTiles; t++) {
+    newIDs[t] = t - nCore + newCore;
+  }
+
+  index_t* indMap = new index_t[setSize];
+  for (index_t i = 0; i < setSize; i++) {
+    indMap[i] = newIDs[iter2tile[i]];
+  }
+
+  delete[] sizes;
+  delete[] match;
+  delete[] newIDs;
+
+  partition_replace (insp, indMap, newCore);
+}
+
+void partition_split (inspector_t* insp, bool* split)
+{
+  // aliases
+  index_t* iter2tile = insp->iter2tile->values;
+  index_t setSize = insp->iter2tile->inSet->size;
+  int nTiles = insp->tiles->size();
+  int nCore = insp->tileRegions->core;
+
+  index_t* sizes = new index_t[nTiles]();
+  for (index_t i = 0; i < setSize; i++) {
+    sizes[iter2tile[i]]++;
+  }
+
+  // renumber the tiles, the two halves of a split tile getting consecutive IDs
+  int* newIDs = new int[nTiles];
+  int newCore = 0;
+  for (int t = 0; t < nCore; t++) {
+    newIDs[t] = newCore;
+    newCore += (split[t] && sizes[t] > 1) ? 2 : 1;
+  }
+  for (int t = nCore; t < nTiles; t++) {
+    newIDs[t] = t - nCore + newCore;
+  }
+
+  // the first half of the iterations of a split tile, in increasing order,
+  // stays in the first new tile
+  index_t* seen = new index_t[nTiles]();
+  index_t* indMap = new index_t[setSize];
+  for (index_t i = 0; i < setSize; i++) {
+    int t = iter2tile[i];
+    bool secondHalf = t < nCore && split[t] && sizes[t] > 1 && seen[t]++ >= (sizes[t] + 1) / 2;
+    indMap[i] = newIDs[t] + (secondHalf ? 1 : 0);
+  }
+
+  delete[] sizes;
+  delete[] newIDs;
+  delete[] seen;
+
+  partition_replace (insp, indMap, newCore);
+}
+
+void partition_replace (inspector_t* insp, index_t* indMap, int nCore)
+{
+  // aliases
+  int nExec = insp->tileRegions->execHalo;
+  int nNonExec = insp->tileRegions->nonExecHalo;
+
+  partition_from (insp, indMap, nCore, nExec, nNonExec);
+}
+
+void partition_free (inspector_t* insp)
+{
+  // aliases
+  tile_list* tiles = insp->tiles;
+
+  // the cached inverse would otherwise be returned for a new map at the same address
+  inverse_maps_erase (insp->inverseMaps, insp->iter2tile);
+  map_free (insp->iter2tile, true);
+  map_free (insp->iter2color, true);
+  insp->iter2tile = NULL;
+  insp->iter2color = NULL;
+  if (tiles) {
+    tile_list::const_iterator it, end;
+    for (it = tiles->begin(), end = tiles->end(); it != end; it++) {
+      tile_free (*it);
+    }
+    delete tiles;
+    insp->tiles = NULL;
+  }
+  set_free (insp->tileRegions);
+  insp->tileRegions = NULL;
+}
+
+/*
+ * Create the tiles of the seed loop partitioning /indMap/, made of /nCore/
+ * core tiles, /nExec/ exec halo tiles, and /nNonExec/ non exec halo tiles
+ */
+static void build_tiles(inspector_t* insp, index_t* indMap,
+                        int nCore, int nExec, int nNonExec)
+{
+  // aliases
+  int prefetchHalo = insp->prefetchHalo;
+  loop_list* loops = insp->loops;
+  int nLoops = loops->size();
+  loop_t* seedLoop = loops->at(insp->seed);
+  set_t* seedLoopSet = seedLoop->set;
+  index_t setSize = seedLoopSet->size;
+
   // initialize tiles:
   // ... start with creating as many empty tiles as needed ...
   int t;
   tile_list* tiles = new tile_list (nCore + nExec + nNonExec);
   for (t = 0; t < nCore; t++) {
-    tiles->at(t) = tile_init (nLoops, LOCAL, prefetchHalo);
+    tiles->at(t) = tile_init (t, nLoops, LOCAL, prefetchHalo);
   }
   for (; t < nCore + nExec; t++) {
-    tiles->at(t) = tile_init (nLoops, EXEC_HALO, prefetchHalo);
+    tiles->at(t) = tile_init (t, nLoops, EXEC_HALO, prefetchHalo);
   }
   for (; t < nCore + nExec + nNonExec; t++) {
-    tiles->at(t) = tile_init (nLoops, NON_EXEC_HALO, prefetchHalo);
+    tiles->at(t) = tile_init (t, nLoops, NON_EXEC_HALO, prefetchHalo);
   }
   // ... explicitly track the tile region (core, exec_halo, and non_exec_halo) ...
   set_t* tileRegions = set("tiles", nCore, nExec, nNonExec);
   // ... and, finally, map the partitioned seed loop to tiles
-  assign_loop (seedLoop, loops, tiles, indMap, SEED);
+  tc_t* iter2tc = new tc_t[setSize];
+  for (index_t i = 0; i < setSize; i++) {
+    iter2tc[i] = tc_pack (indMap[i], 0);
+  }
+  assign_loop (seedLoop, loops, tiles, iter2tc, SEED);
+  delete[] iter2tc;
 
   insp->tileRegions = tileRegions;
   insp->iter2tile = map ("i2t", set_cpy(seedLoopSet), set_cpy(tileRegions), indMap, setSize);
@@ -90,13 +277,12 @@ void partition (inspector_t* insp)
 /*
  * Chunk-partition halo regions
  */
-static void chunk_halo(loop_t* seedLoop, int tileSize, int tileID, int* indMap,
+static void chunk_halo(loop_t* seedLoop, int tileSize, int tileID, index_t* indMap,
                        int* nExec, int* nNonExec, int nThreads)
 {
-  int setCore = seedLoop->set->core;
-  int setExecHalo = seedLoop->set->execHalo;
-  int setNonExecHalo = seedLoop->set->nonExecHalo;
-  int setSize = seedLoop->set->size;
+  index_t setCore = seedLoop->set->core;
+  index_t setExecHalo = seedLoop->set->execHalo;
+  index_t setNonExecHalo = seedLoop->set->nonExecHalo;
 
   // partition the exec halo region
   // this region is expected to be much smaller than core, so we first shrunk
@@ -104,7 +290,7 @@ static void chunk_halo(loop_t* seedLoop, int tileSize, int tileID, int* indMap,
   if (nThreads > 1) {
     tileSize = setExecHalo / nThreads;
   }
-  int i = 0;
+  index_t i = 0;
   int nParts = (setExecHalo > 0) ? setExecHalo / tileSize : 0;
   int remainderTileSize = (setExecHalo > 0) ? setExecHalo % tileSize : 0;
   *nExec = nParts + ((remainderTileSize > 0) ? 1 : 0);
@@ -132,17 +318,17 @@ static void chunk_halo(loop_t* seedLoop, int tileSize, int tileID, int* indMap,
 /*
  * Assign loop iterations to tiles sequentially as blocks of /tileSize/ elements
  */
-static int* chunk(loop_t* seedLoop, int tileSize, int* nCore, int* nExec,
+static index_t* chunk(loop_t* seedLoop, int tileSize, int* nCore, int* nExec,
                   int* nNonExec, int nThreads)
 {
-  int setCore = seedLoop->set->core;
-  int setExecHalo = seedLoop->set->execHalo;
-  int setSize = seedLoop->set->size;
+  index_t setCore = seedLoop->set->core;
+  index_t setExecHalo = seedLoop->set->execHalo;
+  index_t setSize = seedLoop->set->size;
 
   // partition the local core region
-  int i = 0;
+  index_t i = 0;
   int tileID = -1;
-  int* indMap = new int[setSize];
+  index_t* indMap = new index_t[setSize];
   int nParts = setCore / tileSize;
   int remainderTileSize = setCore % tileSize;
   *nCore = nParts + ((remainderTileSize > 0) ? 1 : 0);
@@ -165,7 +351,7 @@ static int* chunk(loop_t* seedLoop, int tileSize, int* nCore, int* nExec,
  * Assign loop iterations to tiles simply inheriting a seed loop partitioning
  * provided to the inspector.
  */
-static int* inherit(loop_t* seedLoop, int tileSize, map_list* partitionings,
+static index_t* inherit(loop_t* seedLoop, int tileSize, map_list* partitionings,
                     int* nCore, int* nExec, int* nNonExec, int nThreads)
 {
   map_t* partitioning = NULL;
@@ -180,25 +366,25 @@ static int* inherit(loop_t* seedLoop, int tileSize, map_list* partitionings,
     return NULL;
   }
 
-  int setCore = seedLoop->set->core;
-  int setSize = seedLoop->set->size;
-  int* indMap = new int[setSize];
+  index_t setCore = seedLoop->set->core;
+  index_t setSize = seedLoop->set->size;
+  index_t* indMap = new index_t[setSize];
 
   ASSERT(partitioning->size == setSize, "Set partitioning size and seed loop size don't match");
 
   // need to work on a copy because we can't modify an array provided by the user
-  memcpy (indMap, partitioning->values, sizeof(int)*setSize);
+  memcpy (indMap, partitioning->values, sizeof(index_t)*setSize);
 
   // restrict partitions to the core region
   std::fill (indMap + setCore, indMap + setSize, 0);
-  std::set<int> partitions (indMap, indMap + setCore);
+  std::set<index_t> partitions (indMap, indMap + setCore);
   // ensure the set of partitions IDs is compact (i.e., if we have a partitioning
   // 0: {0,1,...}, 1: {4,5,...}, 2: {}, 3: {6,10,...} ...
   // we instead want to have
   // 0: {0,1,...}, 1: {4,5,...}, 2: {6,10,...}, ...
-  int i;
-  std::map<int, int> mapper;
-  std::set<int>::const_iterator sIt, sEnd;
+  index_t i;
+  std::map<index_t, int> mapper;
+  std::set<index_t>::const_iterator sIt, sEnd;
   for (i = 0, sIt = partitions.begin(), sEnd = partitions.end(); sIt != sEnd; sIt++, i++) {
     mapper[*sIt] = i;
   }
@@ -215,66 +401,21 @@ static int* inherit(loop_t* seedLoop, int tileSize, map_list* partitionings,
 
 #ifdef SLOPE_METIS
 
-void get_adjncy_and_offsets(map_t* map, int** adjncy, int** offsets)
+void get_adjncy_and_offsets(map_t* map, index_t** adjncy, index_t** offsets)
 {
-  // map should be of type e2n. Edges are partitioned after creating a line graph considering
-  // edges as nodes.
-  int nElements = map->inSet->size;
-  int nNodes = map->outSet->size;
-
-  std::set<int>* e2e  = new std::set<int>[nElements];
-  std::set<int>* n2e  = new std::set<int>[nNodes];
-
-  // create line graph
-  for(int i = 0; i < map->size; i++){
-    int node = map->values[i];
-    int edgeID = i / 2;
-    std::set<int>* edgesConnectedToNode = &n2e[node];
-    std::set<int>* edgesConnectedToEdge = &e2e[edgeID];
-
-    for(auto edge : *edgesConnectedToNode){
-      (&e2e[edge])->insert(edgeID);
-      edgesConnectedToEdge->insert(edge);   
-    }
-    edgesConnectedToNode->insert(edgeID);
-  }
-
-  // get adjancy array size
-  int adjncyArraySize = 0;
-  for(int i = 0; i < nElements; i++){
-    adjncyArraySize += (&e2e[i])->size();    
-  }
-
-  *adjncy = new int[adjncyArraySize];
-  *offsets = new int[nElements + 1];
-
-  int index = 0;
-  (*offsets)[0] = 0;
-
-  for(int i = 0; i < nElements; i++){
-    std::set<int>* edges = &e2e[i]; 
-
-    for(auto edge : *edges){
-      (*adjncy)[index++] = edge;    
-    }
-    (*offsets)[i + 1] = index;   
-  }
-
-  delete[] e2e;
-  delete[] n2e;
-
+  map_line_graph (map, map->inSet->size, offsets, adjncy);
 }
 
 /*
  * Assign loop iterations to tiles carving partitions out of /seedLoop/ using
  * the METIS library.
  */
-static int* metis(loop_t* seedLoop, int tileSize, map_list* meshMaps,
+static index_t* metis(loop_t* seedLoop, int tileSize, map_list* meshMaps,
                   int* nCore, int* nExec, int* nNonExec, int nThreads)
 {
-  int i;
-  int setCore = seedLoop->set->core;
-  int setSize = seedLoop->set->size;
+  index_t i;
+  index_t setCore = seedLoop->set->core;
+  index_t setSize = seedLoop->set->size;
 
   // use the mesh description to find a suitable map for partitioning through METIS
   map_t* map = NULL;
@@ -293,65 +434,45 @@ static int* metis(loop_t* seedLoop, int tileSize, map_list* meshMaps,
   }
 
   // now partition through METIS:
-  // ... mesh geometry
-  int nElements = map->inSet->size;
-  int nNodes = map->outSet->size;
-  int nParts = nElements / tileSize;
-  int arity = map->size / nElements;
+  // ... the graph of the seed loop iterations is the line graph of /map/ if
+  // the seed loop iterates over the input set of /map/, or the line graph of
+  // its inverse otherwise (e.g., nodes sharing a cell)
+  map_t* graphMap = set_eq(seedLoop->set, map->inSet) ? map : map_invert (map, NULL);
+  idx_t nElements = graphMap->inSet->size;
+  idx_t nParts = std::max(nElements / tileSize, (idx_t)1);
   // ... data needed for partitioning
-  int* indMap = new int[nElements];
-  int* indNodesMap = new int[nNodes];
-  int* adjncy = nullptr;
-  int* offsets = nullptr;
-  if(arity == 2){
-    get_adjncy_and_offsets(map, &adjncy, &offsets);
-  }else{
-    adjncy = map->values;
-    offsets = new int[nElements+1]();
-    for (i = 1; i < nElements+1; i++) {
-      offsets[i] = offsets[i-1] + arity;
-    }
+  index_t* indMap = new index_t[nElements];
+  index_t* adjncy;
+  index_t* offsets;
+  get_adjncy_and_offsets (graphMap, &adjncy, &offsets);
+  if (graphMap != map) {
+    map_free (graphMap, true);
   }
-  
+
   // ... options
-  int result, objval, ncon = 1;
-  int options[METIS_NOPTIONS];
+  int result;
+  idx_t objval, ncon = 1;
+  idx_t options[METIS_NOPTIONS];
   METIS_SetDefaultOptions(options);
   options[METIS_OPTION_NUMBERING] = 0;
   options[METIS_OPTION_CONTIG] = 1;
   // ... do partition!
-  result = (arity == 2) ?
-    METIS_PartGraphKway (&nElements, &ncon, offsets, adjncy, NULL, NULL, NULL,
-                         &nParts, NULL, NULL, options, &objval, indMap) :
-    METIS_PartMeshNodal (&nElements, &nNodes, offsets, adjncy, NULL, NULL,
-                         &nParts, NULL, options, &objval, indMap, indNodesMap);
+  result = METIS_PartGraphKway (&nElements, &ncon, offsets, adjncy, NULL, NULL, NULL,
+                                &nParts, NULL, NULL, options, &objval, indMap);
   ASSERT(result == METIS_OK, "Invalid METIS partitioning");
 
-
-  // what's the target iteration set ?
-  if (set_eq(seedLoop->set, map->inSet)) {
-    delete[] indNodesMap;
-  }
-  else {
-    // note: must be set_eq(seedLoop->set, map-outSet)
-    delete[] indMap;
-    indMap = indNodesMap;
-  }
   delete[] offsets;
-
-  if(arity == 2){
-    delete[] adjncy;
-  }
+  delete[] adjncy;
 
   // restrict partitions to the core region
   std::fill (indMap + setCore, indMap + setSize, 0);
-  std::set<int> partitions (indMap, indMap + setCore);
+  std::set<index_t> partitions (indMap, indMap + setCore);
   // ensure the set of partitions IDs is compact (i.e., if we have a partitioning
   // 0: {0,1,...}, 1: {4,5,...}, 2: {}, 3: {6,10,...} ...
   // we instead want to have
   // 0: {0,1,...}, 1: {4,5,...}, 2: {6,10,...}, ...
-  std::map<int, int> mapper;
-  std::set<int>::const_iterator sIt, sEnd;
+  std::map<index_t, int> mapper;
+  std::set<index_t>::const_iterator sIt, sEnd;
   for (i = 0, sIt = partitions.begin(), sEnd = partitions.end(); sIt != sEnd; sIt++, i++) {
     mapper[*sIt] = i;
   }
@@ -366,3 +487,463 @@ static int* metis(loop_t* seedLoop, int tileSize, map_list* meshMaps,
   return indMap;
 }
 #endif
+
+/*
+ * Compute the coordinates of the core iterations of /seedLoop/, as the centroids
+ * of the mesh nodes they are mapped to. Return NULL if the coordinates are not
+ * available or if there is no map from the seed loop iteration set to nodes.
+ */
+static double* seed_coordinates(loop_t* seedLoop, map_list* meshMaps,
+                                double* coordinates, int nDims)
+{
+  if (! coordinates || ! meshMaps || meshMaps->empty()) {
+    return NULL;
+  }
+
+  index_t setCore = seedLoop->set->core;
+  set_t* nodes = (*meshMaps->begin())->outSet;
+  double* seedCoordinates = new double[setCore*nDims];
+
+  if (set_eq(seedLoop->set, nodes)) {
+    memcpy (seedCoordinates, coordinates, sizeof(double)*setCore*nDims);
+    return seedCoordinates;
+  }
+
+  // look for a map from the seed loop iteration set to nodes, first in the
+  // mesh description and then among the maps accessed by the seed loop
+  map_t* map = NULL;
+  map_list::const_iterator it, end;
+  for (it = meshMaps->begin(), end = meshMaps->end(); it != end && ! map; it++) {
+    map = set_eq(seedLoop->set, (*it)->inSet) ? *it : NULL;
+  }
+  desc_list::const_iterator dIt, dEnd;
+  desc_list* descriptors = seedLoop->descriptors;
+  for (dIt = descriptors->begin(), dEnd = descriptors->end(); dIt != dEnd && ! map; dIt++) {
+    map_t* descMap = (*dIt)->map;
+    map = (descMap != DIRECT && set_eq(descMap->inSet, seedLoop->set) &&
+           set_eq(descMap->outSet, nodes)) ? descMap : NULL;
+  }
+  if (! map) {
+    delete[] seedCoordinates;
+    return NULL;
+  }
+
+  index_t* offsets = map->offsets;
+  int arity = offsets ? 0 : map->size / map->inSet->size;
+  #pragma omp parallel for schedule(static)
+  for (index_t i = 0; i < setCore; i++) {
+    int nValid = 0;
+    double* centroid = seedCoordinates + i*nDims;
+    std::fill (centroid, centroid + nDims, 0.0);
+    index_t end = offsets ? offsets[i + 1] : (i + 1)*arity;
+    for (index_t j = offsets ? offsets[i] : i*arity; j < end; j++) {
+      index_t node = map->values[j];
+      if (node == -1) {
+        // off-processor node
+        continue;
+      }
+      for (int d = 0; d < nDims; d++) {
+        centroid[d] += coordinates[node*nDims + d];
+      }
+      nValid++;
+    }
+    for (int d = 0; d < nDims && nValid; d++) {
+      centroid[d] /= nValid;
+    }
+  }
+
+  return seedCoordinates;
+}
+
+/*
+ * Sort /values/ using /nThreads/ threads: chunks are sorted independently and
+ * then merged pairwise
+ */
+static void parallel_sort(uint64_t* values, index_t size, int nThreads)
+{
+  std::vector<index_t> bounds (nThreads + 1);
+  for (int i = 0; i <= nThreads; i++) {
+    bounds[i] = (long)size*i / nThreads;
+  }
+
+  #pragma omp parallel for schedule(static, 1)
+  for (int i = 0; i < nThreads; i++) {
+    std::sort (values + bounds[i], values + bounds[i + 1]);
+  }
+  for (int width = 1; width < nThreads; width *= 2) {
+    #pragma omp parallel for schedule(static, 1)
+    for (int i = 0; i < nThreads; i += 2*width) {
+      index_t middle = bounds[std::min(i + width, nThreads)];
+      index_t end = bounds[std::min(i + 2*width, nThreads)];
+      std::inplace_merge (values + bounds[i], values + middle, values + end);
+    }
+  }
+}
+
+/*
+ * Return the position along a Hilbert curve of a point with integer coordinates
+ * /x/, each of /bits/ bits. This uses the transposition algorithm of J. Skilling,
+ * "Programming the Hilbert curve", AIP Conference Proceedings 707, 2004.
+ * Note: /x/ is overwritten.
+ */
+static uint32_t hilbert_key(uint32_t* x, int nDims, int bits)
+{
+  uint32_t t;
+
+  // inverse undo excess work
+  for (uint32_t q = 1u << (bits - 1); q > 1; q >>= 1) {
+    uint32_t p = q - 1;
+    for (int i = 0; i < nDims; i++) {
+      if (x[i] & q) {
+        x[0] ^= p;
+      }
+      else {
+        t = (x[0] ^ x[i]) & p;
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+    }
+  }
+
+  // gray encode
+  for (int i = 1; i < nDims; i++) {
+    x[i] ^= x[i - 1];
+  }
+  t = 0;
+  for (uint32_t q = 1u << (bits - 1); q > 1; q >>= 1) {
+    if (x[nDims - 1] & q) {
+      t ^= q - 1;
+    }
+  }
+  for (int i = 0; i < nDims; i++) {
+    x[i] ^= t;
+  }
+
+  // the transposed coordinates are interleaved as in a Morton curve
+  uint32_t key = 0;
+  for (int b = bits - 1; b >= 0; b--) {
+    for (int i = 0; i < nDims; i++) {
+      key = (key << 1) | ((x[i] >> b) & 1);
+    }
+  }
+  return key;
+}
+
+/*
+ * Return the position along a Morton (Z-order) curve of a point with integer
+ * coordinates /x/, each of /bits/ bits
+ */
+static uint32_t morton_key(uint32_t* x, int nDims, int bits)
+{
+  uint32_t key = 0;
+  for (int b = bits - 1; b >= 0; b--) {
+    for (int i = 0; i < nDims; i++) {
+      key = (key << 1) | ((x[i] >> b) & 1);
+    }
+  }
+  return key;
+}
+
+/*
+ * Assign loop iterations to tiles sorting them along a space-filling curve (the
+ * coordinates of an iteration being the centroid of the nodes it touches), and
+ * then cutting the curve into blocks of /tileSize/ iterations.
+ */
+static index_t* sfc(loop_t* seedLoop, int tileSize, map_list* meshMaps,
+                double* coordinates, dimension meshDim, insp_partitioning curve,
+                int* nCore, int* nExec, int* nNonExec, int nThreads)
+{
+  index_t setCore = seedLoop->set->core;
+  index_t setSize = seedLoop->set->size;
+  int nDims = meshDim;
+
+  // the iteration IDs are stored in the lower 32 bits of the sort keys
+  ASSERT((uint64_t)setCore <= UINT32_MAX, "Too many iterations for space-filling curves");
+
+  double* seedCoordinates = seed_coordinates (seedLoop, meshMaps, coordinates, nDims);
+  if (! seedCoordinates || ! setCore) {
+    delete[] seedCoordinates;
+    return NULL;
+  }
+
+  // scale the bounding box of the seed iterations to a grid of 2^bits points
+  // per dimension, such that a key fits in 32 bits
+  int bits = 32 / nDims;
+  double low[DIM3], high[DIM3];
+  for (int d = 0; d < nDims; d++) {
+    low[d] = high[d] = seedCoordinates[d];
+  }
+  for (index_t i = 0; i < setCore; i++) {
+    for (int d = 0; d < nDims; d++) {
+      low[d] = std::min(low[d], seedCoordinates[i*nDims + d]);
+      high[d] = std::max(high[d], seedCoordinates[i*nDims + d]);
+    }
+  }
+  double extent = 0.0;
+  for (int d = 0; d < nDims; d++) {
+    extent = std::max(extent, high[d] - low[d]);
+  }
+  double scale = (extent > 0.0) ? (double)((1ULL << bits) - 1) / extent : 0.0;
+
+  // sort the iterations by key; ties are broken by iteration ID
+  uint64_t* keys = new uint64_t[setCore];
+  #pragma omp parallel for schedule(static)
+  for (index_t i = 0; i < setCore; i++) {
+    uint32_t x[DIM3];
+    for (int d = 0; d < nDims; d++) {
+      x[d] = (uint32_t)((seedCoordinates[i*nDims + d] - low[d])*scale);
+    }
+    uint32_t key = (curve == PART_HILBERT) ? hilbert_key (x, nDims, bits) :
+                                             morton_key (x, nDims, bits);
+    keys[i] = ((uint64_t)key << 32) | i;
+  }
+  parallel_sort (keys, setCore, nThreads);
+
+  // cut the curve into tiles of (roughly) /tileSize/ iterations
+  index_t* indMap = new index_t[setSize];
+  int nParts = std::max(setCore / tileSize, (index_t)1);
+  #pragma omp parallel for schedule(static)
+  for (index_t i = 0; i < setCore; i++) {
+    indMap[(uint32_t)keys[i]] = (long)i*nParts / setCore;
+  }
+  *nCore = nParts;
+
+  delete[] keys;
+  delete[] seedCoordinates;
+
+  // partition the exec halo region
+  chunk_halo (seedLoop, tileSize, *nCore - 1, indMap, nExec, nNonExec, nThreads);
+
+  return indMap;
+}
+
+/*
+ * Recursively split /elements/ into /nParts/ parts of balanced size, cutting
+ * along the dimension of largest extent
+ */
+static void bisect(index_t* elements, index_t size, double* coordinates, int nDims,
+                   int firstPart, int nParts, index_t* indMap)
+{
+  if (nParts == 1) {
+    for (index_t i = 0; i < size; i++) {
+      indMap[elements[i]] = firstPart;
+    }
+    return;
+  }
+
+  int dim = 0;
+  double maxExtent = -1.0;
+  for (int d = 0; d < nDims; d++) {
+    double low = coordinates[elements[0]*nDims + d];
+    double high = low;
+    for (index_t i = 1; i < size; i++) {
+      low = std::min(low, coordinates[elements[i]*nDims + d]);
+      high = std::max(high, coordinates[elements[i]*nDims + d]);
+    }
+    if (high - low > maxExtent) {
+      maxExtent = high - low;
+      dim = d;
+    }
+  }
+
+  int leftParts = nParts / 2;
+  index_t leftSize = (long)size*leftParts / nParts;
+  std::nth_element (elements, elements + leftSize, elements + size,
+                    [coordinates, nDims, dim] (index_t a, index_t b) {
+                      double ca = coordinates[a*nDims + dim];
+                      double cb = coordinates[b*nDims + dim];
+                      return ca < cb || (ca == cb && a < b);
+                    });
+
+  #pragma omp task if (size > 4096)
+  bisect (elements, leftSize, coordinates, nDims, firstPart, leftParts, indMap);
+  bisect (elements + leftSize, size - leftSize, coordinates, nDims,
+          firstPart + leftParts, nParts - leftParts, indMap);
+  #pragma omp taskwait
+}
+
+/*
+ * Assign loop iterations to tiles through recursive coordinate bisection (the
+ * coordinates of an iteration being the centroid of the nodes it touches).
+ */
+static index_t* rcb(loop_t* seedLoop, int tileSize, map_list* meshMaps,
+                double* coordinates, dimension meshDim,
+                int* nCore, int* nExec, int* nNonExec, int nThreads)
+{
+  index_t setCore = seedLoop->set->core;
+  index_t setSize = seedLoop->set->size;
+  int nDims = meshDim;
+
+  double* seedCoordinates = seed_coordinates (seedLoop, meshMaps, coordinates, nDims);
+  if (! seedCoordinates || ! setCore) {
+    delete[] seedCoordinates;
+    return NULL;
+  }
+
+  index_t* indMap = new index_t[setSize];
+  index_t* elements = new index_t[setCore];
+  for (index_t i = 0; i < setCore; i++) {
+    elements[i] = i;
+  }
+  int nParts = std::max(setCore / tileSize, (index_t)1);
+
+  #pragma omp parallel num_threads(nThreads)
+  {
+    #pragma omp single
+    bisect (elements, setCore, seedCoordinates, nDims, 0, nParts, indMap);
+  }
+  *nCore = nParts;
+
+  delete[] elements;
+  delete[] seedCoordinates;
+
+  // partition the exec halo region
+  chunk_halo (seedLoop, tileSize, *nCore - 1, indMap, nExec, nNonExec, nThreads);
+
+  return indMap;
+}
+
+/*
+ * Assign loop iterations to tiles by greedy graph growing on the adjacency graph
+ * of the seed loop iterations, which is derived from /seedLoop->seedMap/ alone.
+ * Tiles are grown one at a time through a breadth-first search, each starting
+ * from the boundary of the previous ones, until they reach their share of the
+ * iterations. A boundary refinement pass then moves iterations to the adjacent
+ * tile they share most neighbours with, as long as tile sizes stay balanced.
+ */
+static index_t* graph_grow(loop_t* seedLoop, int tileSize,
+                       int* nCore, int* nExec, int* nNonExec, int nThreads)
+{
+  index_t setCore = seedLoop->set->core;
+  index_t setSize = seedLoop->set->size;
+  map_t* seedMap = seedLoop->seedMap;
+
+  if (! seedMap || ! setCore) {
+    return NULL;
+  }
+
+  index_t* offsets;
+  index_t* adjncy;
+  map_line_graph (seedMap, setCore, &offsets, &adjncy);
+
+  index_t* indMap = new index_t[setSize];
+  std::fill (indMap, indMap + setCore, -1);
+  int nParts = std::max(setCore / tileSize, (index_t)1);
+  std::vector<index_t> partSize (nParts, 0);
+
+  // start from a pseudo-peripheral iteration, that is the last one reached by a
+  // breadth-first search from iteration 0, so that tiles sweep the mesh from one
+  // end rather than being squeezed around a central tile
+  index_t* queue = new index_t[setCore];
+  int* visited = new int[setCore];
+  std::fill (visited, visited + setCore, -1);
+  index_t head = 0, tail = 0;
+  queue[tail++] = 0;
+  visited[0] = 0;
+  while (head < tail) {
+    index_t v = queue[head++];
+    for (index_t k = offsets[v]; k < offsets[v + 1]; k++) {
+      if (visited[adjncy[k]] == -1) {
+        visited[adjncy[k]] = 0;
+        queue[tail++] = adjncy[k];
+      }
+    }
+  }
+  index_t start = queue[tail - 1];
+
+  // grow the tiles; /visited/ records the last tile whose search reached an
+  // iteration, while /frontier/ keeps the iterations reached but not taken by
+  // previous tiles, from which later tiles start
+  std::fill (visited, visited + setCore, -1);
+  std::vector<index_t> frontier;
+  frontier.push_back (start);
+  index_t nextFrontier = 0, nextUnassigned = 0, nAssigned = 0;
+  for (int p = 0; p < nParts; p++) {
+    index_t target = (setCore - nAssigned) / (nParts - p);
+    head = tail = 0;
+    while (partSize[p] < target) {
+      if (head == tail) {
+        // pick a new starting point: preferably next to the tiles grown so far,
+        // otherwise the first iteration not assigned yet (disconnected meshes)
+        index_t v = -1;
+        while (nextFrontier < (index_t)frontier.size() && v == -1) {
+          v = frontier[nextFrontier++];
+          v = (indMap[v] == -1 && visited[v] != p) ? v : -1;
+        }
+        while (v == -1) {
+          v = (indMap[nextUnassigned] == -1) ? nextUnassigned : -1;
+          nextUnassigned++;
+        }
+        head = tail = 0;
+        queue[tail++] = v;
+        visited[v] = p;
+      }
+      index_t v = queue[head++];
+      indMap[v] = p;
+      partSize[p]++;
+      for (index_t k = offsets[v]; k < offsets[v + 1]; k++) {
+        index_t u = adjncy[k];
+        if (indMap[u] == -1 && visited[u] != p) {
+          visited[u] = p;
+          queue[tail++] = u;
+        }
+      }
+    }
+    nAssigned += partSize[p];
+    frontier.insert (frontier.end(), queue + head, queue + tail);
+  }
+  delete[] queue;
+  delete[] visited;
+
+  // boundary refinement: move an iteration to the adjacent tile it has most
+  // neighbours in, as long as that reduces the cut and keeps tiles balanced
+  index_t minSize = std::max((index_t)(0.97*setCore / nParts), (index_t)1);
+  index_t maxSize = (index_t)(1.03*setCore / nParts) + 1;
+  std::vector<std::pair<int, int> > counts;
+  for (int pass = 0; pass < 2; pass++) {
+    index_t nMoves = 0;
+    for (index_t v = 0; v < setCore; v++) {
+      int p = indMap[v];
+      counts.clear();
+      for (index_t k = offsets[v]; k < offsets[v + 1]; k++) {
+        int q = indMap[adjncy[k]];
+        size_t c = 0;
+        while (c < counts.size() && counts[c].first != q) {
+          c++;
+        }
+        if (c == counts.size()) {
+          counts.push_back (std::make_pair(q, 0));
+        }
+        counts[c].second++;
+      }
+      int internal = 0, best = p, bestCount = 0;
+      for (size_t c = 0; c < counts.size(); c++) {
+        if (counts[c].first == p) {
+          internal = counts[c].second;
+        }
+        else if (counts[c].second > bestCount) {
+          best = counts[c].first;
+          bestCount = counts[c].second;
+        }
+      }
+      if (bestCount > internal && partSize[p] > minSize && partSize[best] < maxSize) {
+        indMap[v] = best;
+        partSize[p]--;
+        partSize[best]++;
+        nMoves++;
+      }
+    }
+    if (! nMoves) {
+      break;
+    }
+  }
+  *nCore = nParts;
+
+  delete[] offsets;
+  delete[] adjncy;
+
+  // partition the exec halo region
+  chunk_halo (seedLoop, tileSize, *nCore - 1, indMap, nExec, nNonExec, nThreads);
+
+  return indMap;
+}
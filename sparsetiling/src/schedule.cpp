@@ -8,15 +8,14 @@
 
 #include "schedule.h"
 
-schedule_t* schedule_init (std::string name, int itSetSize, int* iter2tile,
-                           int* iter2color, direction_t direction)
+schedule_t* schedule_init (std::string name, index_t itSetSize, tc_t* iter2tc,
+                           direction_t direction)
 {
   schedule_t* schedule = new schedule_t;
 
   schedule->name = name;
   schedule->itSetSize = itSetSize;
-  schedule->iter2tile = iter2tile;
-  schedule->iter2color = iter2color;
+  schedule->iter2tc = iter2tc;
   schedule->direction = direction;
   schedule->computed = false;
 
@@ -29,13 +28,11 @@ schedule_t* schedule_cpy (schedule_t* toCopy)
 
   schedule->name = toCopy->name;
   schedule->itSetSize = toCopy->itSetSize;
-  schedule->iter2tile = new int[toCopy->itSetSize];
-  schedule->iter2color = new int[toCopy->itSetSize];
+  schedule->iter2tc = new tc_t[toCopy->itSetSize];
   schedule->direction = toCopy->direction;
   schedule->computed = toCopy->computed;
 
-  memcpy (schedule->iter2tile, toCopy->iter2tile, sizeof(int)*toCopy->itSetSize);
-  memcpy (schedule->iter2color, toCopy->iter2color, sizeof(int)*toCopy->itSetSize);
+  memcpy (schedule->iter2tc, toCopy->iter2tc, sizeof(tc_t)*toCopy->itSetSize);
 
   return schedule;
 }
@@ -45,21 +42,57 @@ void schedule_free (schedule_t* schedule)
   if (! schedule) {
     return;
   }
-  delete[] schedule->iter2tile;
-  delete[] schedule->iter2color;
+  delete[] schedule->iter2tc;
   delete schedule;
 }
 
+long schedule_bytes (schedule_t* schedule)
+{
+  return sizeof(schedule_t) + sizeof(tc_t)*schedule->itSetSize;
+}
+
+void schedule_unpack (schedule_t* schedule, int* iter2tile, int* iter2color)
+{
+  for (index_t i = 0; i < schedule->itSetSize; i++) {
+    iter2tile[i] = tc_tile(schedule->iter2tc[i]);
+    iter2color[i] = tc_color(schedule->iter2tc[i]);
+  }
+}
+
 projection_t* projection_init()
 {
   return new projection_t (&schedule_cmp);
 }
 
-void projection_free (projection_t* projection)
+void projection_free (projection_t* projection, projection_t* keep)
 {
   projection_t::iterator it, end;
   for (it = projection->begin(), end = projection->end(); it != end; it++) {
+    if (keep) {
+      projection_t::iterator shared = keep->find (*it);
+      if (shared != keep->end() && *shared == *it) {
+        continue;
+      }
+    }
     schedule_free(*it);
   }
   delete projection;
 }
+
+long projection_bytes (projection_t* projection, projection_t* shared)
+{
+  long bytes = 0;
+  projection_t::iterator it, end;
+  for (it = projection->begin(), end = projection->end(); it != end; it++) {
+    bytes += schedule_bytes (*it);
+  }
+  if (shared) {
+    for (it = shared->begin(), end = shared->end(); it != end; it++) {
+      projection_t::iterator same = projection->find (*it);
+      if (same == projection->end() || *same != *it) {
+        bytes += schedule_bytes (*it);
+      }
+    }
+  }
+  return bytes;
+}
@@ -0,0 +1,384 @@
+/*
+ *  stats.cpp
+ *
+ * Implement the statistics of an inspection
+ */
+
+#include <algorithm>
+
+#include <math.h>
+#include <limits.h>
+
+#include "stats.h"
+#include "common.h"
+#include "utils.h"
+
+using namespace std;
+
+// names of the phases and of the tracked data structures, as in the JSON output
+static const char* phaseNames[N_PHASES] = {"seed_maps", "seed_selection", "partitioning",
+                                           "coloring", "tiling", "projection",
+                                           "assignment", "repair", "reshape",
+                                           "local_maps", "footprints", "quality"};
+static const char* dataNames[N_MEMORY] = {"projections", "trackers", "traces", "tiles",
+                                          "local_maps"};
+
+// prototypes of static functions
+static void quality_accesses (loop_t* loop, tile_list* tiles, loop_stats_t* loopStats);
+static void json_string (ostream& out, string value);
+
+
+insp_stats_t* stats_init()
+{
+  insp_stats_t* stats = new insp_stats_t;
+  stats_reset (stats, NULL);
+  return stats;
+}
+
+void stats_reset (insp_stats_t* stats, loop_list* loops)
+{
+  if (! stats) {
+    return;
+  }
+
+  stats->totalTime = 0.0;
+  fill (stats->times, stats->times + N_PHASES, 0.0);
+  stats->loops.clear();
+  stats->sweeps.clear();
+  stats->colors.clear();
+  stats->criticalPath = 0;
+  stats->efficiency = 0.0;
+  for (int k = 0; k < N_MEMORY; k++) {
+    stats->memory[k].allocated = 0;
+    stats->memory[k].resident = 0;
+    stats->memory[k].peak = 0;
+  }
+
+  int nLoops = loops ? loops->size() : 0;
+  stats->loops.resize (nLoops);
+  for (int i = 0; i < nLoops; i++) {
+    stats->loops[i].name = loops->at(i)->name;
+    fill (stats->loops[i].times, stats->loops[i].times + N_PHASES, 0.0);
+  }
+}
+
+void stats_time (insp_stats_t* stats, stats_phase phase, double time, int loopIndex)
+{
+  if (! stats) {
+    return;
+  }
+
+  stats->times[phase] += time;
+  if (loopIndex != -1) {
+    stats->loops[loopIndex].times[phase] += time;
+  }
+}
+
+void stats_sweep (insp_stats_t* stats, double time, int nColors, int nTiles,
+                  int nConflicts)
+{
+  if (! stats) {
+    return;
+  }
+
+  sweep_stats_t sweep = {time, nColors, nTiles, nConflicts, 0, 0, 0.0};
+  stats->sweeps.push_back (sweep);
+}
+
+void stats_repair (insp_stats_t* stats, double time, long nRetiled)
+{
+  if (! stats || stats->sweeps.empty()) {
+    return;
+  }
+
+  sweep_stats_t& sweep = stats->sweeps.back();
+  sweep.nRepairs++;
+  sweep.nRetiled += nRetiled;
+  sweep.repairTime += time;
+}
+
+void stats_memory (insp_stats_t* stats, stats_data kind, long allocated, long resident)
+{
+  if (! stats) {
+    return;
+  }
+
+  memory_stats_t& memory = stats->memory[kind];
+  memory.allocated += allocated;
+  memory.resident = resident;
+  memory.peak = MAX(memory.peak, resident);
+}
+
+void stats_quality (insp_stats_t* stats, loop_list* loops, tile_list* tiles, int seed,
+                    int nCore, int nThreads)
+{
+  if (! stats) {
+    return;
+  }
+
+  // aliases
+  int nLoops = loops->size();
+  int nTiles = tiles->size();
+
+  // measures taken on a previous tiling are discarded
+  stats->colors.clear();
+  stats->criticalPath = 0;
+  stats->efficiency = 0.0;
+
+  // 1) the distribution of the iterations of the core tiles, in each loop (an
+  // empty tile has no prefetch halo)
+  for (int i = 0; i < nLoops && nCore > 0; i++) {
+    loop_stats_t& loopStats = stats->loops[i];
+    long sumSize = 0;
+    double sumSquares = 0.0;
+    loopStats.minSize = INT_MAX;
+    loopStats.maxSize = 0;
+    for (int t = 0; t < nCore; t++) {
+      int size = MAX(tile_loop_size (tiles->at(t), i), 0);
+      loopStats.minSize = MIN(loopStats.minSize, size);
+      loopStats.maxSize = MAX(loopStats.maxSize, size);
+      sumSize += size;
+      sumSquares += (double)size*size;
+    }
+    loopStats.meanSize = (double)sumSize / nCore;
+    double variance = sumSquares / nCore - loopStats.meanSize*loopStats.meanSize;
+    loopStats.stddevSize = sqrt (MAX(variance, 0.0));
+  }
+  double seedSize = (nCore > 0) ? stats->loops[seed].meanSize : 0.0;
+  for (int i = 0; i < nLoops && seedSize > 0.0; i++) {
+    stats->loops[i].growth = stats->loops[i].meanSize / seedSize;
+    stats->loops[i].maxGrowth = stats->loops[i].maxSize / seedSize;
+  }
+
+  // 2) the data touched by the tiles
+  for (int i = 0; i < nLoops && nTiles > 0; i++) {
+    quality_accesses (loops->at(i), tiles, &stats->loops[i]);
+  }
+
+  // 3) the work within each color
+  long nIterations = 0;
+  for (int t = 0; t < nTiles; t++) {
+    tile_t* tile = tiles->at(t);
+    long work = 0;
+    for (int i = 0; i < nLoops; i++) {
+      work += MAX(tile_loop_size (tile, i), 0);
+    }
+    if ((size_t)tile->color >= stats->colors.size()) {
+      color_stats_t empty = {0, 0, 0, 0.0};
+      stats->colors.resize (tile->color + 1, empty);
+    }
+    color_stats_t& color = stats->colors[tile->color];
+    color.nTiles++;
+    color.nIterations += work;
+    color.maxIterations = MAX(color.maxIterations, work);
+    nIterations += work;
+  }
+  for (size_t c = 0; c < stats->colors.size(); c++) {
+    color_stats_t& color = stats->colors[c];
+    color.imbalance = color.nIterations ?
+                      (double)color.maxIterations * color.nTiles / color.nIterations : 1.0;
+    stats->criticalPath += MAX(color.maxIterations,
+                               (color.nIterations + nThreads - 1) / nThreads);
+  }
+  stats->efficiency = stats->criticalPath ?
+                      (double)nIterations / ((long)nThreads * stats->criticalPath) : 1.0;
+}
+
+void stats_json (insp_stats_t* stats, ostream& out)
+{
+  ASSERT(stats != NULL, "Invalid NULL pointer to statistics");
+
+  out << "{" << endl
+      << "  \"total_time\": " << stats->totalTime << "," << endl
+      << "  \"phases\": {";
+  for (int p = 0; p < N_PHASES; p++) {
+    out << (p ? ", " : "") << "\"" << phaseNames[p] << "\": " << stats->times[p];
+  }
+  out << "}," << endl;
+
+  // only the phases tracked per loop are written out
+  stats_phase loopPhases[] = {PHASE_TILING, PHASE_PROJECTION, PHASE_ASSIGNMENT,
+                              PHASE_LOCAL_MAPS};
+  int nLoopPhases = sizeof(loopPhases) / sizeof(stats_phase);
+  int nLoops = stats->loops.size();
+  out << "  \"loops\": [";
+  for (int i = 0; i < nLoops; i++) {
+    loop_stats_t& loopStats = stats->loops[i];
+    out << (i ? "," : "") << endl << "    {\"name\": ";
+    json_string (out, loopStats.name);
+    for (int p = 0; p < nLoopPhases; p++) {
+      out << ", \"" << phaseNames[loopPhases[p]] << "\": " << loopStats.times[loopPhases[p]];
+    }
+    out << "," << endl
+        << "     \"tile_size\": {\"min\": " << loopStats.minSize << ", \"mean\": "
+        << loopStats.meanSize << ", \"max\": " << loopStats.maxSize << ", \"stddev\": "
+        << loopStats.stddevSize << "}, \"growth\": " << loopStats.growth
+        << ", \"max_growth\": " << loopStats.maxGrowth << "," << endl
+        << "     \"accesses\": [";
+    int nAccesses = loopStats.accesses.size();
+    for (int a = 0; a < nAccesses; a++) {
+      access_stats_t& access = loopStats.accesses[a];
+      index_t minTouched = 0, maxTouched = 0;
+      double sumTouched = 0.0;
+      int nTiles = access.touched.size();
+      for (int t = 0; t < nTiles; t++) {
+        minTouched = t ? MIN(minTouched, access.touched[t]) : access.touched[t];
+        maxTouched = MAX(maxTouched, access.touched[t]);
+        sumTouched += access.touched[t];
+      }
+      out << (a ? "," : "") << endl << "       {\"map\": ";
+      json_string (out, access.map);
+      out << ", \"set\": ";
+      json_string (out, access.set);
+      out << ", \"touched\": {\"min\": " << minTouched << ", \"mean\": "
+          << (nTiles ? sumTouched / nTiles : 0.0) << ", \"max\": " << maxTouched
+          << "}, \"boundary\": " << access.boundary << ", \"redundancy\": "
+          << access.redundancy << "}";
+    }
+    out << (nAccesses ? "\n     " : "") << "]}";
+  }
+  out << (nLoops ? "\n  " : "") << "]," << endl;
+
+  int nSweeps = stats->sweeps.size();
+  out << "  \"sweeps\": [";
+  for (int s = 0; s < nSweeps; s++) {
+    sweep_stats_t& sweep = stats->sweeps[s];
+    out << (s ? "," : "") << endl
+        << "    {\"time\": " << sweep.time << ", \"colors\": " << sweep.nColors
+        << ", \"tiles\": " << sweep.nTiles << ", \"conflicts\": " << sweep.nConflicts
+        << ", \"repairs\": " << sweep.nRepairs << ", \"retiled\": " << sweep.nRetiled
+        << ", \"repair_time\": " << sweep.repairTime << "}";
+  }
+  out << (nSweeps ? "\n  " : "") << "]," << endl;
+
+  out << "  \"memory\": {";
+  for (int k = 0; k < N_MEMORY; k++) {
+    memory_stats_t& memory = stats->memory[k];
+    out << (k ? "," : "") << endl
+        << "    \"" << dataNames[k] << "\": {\"allocated\": " << memory.allocated
+        << ", \"resident\": " << memory.resident << ", \"peak\": " << memory.peak << "}";
+  }
+  out << endl << "  }," << endl;
+
+  int nColors = stats->colors.size();
+  out << "  \"colors\": [";
+  for (int c = 0; c < nColors; c++) {
+    color_stats_t& color = stats->colors[c];
+    out << (c ? "," : "") << endl
+        << "    {\"tiles\": " << color.nTiles << ", \"iterations\": " << color.nIterations
+        << ", \"max_iterations\": " << color.maxIterations << ", \"imbalance\": "
+        << color.imbalance << "}";
+  }
+  out << (nColors ? "\n  " : "") << "]," << endl
+      << "  \"critical_path\": " << stats->criticalPath << "," << endl
+      << "  \"efficiency\": " << stats->efficiency << endl
+      << "}" << endl;
+}
+
+void stats_free (insp_stats_t* stats)
+{
+  delete stats;
+}
+
+
+/***** Static / utility functions *****/
+
+/*
+ * Measure the data touched by the tiles of /loop/, directly and through each of
+ * the maps it accesses: the elements touched by a tile are read from its local
+ * maps, and the tiles touching each element are counted
+ */
+static void quality_accesses (loop_t* loop, tile_list* tiles, loop_stats_t* loopStats)
+{
+  // aliases
+  int nTiles = tiles->size();
+  int loopIndex = loop->index;
+  local_maps_t* localMaps = tiles->at(0)->localMaps[loopIndex];
+
+  // the direct access, if any, is followed by one access per local map
+  std::vector<set_t*> sets;
+  std::vector<int> mapIndices;
+  for (int m = -1; m < localMaps->nMaps; m++) {
+    desc_list::const_iterator it, end;
+    for (it = loop->descriptors->begin(), end = loop->descriptors->end(); it != end; it++) {
+      map_t* map = (*it)->map;
+      if ((m == -1 && map == DIRECT) ||
+          (m != -1 && map != DIRECT && map->name == localMaps->names[m])) {
+        sets.push_back ((m == -1) ? loop->set : map->outSet);
+        mapIndices.push_back (m);
+        break;
+      }
+    }
+  }
+
+  int nAccesses = sets.size();
+  loopStats->accesses.resize (nAccesses);
+  for (int a = 0; a < nAccesses; a++) {
+    access_stats_t& access = loopStats->accesses[a];
+    int m = mapIndices[a];
+    index_t setSize = sets[a]->size;
+    access.map = (m == -1) ? "" : localMaps->names[m];
+    access.set = sets[a]->name;
+    access.touched.assign (nTiles, 0);
+
+    // the number of tiles touching each element
+    int* nTouching = new int[setSize]();
+    #pragma omp parallel
+    {
+      std::vector<index_t> elements;
+      #pragma omp for schedule(dynamic)
+      for (int t = 0; t < nTiles; t++) {
+        if (m == -1) {
+          iterations_list& iterations = *(tiles->at(t)->iterations[loopIndex]);
+          elements.assign (iterations.begin(), iterations.end());
+        }
+        else {
+          index_t* values = localMaps->values[m];
+          elements.assign (values + local_map_start (localMaps, m, t),
+                           values + local_map_start (localMaps, m, t + 1));
+        }
+        std::sort (elements.begin(), elements.end());
+        elements.erase (std::unique (elements.begin(), elements.end()), elements.end());
+        // off-processor elements, if any, come first
+        if (! elements.empty() && elements[0] == -1) {
+          elements.erase (elements.begin());
+        }
+        access.touched[t] = elements.size();
+        for (size_t k = 0; k < elements.size(); k++) {
+          #pragma omp atomic update
+          nTouching[elements[k]]++;
+        }
+      }
+    }
+
+    index_t nElements = 0, boundary = 0;
+    long sumTouching = 0;
+    #pragma omp parallel for schedule(static) reduction(+:nElements,boundary,sumTouching)
+    for (index_t e = 0; e < setSize; e++) {
+      nElements += (nTouching[e] > 0);
+      boundary += (nTouching[e] > 1);
+      sumTouching += nTouching[e];
+    }
+    access.boundary = boundary;
+    access.redundancy = nElements ? (double)sumTouching / nElements : 0.0;
+    delete[] nTouching;
+  }
+}
+
+static void json_string (ostream& out, string value)
+{
+  out << "\"";
+  for (size_t i = 0; i < value.size(); i++) {
+    char c = value[i];
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    }
+    else if ((unsigned char)c < 0x20) {
+      out << ' ';
+    }
+    else {
+      out << c;
+    }
+  }
+  out << "\"";
+}
@@ -5,29 +5,118 @@
 
 #include <algorithm>
 
+#include <stdlib.h>
+
 #include "tile.h"
 #include "utils.h"
 
-tile_t* tile_init (int crossedLoops, tile_region region, int prefetchHalo)
+tile_t* tile_init (int ID, int crossedLoops, tile_region region, int prefetchHalo)
 {
   tile_t* tile = new tile_t;
+  tile->ID = ID;
   tile->iterations = new iterations_list*[crossedLoops];
   for (int i = 0; i < crossedLoops; i++) {
     tile->iterations[i] = new iterations_list;
   }
-  tile->localMaps = new mapname_iterations*[crossedLoops];
+  tile->localMaps = new local_maps_t*[crossedLoops]();
   tile->crossedLoops = crossedLoops;
   tile->region = region;
   tile->color = -1;
   tile->prefetchHalo = prefetchHalo;
+  tile->footprint = 0;
   return tile;
 }
 
-iterations_list& tile_get_local_map (tile_t* tile, int loopIndex, std::string mapName)
+local_maps_t* local_maps_init (int nTiles, std::vector<std::string>& names,
+                               std::vector<int>& arities, index_t* offsets,
+                               std::vector<index_t*>* mapOffsets)
+{
+  ASSERT(names.size() == arities.size(), "Each local map needs an arity");
+  ASSERT(! mapOffsets || names.size() == mapOffsets->size(), "Invalid local map offsets");
+
+  local_maps_t* localMaps = new local_maps_t;
+  int nMaps = names.size();
+  localMaps->nTiles = nTiles;
+  localMaps->nRefs = nTiles;
+  localMaps->nMaps = nMaps;
+  localMaps->names = new std::string[nMaps];
+  localMaps->arities = new int[nMaps];
+  localMaps->offsets = offsets;
+  localMaps->values = new index_t*[nMaps];
+  localMaps->mapOffsets = new index_t*[nMaps];
+  for (int m = 0; m < nMaps; m++) {
+    localMaps->names[m] = names[m];
+    localMaps->arities[m] = arities[m];
+    localMaps->mapOffsets[m] = mapOffsets ? mapOffsets->at(m) : NULL;
+    ASSERT(arities[m] > 0 || localMaps->mapOffsets[m], "Irregular local map without offsets");
+    // aligned to a cache line, so that each local map can be read with aligned
+    // vector loads
+    size_t size = sizeof(index_t)*std::max(local_map_start (localMaps, m, nTiles), (index_t)1);
+    void* values = NULL;
+    int error = posix_memalign (&values, 64, size);
+    ASSERT(! error, "Could not allocate a local map");
+    localMaps->values[m] = (index_t*)values;
+  }
+  return localMaps;
+}
+
+void local_maps_free (local_maps_t* localMaps)
+{
+  for (int m = 0; m < localMaps->nMaps; m++) {
+    free (localMaps->values[m]);
+    delete[] localMaps->mapOffsets[m];
+  }
+  delete[] localMaps->values;
+  delete[] localMaps->mapOffsets;
+  delete[] localMaps->names;
+  delete[] localMaps->arities;
+  delete[] localMaps->offsets;
+  delete localMaps;
+}
+
+long local_maps_bytes (local_maps_t* localMaps)
+{
+  // aliases
+  int nTiles = localMaps->nTiles;
+  int nMaps = localMaps->nMaps;
+
+  long bytes = sizeof(local_maps_t) + sizeof(index_t)*(nTiles + 1) +
+               (sizeof(std::string) + sizeof(int) + 2*sizeof(index_t*))*nMaps;
+  for (int m = 0; m < nMaps; m++) {
+    bytes += sizeof(index_t)*local_map_start (localMaps, m, nTiles);
+    if (localMaps->mapOffsets[m]) {
+      bytes += sizeof(index_t)*(localMaps->offsets[nTiles] + 1);
+    }
+  }
+  return bytes;
+}
+
+index_t* tile_get_local_map (tile_t* tile, int loopIndex, std::string mapName)
 {
   ASSERT((loopIndex >= 0) && (loopIndex < tile->crossedLoops),
          "Invalid loop index while retrieving a local map");
-  return *(tile->localMaps[loopIndex]->find(mapName)->second);
+
+  local_maps_t* localMaps = tile->localMaps[loopIndex];
+  for (int m = 0; m < localMaps->nMaps; m++) {
+    if (localMaps->names[m] == mapName) {
+      return localMaps->values[m] + local_map_start (localMaps, m, tile->ID);
+    }
+  }
+  return NULL;
+}
+
+index_t* tile_get_local_offsets (tile_t* tile, int loopIndex, std::string mapName)
+{
+  ASSERT((loopIndex >= 0) && (loopIndex < tile->crossedLoops),
+         "Invalid loop index while retrieving local offsets");
+
+  local_maps_t* localMaps = tile->localMaps[loopIndex];
+  for (int m = 0; m < localMaps->nMaps; m++) {
+    if (localMaps->names[m] == mapName && localMaps->mapOffsets[m]) {
+      return localMaps->mapOffsets[m] + localMaps->offsets[tile->ID];
+    }
+  }
+  return NULL;
 }
 
 iterations_list& tile_get_iterations (tile_t* tile, int loopIndex)
@@ -40,18 +129,107 @@ int tile_loop_size (tile_t* tile, int loopIndex)
   return tile->iterations[loopIndex]->size() - tile->prefetchHalo;
 }
 
+void tile_footprints (tile_list* tiles, loop_list* loops)
+{
+  // aliases
+  int nTiles = tiles->size();
+  int nLoops = loops->size();
+
+  // each distinct pair (target set, bytes) is a piece of data, to which the
+  // descriptors accessing it point
+  std::map<std::pair<std::string, int>, int> dataIDs;
+  std::vector<int> dataBytes;
+  std::vector<std::vector<std::pair<descriptor_t*, int> > > loopData (nLoops);
+  for (int i = 0; i < nLoops; i++) {
+    loop_t* loop = loops->at(i);
+    desc_list::const_iterator it, end;
+    for (it = loop->descriptors->begin(), end = loop->descriptors->end(); it != end; it++) {
+      if ((*it)->bytes <= 0) {
+        continue;
+      }
+      set_t* target = ((*it)->map == DIRECT) ? loop->set : (*it)->map->outSet;
+      std::pair<std::string, int> data (target->name, (*it)->bytes);
+      if (dataIDs.find(data) == dataIDs.end()) {
+        dataIDs[data] = dataBytes.size();
+        dataBytes.push_back ((*it)->bytes);
+      }
+      loopData[i].push_back (std::make_pair (*it, dataIDs[data]));
+    }
+  }
+  int nData = dataBytes.size();
+  if (nData == 0) {
+    return;
+  }
+
+  #pragma omp parallel
+  {
+    // the elements of each piece of data touched by a tile; each element is
+    // counted once, however many times it is accessed
+    std::vector<std::vector<index_t> > touched (nData);
+
+    #pragma omp for schedule(dynamic)
+    for (int t = 0; t < nTiles; t++) {
+      tile_t* tile = tiles->at(t);
+      for (int i = 0; i < nLoops; i++) {
+        iterations_list& iterations = *(tile->iterations[i]);
+        for (size_t k = 0; k < loopData[i].size(); k++) {
+          map_t* map = loopData[i][k].first->map;
+          std::vector<index_t>& dataTouched = touched[loopData[i][k].second];
+          for (size_t j = 0; j < iterations.size(); j++) {
+            index_t offset = iterations[j];
+            int size = 1;
+            index_t* values = NULL;
+            if (map != DIRECT) {
+              map_ofs (map, iterations[j], &offset, &size);
+              values = map->values;
+            }
+            for (index_t e = offset; e < offset + size; e++) {
+              index_t element = values ? values[e] : e;
+              if (element != -1) {
+                dataTouched.push_back (element);
+              }
+            }
+          }
+        }
+      }
+      long footprint = 0;
+      for (int d = 0; d < nData; d++) {
+        std::vector<index_t>& dataTouched = touched[d];
+        std::sort (dataTouched.begin(), dataTouched.end());
+        long nTouched = std::unique (dataTouched.begin(), dataTouched.end()) -
+                        dataTouched.begin();
+        footprint += nTouched*dataBytes[d];
+        dataTouched.clear();
+      }
+      tile->footprint = footprint;
+    }
+  }
+}
+
+long tile_bytes (tile_t* tile, int loopIndex)
+{
+  if (loopIndex != -1) {
+    return sizeof(iterations_list) + sizeof(index_t)*tile->iterations[loopIndex]->capacity();
+  }
+  long bytes = sizeof(tile_t) +
+               (sizeof(iterations_list*) + sizeof(local_maps_t*))*tile->crossedLoops;
+  for (int i = 0; i < tile->crossedLoops; i++) {
+    bytes += tile_bytes (tile, i);
+  }
+  return bytes;
+}
+
 void tile_free (tile_t* tile)
 {
   for (int i = 0; i < tile->crossedLoops; i++) {
     // delete loop's iterations belonging to tile
     delete tile->iterations[i];
-    // delete loop's local maps
-    mapname_iterations* localMap = tile->localMaps[i];
-    mapname_iterations::iterator it, end;
-    for (it = localMap->begin(), end = localMap->end(); it != end; it++) {
-      delete it->second;
+    // local maps are shared by all tiles, so the last tile referring to them
+    // deletes them
+    local_maps_t* localMaps = tile->localMaps[i];
+    if (localMaps && --localMaps->nRefs == 0) {
+      local_maps_free (localMaps);
     }
-    delete localMap;
   }
   delete[] tile->iterations;
   delete[] tile->localMaps;
@@ -9,27 +9,59 @@
 #include <string.h>
 #include <limits.h>
 
+#ifdef SLOPE_OMP
+#include <omp.h>
+#endif
+
 #include "tiling.h"
 
 
 inline static void derive_dependency_free_tiling (loop_t* curLoop,
                                                   projection_t* prevLoopProj,
                                                   schedule_t* loopIter2tc);
-inline static void update_tiles_tracker (tracker_t& iterTilesPerColor,
-                                         index_set iterColors,
-                                         tracker_t& conflictsTracker);
+inline static void update_tiles_tracker (std::vector<uint64_t>& iterTilesPerColor,
+                                         std::vector<uint64_t>& localConflicts);
+static void track_ties (loop_t* curLoop, projection_t* prevLoopProj,
+                        schedule_t* loopIter2tc, tracker_t* conflictsTracker);
+inline static void sort_unique (std::vector<uint64_t>& values);
+inline static uint64_t pack (int high, int low);
+inline static void bucket_iterations (tc_t* iter2tc, index_t nIters, int nTiles,
+                                      index_t* offsets, index_t* tile2iter);
+static void tile_indirect (tc_t* loopValues, tc_t* projValues, index_t* indMap,
+                           index_t* offsets, index_t nIters, int arity,
+                           direction_t direction);
+inline static void tile_indirect_kernel (tc_t* loopValues, tc_t* projValues, index_t* indMap,
+                                         index_t* offsets, index_t nIters, int arity,
+                                         direction_t direction);
+
+// the elements whose tile or color changed while retiling, for each schedule
+typedef std::unordered_map<schedule_t*, std::vector<index_t> > dirty_map;
+
+static long retile_loop (loop_t* curLoop, projection_t* prevLoopProj,
+                         schedule_t* loopIter2tc, dirty_map& dirty,
+                         tracker_t* conflictsTracker, inverse_maps* inverseMaps,
+                         direction_t direction, bool* tilesChanged);
+static void reproject (loop_t* tiledLoop, schedule_t* tilingInfo,
+                       projection_t* prevLoopProj, projection_t* seedLoopProj,
+                       trace_t::iterator& entry, dirty_map& dirty,
+                       tracker_t* conflictsTracker, inverse_maps* inverseMaps,
+                       bool ignoreWAR, direction_t direction);
+inline static bool overrides (int color, int candidate, direction_t direction);
+inline static void sort_unique (std::vector<index_t>& values, index_t setSize);
+inline static void keep_changed (std::vector<index_t>& candidates, std::vector<char>& changed);
 
 void project_forward (loop_t* tiledLoop,
                       schedule_t* tilingInfo,
                       projection_t* prevLoopProj,
                       projection_t* seedLoopProj,
                       tracker_t* conflictsTracker,
-                      bool ignoreWAR)
+                      inverse_maps* inverseMaps,
+                      bool ignoreWAR,
+                      trace_t* trace)
 {
   // aliases
   desc_list* descriptors = tiledLoop->descriptors;
-  int* iter2tile = tilingInfo->iter2tile;
-  int* iter2color = tilingInfo->iter2color;
+  tc_t* iter2tc = tilingInfo->iter2tc;
 
   bool directHandled = false;
   desc_list::const_iterator it, end;
@@ -64,61 +96,52 @@ void project_forward (loop_t* tiledLoop,
       // - checking conflicts requires to store only O(k) instead of O(kN) memory,
       //   with k the average arity of a projected set iteration and N the size of
       //   the projected iteration set
-      descMap = map_invert (descMap, NULL);
+      // the inverse map is computed once and then reused by later loops and sweeps
+      descMap = map_invert_cached (descMap, inverseMaps);
 
       // aliases
-      int projSetSize = descMap->inSet->size;
+      index_t projSetSize = descMap->inSet->size;
       std::string projSetName = descMap->inSet->name;
-      int* indMap = descMap->values;
-      int* offsets = descMap->offsets;
+      index_t* indMap = descMap->values;
+      index_t* offsets = descMap->offsets;
 
-      int* projIter2tile = new int[projSetSize];
-      int* projIter2color = new int[projSetSize];
-      projIter2tc = schedule_init (projSetName, projSetSize, projIter2tile,
-                                   projIter2color, DOWN);
+      tc_t* projValues = new tc_t[projSetSize];
+      projIter2tc = schedule_init (projSetName, projSetSize, projValues, DOWN);
 
       #pragma omp parallel
       {
-        tracker_t localTracker;
+        // conflicts detected by a thread
+        std::vector<uint64_t> localConflicts;
+        // temporary buffer for updating the tracker, reused by all iterations
+        std::vector<uint64_t> iterTilesPerColor;
         // iterate over the projected loop iteration set, and use the map to access
         // the tiledLoop iteration set's elements.
         #pragma omp for schedule(static)
-        for (int i = 0; i < projSetSize; i++) {
-          projIter2tile[i] = -1;
-          projIter2color[i] = -1;
+        for (index_t i = 0; i < projSetSize; i++) {
+          tc_t iterTc = tc_pack (-1, -1);
           // determine the projected set iteration arity, which may vary from
           // iteration to iteration
-          int prevOffset = offsets[i];
-          int nextOffset = offsets[i + 1];
-          // temporary variables for updating the tracker
-          tracker_t iterTilesPerColor;
-          index_set iterColors;
-          for (int j = prevOffset; j < nextOffset; j++) {
-            int indIter = indMap[j];
-            int indTile = iter2tile[indIter];
-            int indColor = iter2color[indIter];
+          index_t prevOffset = offsets[i];
+          index_t nextOffset = offsets[i + 1];
+          iterTilesPerColor.clear();
+          for (index_t j = prevOffset; j < nextOffset; j++) {
+            tc_t indTc = iter2tc[indMap[j]];
             // may have to change color and tile of the projected iteration
-            int maxColor = MAX(projIter2color[i], indColor);
-            if (maxColor != projIter2color[i]) {
-              projIter2tile[i] = indTile;
-              projIter2color[i] = maxColor;
-            }
-            // track adjacent tiles, stored by colors
-            iterTilesPerColor[indColor].insert (indTile);
-            iterColors.insert (indColor);
+            iterTc = (tc_color(indTc) > tc_color(iterTc)) ? indTc : iterTc;
+            // track adjacent tiles, stored by colors; a packed word is already
+            // a (color, tile) pair
+            iterTilesPerColor.push_back (pack(tc_color(indTc), tc_tile(indTc)));
           }
-          update_tiles_tracker (iterTilesPerColor, iterColors, localTracker);
+          projValues[i] = iterTc;
+          update_tiles_tracker (iterTilesPerColor, localConflicts);
         }
 
         // need to copy back the conflicts detected by a thread into the global structure
+        sort_unique (localConflicts);
         #pragma omp critical
         {
-          tracker_t::const_iterator it, end;
-          for (it = localTracker.begin(), end = localTracker.end(); it != end; it++) {
-            int tileID = it->first;
-            index_set localAdjTiles = it->second;
-            (*conflictsTracker)[tileID].insert (localAdjTiles.begin(), localAdjTiles.end());
-          }
+          std::vector<uint64_t>& edges = conflictsTracker->edges;
+          edges.insert (edges.end(), localConflicts.begin(), localConflicts.end());
         }
       }
 
@@ -127,10 +150,9 @@ void project_forward (loop_t* tiledLoop,
       projection_t::iterator oldProjIter2tc = prevLoopProj->find (projIter2tc);
       if (oldProjIter2tc != prevLoopProj->end()) {
         #pragma omp for schedule(static)
-        for (int i = 0; i < projSetSize; i++) {
-          if (projIter2tile[i] == -1) {
-            projIter2tile[i] = (*oldProjIter2tc)->iter2tile[i];
-            projIter2color[i] = (*oldProjIter2tc)->iter2color[i];
+        for (index_t i = 0; i < projSetSize; i++) {
+          if (tc_tile(projValues[i]) == -1) {
+            projValues[i] = (*oldProjIter2tc)->iter2tc[i];
           }
         }
       }
@@ -141,7 +163,9 @@ void project_forward (loop_t* tiledLoop,
                 "Need old projection for subsets");
       }
 
-      map_free (descMap, true);
+      if (trace) {
+        trace->push_back (schedule_cpy (projIter2tc));
+      }
     }
 
     // update projections:
@@ -149,17 +173,21 @@ void project_forward (loop_t* tiledLoop,
     //   yet. This is because seedLoopProj will be used for backward tiling, in which
     //   the sets projections closest (in time) to the seed parloop need to be seen
     // - prevLoopProj is updated everytime a new projection is available; for this,
-    //   any previous projections for a same set are deleted and memory is freed
+    //   any previous projections for a same set are deleted and memory is freed,
+    //   unless they are shared with seedLoopProj
     // Note: if the projection still has to be added to seedLoopProj, then for sure it
     //       is not in prevLoopProj either. On the other hand, if the projection is
     //       in seedLoopProj, then a projection on the same set is in prevLoopProj
-    if (seedLoopProj->find (projIter2tc) == seedLoopProj->end()) {
-      seedLoopProj->insert (schedule_cpy(projIter2tc));
+    projection_t::iterator seedProjIter2tc = seedLoopProj->find (projIter2tc);
+    if (seedProjIter2tc == seedLoopProj->end()) {
+      seedLoopProj->insert (projIter2tc);
     }
     else {
       projection_t::iterator toFree = prevLoopProj->find (projIter2tc);
       if (toFree != prevLoopProj->end()) {
-        schedule_free (*toFree);
+        if (*toFree != *seedProjIter2tc) {
+          schedule_free (*toFree);
+        }
         prevLoopProj->erase (toFree);
       }
     }
@@ -176,12 +204,13 @@ void project_backward (loop_t* tiledLoop,
                        schedule_t* tilingInfo,
                        projection_t* prevLoopProj,
                        tracker_t* conflictsTracker,
-                       bool ignoreWAR)
+                       inverse_maps* inverseMaps,
+                       bool ignoreWAR,
+                       trace_t* trace)
 {
   // aliases
   desc_list* descriptors = tiledLoop->descriptors;
-  int* iter2tile = tilingInfo->iter2tile;
-  int* iter2color = tilingInfo->iter2color;
+  tc_t* iter2tc = tilingInfo->iter2tc;
 
   bool directHandled = false;
   desc_list::const_iterator it, end;
@@ -216,73 +245,66 @@ void project_backward (loop_t* tiledLoop,
       // - checking conflicts requires to store only O(k) instead of O(kN) memory,
       //   with k the average arity of a projected set iteration and N the size of
       //   the projected iteration set
-      descMap = map_invert (descMap, NULL);
+      // the inverse map is computed once and then reused by later loops and sweeps
+      descMap = map_invert_cached (descMap, inverseMaps);
 
       // aliases
-      int projSetSize = descMap->inSet->size;
+      index_t projSetSize = descMap->inSet->size;
       std::string projSetName = descMap->inSet->name;
-      int* indMap = descMap->values;
-      int* offsets = descMap->offsets;
+      index_t* indMap = descMap->values;
+      index_t* offsets = descMap->offsets;
 
-      int* projIter2tile = new int[projSetSize];
-      int* projIter2color = new int[projSetSize];
-      projIter2tc = schedule_init (projSetName, projSetSize, projIter2tile,
-                                   projIter2color, UP);
+      tc_t* projValues = new tc_t[projSetSize];
+      projIter2tc = schedule_init (projSetName, projSetSize, projValues, UP);
 
       #pragma omp parallel
       {
-        tracker_t localTracker;
+        // conflicts detected by a thread
+        std::vector<uint64_t> localConflicts;
+        // temporary buffer for updating the tracker, reused by all iterations
+        std::vector<uint64_t> iterTilesPerColor;
         // iterate over the projected loop iteration set, and use the map to access
         // the tiledLoop iteration set's elements.
         #pragma omp for schedule(static)
-        for (int i = 0; i < projSetSize; i++) {
-          projIter2tile[i] = INT_MAX;
-          projIter2color[i] = INT_MAX;
+        for (index_t i = 0; i < projSetSize; i++) {
+          tc_t iterTc = tc_pack (TC_MAX, TC_MAX);
           // determine the projected set iteration arity, which may vary from
           // iteration to iteration
-          int prevOffset = offsets[i];
-          int nextOffset = offsets[i + 1];
-          // temporary variables for updating the tracker
-          tracker_t iterTilesPerColor;
-          index_set iterColors;
-          for (int j = prevOffset; j < nextOffset; j++) {
-            int indIter = indMap[j];
-            int indTile = iter2tile[indIter];
-            int indColor = iter2color[indIter];
+          index_t prevOffset = offsets[i];
+          index_t nextOffset = offsets[i + 1];
+          iterTilesPerColor.clear();
+          for (index_t j = prevOffset; j < nextOffset; j++) {
+            tc_t indTc = iter2tc[indMap[j]];
             // may have to change color and tile of the projected iteration
-            int minColor = MIN(projIter2color[i], indColor);
-            if (minColor != projIter2color[i]) {
-              projIter2tile[i] = indTile;
-              projIter2color[i] = minColor;
-            }
-            // track adjacent tiles, stored by colors
-            iterTilesPerColor[indColor].insert (indTile);
-            iterColors.insert (indColor);
+            iterTc = (tc_color(indTc) < tc_color(iterTc)) ? indTc : iterTc;
+            // track adjacent tiles, stored by colors; a packed word is already
+            // a (color, tile) pair
+            iterTilesPerColor.push_back (pack(tc_color(indTc), tc_tile(indTc)));
           }
-          update_tiles_tracker (iterTilesPerColor, iterColors, localTracker);
+          projValues[i] = iterTc;
+          update_tiles_tracker (iterTilesPerColor, localConflicts);
         }
 
         // need to copy back the conflicts detected by a thread into the global structure
+        sort_unique (localConflicts);
         #pragma omp critical
         {
-          tracker_t::const_iterator it, end;
-          for (it = localTracker.begin(), end = localTracker.end(); it != end; it++) {
-            int tileID = it->first;
-            index_set localAdjTiles = it->second;
-            (*conflictsTracker)[tileID].insert (localAdjTiles.begin(), localAdjTiles.end());
-          }
+          std::vector<uint64_t>& edges = conflictsTracker->edges;
+          edges.insert (edges.end(), localConflicts.begin(), localConflicts.end());
         }
       }
 
       // if projecting from a subset, an older projection must be present. This
-      // is used to replicate an untouched iteration color and tile.
+      // is used to replicate an untouched iteration color and tile. The older
+      // projection may also come from forward tiling the seed loop, in which
+      // untouched iterations are marked with -1: these stay untouched
       projection_t::iterator oldProjIter2tc = prevLoopProj->find (projIter2tc);
       if (oldProjIter2tc != prevLoopProj->end()) {
         #pragma omp for schedule(static)
-        for (int i = 0; i < projSetSize; i++) {
-          if (projIter2tile[i] == INT_MAX) {
-            projIter2tile[i] = (*oldProjIter2tc)->iter2tile[i];
-            projIter2color[i] = (*oldProjIter2tc)->iter2color[i];
+        for (index_t i = 0; i < projSetSize; i++) {
+          tc_t oldTc = (*oldProjIter2tc)->iter2tc[i];
+          if (tc_tile(projValues[i]) == TC_MAX && tc_tile(oldTc) != -1) {
+            projValues[i] = oldTc;
           }
         }
       }
@@ -293,7 +315,9 @@ void project_backward (loop_t* tiledLoop,
                 "Need old projection for subsets");
       }
 
-      map_free (descMap, true);
+      if (trace) {
+        trace->push_back (schedule_cpy (projIter2tc));
+      }
     }
 
     // update projections:
@@ -314,11 +338,12 @@ void project_backward (loop_t* tiledLoop,
 }
 
 schedule_t* tile_forward (loop_t* curLoop,
-                          projection_t* prevLoopProj)
+                          projection_t* prevLoopProj,
+                          tracker_t* conflictsTracker)
 {
   // aliases
   set_t* toTile = curLoop->set;
-  int toTileSetSize = toTile->size;
+  index_t toTileSetSize = toTile->size;
   std::string toTileSetName = toTile->name;
   desc_list* descriptors = curLoop->descriptors;
   schedule_t *loopIter2tc;
@@ -328,12 +353,9 @@ schedule_t* tile_forward (loop_t* curLoop,
   std::set<set_t*, bool(*)(const set_t* a, const set_t* b)> checkedSets (&set_cmp);
 
   // allocate and initialize space to keep tiling and coloring results
-  int* loopIter2tile = new int[toTileSetSize];
-  int* loopIter2color = new int[toTileSetSize];
-  std::fill_n (loopIter2tile, toTileSetSize, -1);
-  std::fill_n (loopIter2color, toTileSetSize, -1);
-  loopIter2tc = schedule_init (toTileSetName, toTileSetSize, loopIter2tile,
-                               loopIter2color, DOWN);
+  tc_t* loopValues = new tc_t[toTileSetSize];
+  std::fill_n (loopValues, toTileSetSize, tc_pack (-1, -1));
+  loopIter2tc = schedule_init (toTileSetName, toTileSetSize, loopValues, DOWN);
 
   if (toTileSetSize == 0) {
     // no need to tile
@@ -363,54 +385,31 @@ schedule_t* tile_forward (loop_t* curLoop,
     if (iprojIter2tc == prevLoopProj->end()) {
       continue;
     }
-    int* projIter2tile = (*iprojIter2tc)->iter2tile;
-    int* projIter2color = (*iprojIter2tc)->iter2color;
+    tc_t* projValues = (*iprojIter2tc)->iter2tc;
 
     if (touchedSet == toTile) {
       // direct set case
       #pragma omp parallel for schedule(static)
-      for (int i = 0; i < toTileSetSize; i++) {
-        int iterTile = projIter2tile[i];
-        int iterColor = MAX(projIter2color[i], loopIter2color[i]);
-        if (iterColor != loopIter2color[i]) {
-          loopIter2tile[i] = iterTile;
-          loopIter2color[i] = iterColor;
-        }
+      for (index_t i = 0; i < toTileSetSize; i++) {
+        tc_t projTc = projValues[i];
+        loopValues[i] = (tc_color(projTc) > tc_color(loopValues[i])) ? projTc : loopValues[i];
       }
     }
     else {
       // indirect set case
       // aliases
-      int touchedSetSize = touchedSet->size;
-      int mapSize = descMap->size;
-      int* indMap = descMap->values;
+      index_t touchedSetSize = touchedSet->size;
+      index_t* indMap = descMap->values;
+      index_t* offsets = descMap->offsets;
 
-      int arity = mapSize / toTileSetSize;
+      // an irregular map has no arity: the elements touched by an iteration are
+      // given by /offsets/
+      int arity = offsets ? 0 : descMap->size / toTileSetSize;
 
       // iterate over the iteration set of the loop we are tiling, and use the map
       // to access the indirectly touched elements
-      #pragma omp parallel for schedule(static)
-      for (int i = 0; i < toTileSetSize; i++) {
-        int iterTile = loopIter2tile[i];
-        int iterColor = loopIter2color[i];
-        for (int j = 0; j < arity; j++) {
-          int indIter = indMap[i*arity + j];
-          if (indIter == -1) {
-            // off-processor elements are set to -1; ignore them
-            continue;
-          }
-          int indTile = projIter2tile[indIter];
-          int indColor = MAX(iterColor, projIter2color[indIter]);
-          if (iterColor != indColor) {
-            // update color and tile of the loop being tiled
-            iterTile = indTile;
-            iterColor = indColor;
-          }
-        }
-        // now all adjacent iterations have been examined, so assign the MAX
-        // color found and the corresponding tile
-        loopIter2tile[i] = iterTile;
-        loopIter2color[i] = iterColor;
+      if (touchedSetSize > 0) {
+        tile_indirect (loopValues, projValues, indMap, offsets, toTileSetSize, arity, DOWN);
       }
     }
 
@@ -427,25 +426,28 @@ schedule_t* tile_forward (loop_t* curLoop,
     derive_dependency_free_tiling (curLoop, prevLoopProj, loopIter2tc);
     loopIter2tc->computed = true;
   }
+  else {
+    track_ties (curLoop, prevLoopProj, loopIter2tc, conflictsTracker);
+  }
 
 #ifdef SLOPE_VTK
   // track coloring and tiling of a parloop. These can be used for debugging or
   // visualization purpose, e.g. for generating VTK files.
   curLoop->tiling = new int[toTileSetSize];
   curLoop->coloring = new int[toTileSetSize];
-  memcpy (curLoop->tiling, loopIter2tc->iter2tile, sizeof(int)*toTileSetSize);
-  memcpy (curLoop->coloring, loopIter2tc->iter2color, sizeof(int)*toTileSetSize);
+  schedule_unpack (loopIter2tc, curLoop->tiling, curLoop->coloring);
 #endif
 
   return loopIter2tc;
 }
 
 schedule_t* tile_backward (loop_t* curLoop,
-                           projection_t* prevLoopProj)
+                           projection_t* prevLoopProj,
+                           tracker_t* conflictsTracker)
 {
   // aliases
   set_t* toTile = curLoop->set;
-  int toTileSetSize = toTile->size;
+  index_t toTileSetSize = toTile->size;
   std::string toTileSetName = toTile->name;
   desc_list* descriptors = curLoop->descriptors;
   schedule_t *loopIter2tc;
@@ -455,12 +457,9 @@ schedule_t* tile_backward (loop_t* curLoop,
   std::set<set_t*, bool(*)(const set_t* a, const set_t* b)> checkedSets (&set_cmp);
 
   // allocate and initialize space to keep tiling and coloring results
-  int* loopIter2tile = new int[toTileSetSize];
-  int* loopIter2color = new int[toTileSetSize];
-  std::fill_n (loopIter2tile, toTileSetSize, INT_MAX);
-  std::fill_n (loopIter2color, toTileSetSize, INT_MAX);
-  loopIter2tc = schedule_init (toTileSetName, toTileSetSize, loopIter2tile,
-                               loopIter2color, UP);
+  tc_t* loopValues = new tc_t[toTileSetSize];
+  std::fill_n (loopValues, toTileSetSize, tc_pack (TC_MAX, TC_MAX));
+  loopIter2tc = schedule_init (toTileSetName, toTileSetSize, loopValues, UP);
 
   if (toTileSetSize == 0) {
     // no need to tile
@@ -490,54 +489,31 @@ schedule_t* tile_backward (loop_t* curLoop,
     if (iprojIter2tc == prevLoopProj->end()) {
       continue;
     }
-    int* projIter2tile = (*iprojIter2tc)->iter2tile;
-    int* projIter2color = (*iprojIter2tc)->iter2color;
+    tc_t* projValues = (*iprojIter2tc)->iter2tc;
 
     if (touchedSet == toTile) {
       // direct set case
       #pragma omp parallel for schedule(static)
-      for (int i = 0; i < toTileSetSize; i++) {
-        int iterTile = projIter2tile[i];
-        int iterColor = MIN(projIter2color[i], loopIter2color[i]);
-        if (iterColor != loopIter2color[i]) {
-          loopIter2tile[i] = iterTile;
-          loopIter2color[i] = iterColor;
-        }
+      for (index_t i = 0; i < toTileSetSize; i++) {
+        tc_t projTc = projValues[i];
+        loopValues[i] = (tc_color(projTc) < tc_color(loopValues[i])) ? projTc : loopValues[i];
       }
     }
     else {
       // indirect set case
       // aliases
-      int touchedSetSize = touchedSet->size;
-      int mapSize = descMap->size;
-      int* indMap = descMap->values;
+      index_t touchedSetSize = touchedSet->size;
+      index_t* indMap = descMap->values;
+      index_t* offsets = descMap->offsets;
 
-      int arity = mapSize / toTileSetSize;
+      // an irregular map has no arity: the elements touched by an iteration are
+      // given by /offsets/
+      int arity = offsets ? 0 : descMap->size / toTileSetSize;
 
       // iterate over the iteration set of the loop we are tiling, and use the map
       // to access the indirectly touched elements
-      #pragma omp parallel for schedule(static)
-      for (int i = 0; i < toTileSetSize; i++) {
-        int iterTile = loopIter2tile[i];
-        int iterColor = loopIter2color[i];
-        for (int j = 0; j < arity; j++) {
-          int indIter = indMap[i*arity + j];
-          if (indIter == -1) {
-            // off-processor elements are set to -1; ignore them
-            continue;
-          }
-          int indTile = projIter2tile[indIter];
-          int indColor = MIN(iterColor, projIter2color[indIter]);
-          if (iterColor != indColor) {
-            // update color and tile of the loop being tiled
-            iterTile = indTile;
-            iterColor = indColor;
-          }
-        }
-        // now all adjacent iterations have been examined, so assign the MIN
-        // color found and the corresponding tile
-        loopIter2tile[i] = iterTile;
-        loopIter2color[i] = iterColor;
+      if (touchedSetSize > 0) {
+        tile_indirect (loopValues, projValues, indMap, offsets, toTileSetSize, arity, UP);
       }
     }
 
@@ -554,91 +530,88 @@ schedule_t* tile_backward (loop_t* curLoop,
     derive_dependency_free_tiling (curLoop, prevLoopProj, loopIter2tc);
     loopIter2tc->computed = true;
   }
+  else {
+    track_ties (curLoop, prevLoopProj, loopIter2tc, conflictsTracker);
+  }
 
 #ifdef SLOPE_VTK
   // track coloring and tiling of a parloop. These can be used for debugging or
   // visualization purpose, e.g. for generating VTK files.
   curLoop->tiling = new int[toTileSetSize];
   curLoop->coloring = new int[toTileSetSize];
-  memcpy (curLoop->tiling, loopIter2tc->iter2tile, sizeof(int)*toTileSetSize);
-  memcpy (curLoop->coloring, loopIter2tc->iter2color, sizeof(int)*toTileSetSize);
+  schedule_unpack (loopIter2tc, curLoop->tiling, curLoop->coloring);
 #endif
 
   return loopIter2tc;
 }
 
 void assign_loop (loop_t* loop, loop_list* loops, tile_list* tiles,
-                  int* iter2tile, direction_t direction)
+                  tc_t* iter2tc, direction_t direction)
 {
   // aliases
   int loopIndex = loop->index;
   set_t* loopSet = loop->set;
-
-  // 1) remove any previously assigned iteration for loop /loopIndex/
-  tile_list::const_iterator tIt, tEnd;
-  for (tIt = tiles->begin(), tEnd = tiles->end(); tIt != tEnd; tIt++) {
-    (*tIt)->iterations[loopIndex]->clear();
-  }
-
-  // 2) distribute iterations to tiles (note: we do not assign non-exec iterations)
-  int execSize = loopSet->core + loopSet->execHalo;
-  for (int i = 0; i < execSize; i++) {
-    tiles->at(iter2tile[i])->iterations[loopIndex]->push_back(i);
+  int nLoops = loops->size();
+  int nTiles = tiles->size();
+
+  // 1) distribute iterations to tiles (note: we do not assign non-exec iterations);
+  // in /tile2iter/, the iterations of a tile appear in increasing order
+  index_t execSize = loopSet->core + loopSet->execHalo;
+  index_t* tileOffsets = new index_t[nTiles + 1];
+  index_t* tile2iter = new index_t[execSize];
+  bucket_iterations (iter2tc, execSize, nTiles, tileOffsets, tile2iter);
+
+  // 2) find the closest loop, in the direction opposite to the tiling direction,
+  // over the same iteration set; the order in which its iterations are executed
+  // is preserved in /loop/
+  int prevIndex = -1;
+  switch (direction) {
+    case SEED:
+      break;
+    case DOWN:
+      for (int i = loopIndex - 1; i >= 0 && prevIndex == -1; i--) {
+        prevIndex = loop_eq_itspace (loop, loops->at(i)) ? i : -1;
+      }
+      break;
+    case UP:
+      for (int i = loopIndex + 1; i < nLoops && prevIndex == -1; i++) {
+        prevIndex = loop_eq_itspace (loop, loops->at(i)) ? i : -1;
+      }
+      break;
   }
+  // each iteration belongs to a single tile, so threads never touch the same entry
+  bool* placed = (prevIndex != -1) ? new bool[execSize]() : NULL;
 
-  for (tIt = tiles->begin(), tEnd = tiles->end(); tIt != tEnd; tIt++) {
-    tile_t* tile = *tIt;
-    int nLoops = tile->crossedLoops;
+  #pragma omp parallel for schedule(dynamic)
+  for (int t = 0; t < nTiles; t++) {
+    tile_t* tile = tiles->at(t);
     iterations_list& iterations = *(tile->iterations[loopIndex]);
-    int tileLoopSize = iterations.size();
-    if (! tileLoopSize) {
+    index_t prevOffset = tileOffsets[t];
+    index_t nextOffset = tileOffsets[t + 1];
+    iterations.clear();
+    if (prevOffset == nextOffset) {
       continue;
     }
+    iterations.reserve (nextOffset - prevOffset + tile->prefetchHalo);
 
     // 3) create a sorted iteration list:
     // first put all iterations already in the tile, then all others
-    iterations_list sortedIters;
-    switch (direction) {
-      case SEED:
-        break;
-      case DOWN:
-        for (int i = loopIndex - 1; i >= 0; i--) {
-          if (loop_eq_itspace (loop, loops->at(i))) {
-            iterations_list& prevIters = *(tile->iterations[i]);
-            int tilePrevLoopSize = prevIters.size();
-            for (int e = 0; e < tilePrevLoopSize; e++) {
-              iterations_list::iterator isIn;
-              isIn = std::find (iterations.begin(), iterations.end(), prevIters[e]);
-              if (isIn != iterations.end()) {
-                sortedIters.push_back(*isIn);
-                iterations.erase(isIn);
-              }
-            }
-            break;
-          }
-        }
-        break;
-      case UP:
-        for (int i = loopIndex + 1; i < nLoops; i++) {
-          if (loop_eq_itspace (loop, loops->at(i))) {
-            iterations_list& prevIters = *(tile->iterations[i]);
-            int tilePrevLoopSize = prevIters.size();
-            for (int e = 0; e < tilePrevLoopSize; e++) {
-              iterations_list::iterator isIn;
-              isIn = std::find (iterations.begin(), iterations.end(), prevIters[e]);
-              if (isIn != iterations.end()) {
-                sortedIters.push_back(*isIn);
-                iterations.erase(isIn);
-              }
-            }
-            break;
-          }
+    if (prevIndex != -1) {
+      iterations_list& prevIters = *(tile->iterations[prevIndex]);
+      index_t tilePrevLoopSize = prevIters.size();
+      for (index_t e = 0; e < tilePrevLoopSize; e++) {
+        index_t iter = prevIters[e];
+        if (iter < execSize && tc_tile(iter2tc[iter]) == t && ! placed[iter]) {
+          placed[iter] = true;
+          iterations.push_back(iter);
         }
-        break;
+      }
+    }
+    for (index_t j = prevOffset; j < nextOffset; j++) {
+      if (! placed || ! placed[tile2iter[j]]) {
+        iterations.push_back(tile2iter[j]);
+      }
     }
-    std::sort (iterations.begin(), iterations.end());
-    sortedIters.insert (sortedIters.end(), iterations.begin(), iterations.end());
-    iterations.assign (sortedIters.begin(), sortedIters.end());
 
     // 4) add fake /d/ extra elements in case one wants to prefetch iterations
     // /i/, /i+1/, ..., /i+d/, before having executed iteration /i/
@@ -646,30 +619,613 @@ void assign_loop (loop_t* loop, loop_list* loops, tile_list* tiles,
       iterations.push_back(iterations.back());
     }
   }
+
+  delete[] placed;
+  delete[] tileOffsets;
+  delete[] tile2iter;
+}
+
+tracker_t* tracker_init (int nTiles)
+{
+  tracker_t* tracker = new tracker_t;
+  tracker->nTiles = nTiles;
+  tracker->offsets.assign (nTiles + 1, 0);
+  return tracker;
 }
 
+void tracker_compact (tracker_t* tracker)
+{
+  // aliases
+  int nTiles = tracker->nTiles;
+  std::vector<uint64_t>& edges = tracker->edges;
+  std::vector<int>& offsets = tracker->offsets;
+  std::vector<int>& adjncy = tracker->adjncy;
+
+  if (edges.empty()) {
+    return;
+  }
+
+  // the conflicts already in the CSR graph are merged with the new ones
+  for (int i = 0; i < nTiles; i++) {
+    for (int j = offsets[i]; j < offsets[i + 1]; j++) {
+      edges.push_back (pack(i, adjncy[j]));
+    }
+  }
+  sort_unique (edges);
+
+  // edges are sorted by tile, so the CSR graph can be built in a single pass
+  int nEdges = edges.size();
+  offsets.assign (nTiles + 1, 0);
+  adjncy.resize (nEdges);
+  for (int i = 0; i < nEdges; i++) {
+    int tile = edges[i] >> 32;
+    ASSERT((tile >= 0) && (tile < nTiles), "Invalid tile ID in a tracker");
+    offsets[tile + 1]++;
+    adjncy[i] = (int)(uint32_t)edges[i];
+  }
+  for (int i = 0; i < nTiles; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+
+  std::vector<uint64_t>().swap (edges);
+}
+
+void tracker_merge (tracker_t* tracker, tracker_t* source)
+{
+  ASSERT(tracker->nTiles == source->nTiles, "Merging trackers of different tilings");
+
+  std::vector<uint64_t>& edges = tracker->edges;
+  edges.insert (edges.end(), source->edges.begin(), source->edges.end());
+  for (int i = 0; i < source->nTiles; i++) {
+    for (int j = source->offsets[i]; j < source->offsets[i + 1]; j++) {
+      edges.push_back (pack(i, source->adjncy[j]));
+    }
+  }
+  tracker_compact (tracker);
+}
+
+void tracker_free (tracker_t* tracker)
+{
+  delete tracker;
+}
+
+long tracker_bytes (tracker_t* tracker)
+{
+  return sizeof(tracker_t) + sizeof(uint64_t)*tracker->edges.capacity() +
+         sizeof(int)*(tracker->offsets.capacity() + tracker->adjncy.capacity());
+}
+
+void trace_clear (trace_t* trace)
+{
+  for (size_t i = 0; i < trace->size(); i++) {
+    schedule_free (trace->at(i));
+  }
+  trace->clear();
+}
+
+long trace_bytes (trace_t* trace)
+{
+  long bytes = 0;
+  for (size_t i = 0; i < trace->size(); i++) {
+    bytes += schedule_bytes (trace->at(i));
+  }
+  return bytes;
+}
+
+long retile (loop_list* loops, int seed, tile_list* tiles, index_t* iter2color,
+             std::vector<index_t>& recolored, trace_t* trace,
+             tracker_t* conflictsTracker, inverse_maps* inverseMaps, bool ignoreWAR)
+{
+  // aliases
+  int nLoops = loops->size();
+  loop_t* seedLoop = loops->at(seed);
+
+  dirty_map dirty;
+  long nRetiled = recolored.size();
+
+  // the seed loop schedule comes first in the trace, and it is shared by forward
+  // and backward tiling; its tiling never changes
+  trace_t::iterator entry = trace->begin();
+  schedule_t* seedSchedule = *entry++;
+  std::vector<index_t>& seedDirty = dirty[seedSchedule];
+  seedDirty.assign (recolored.begin(), recolored.end());
+  sort_unique (seedDirty, seedLoop->set->size);
+  for (size_t k = 0; k < seedDirty.size(); k++) {
+    index_t i = seedDirty[k];
+    seedSchedule->iter2tc[i] = tc_pack (tc_tile(seedSchedule->iter2tc[i]), iter2color[i]);
+  }
+
+  // the projections point to the schedules in the trace, which they do not own.
+  // Once the tiling of a loop changes, the iterations of the loops tiled after
+  // it are distributed again too, since their order within a tile may change
+  projection_t* prevLoopProj = projection_init();
+  projection_t* seedLoopProj = projection_init();
+  bool tilesChanged, reassign = false;
+
+  // forward tiling
+  reproject (seedLoop, seedSchedule, prevLoopProj, seedLoopProj, entry, dirty,
+             conflictsTracker, inverseMaps, ignoreWAR, DOWN);
+  for (int i = seed + 1; i < nLoops; i++) {
+    loop_t* curLoop = loops->at(i);
+    schedule_t* tilingInfo = *entry++;
+    nRetiled += retile_loop (curLoop, prevLoopProj, tilingInfo, dirty, conflictsTracker,
+                             inverseMaps, DOWN, &tilesChanged);
+    reassign |= tilesChanged;
+    if (reassign) {
+      assign_loop (curLoop, loops, tiles, tilingInfo->iter2tc, DOWN);
+    }
+    reproject (curLoop, tilingInfo, prevLoopProj, seedLoopProj, entry, dirty,
+               conflictsTracker, inverseMaps, ignoreWAR, DOWN);
+  }
+
+  // backward tiling, starting from the projections closest to the seed loop
+  delete prevLoopProj;
+  prevLoopProj = seedLoopProj;
+  reassign = false;
+  reproject (seedLoop, seedSchedule, prevLoopProj, NULL, entry, dirty,
+             conflictsTracker, inverseMaps, ignoreWAR, UP);
+  for (int i = seed - 1; i >= 0; i--) {
+    loop_t* curLoop = loops->at(i);
+    schedule_t* tilingInfo = *entry++;
+    nRetiled += retile_loop (curLoop, prevLoopProj, tilingInfo, dirty, conflictsTracker,
+                             inverseMaps, UP, &tilesChanged);
+    reassign |= tilesChanged;
+    if (reassign) {
+      assign_loop (curLoop, loops, tiles, tilingInfo->iter2tc, UP);
+    }
+    reproject (curLoop, tilingInfo, prevLoopProj, NULL, entry, dirty,
+               conflictsTracker, inverseMaps, ignoreWAR, UP);
+  }
+  delete prevLoopProj;
+
+  ASSERT(entry == trace->end(), "The trace does not match the loop chain");
+
+  return nRetiled;
+}
 
 /***** Static / utility functions *****/
 
-inline static void update_tiles_tracker (tracker_t& iterTilesPerColor,
-                                         index_set iterColors,
-                                         tracker_t& conflictsTracker)
+/*
+ * Tile again the iterations of /curLoop/ adjacent to an element, in any of the
+ * projections in /prevLoopProj/, whose tile or color changed, as /tile_forward/
+ * (/tile_backward/, if /direction/ is UP) would do. The schedule of /curLoop/ in
+ * the trace, /loopIter2tc/, is updated in place, and the iterations whose tile
+ * or color changed are recorded in /dirty/. Return the number of iterations
+ * tiled again; /tilesChanged/ is set to true if any changed tile.
+ */
+static long retile_loop (loop_t* curLoop, projection_t* prevLoopProj,
+                         schedule_t* loopIter2tc, dirty_map& dirty,
+                         tracker_t* conflictsTracker, inverse_maps* inverseMaps,
+                         direction_t direction, bool* tilesChanged)
 {
-  tracker_t::const_iterator it, end;
-  for (it = iterTilesPerColor.begin(), end = iterTilesPerColor.end(); it != end; it++) {
-    index_set adjTiles = it->second;
-    index_set::const_iterator tIt, tEnd;
-    for (tIt = adjTiles.begin(), tEnd = adjTiles.end(); tIt != tEnd; tIt++) {
-      // if conflicts detected on a color add the relevant information to tiles
-      // involved in the conflict
-      if (adjTiles.size() > 1) {
-        conflictsTracker[*tIt].insert (adjTiles.begin(), adjTiles.end());
+  // aliases
+  set_t* toTile = curLoop->set;
+  index_t toTileSetSize = toTile->size;
+  desc_list* descriptors = curLoop->descriptors;
+  tc_t* loopValues = loopIter2tc->iter2tc;
+  int untouched = (direction == DOWN) ? -1 : TC_MAX;
+
+  std::vector<index_t>& loopDirty = dirty[loopIter2tc];
+  *tilesChanged = false;
+  if (toTileSetSize == 0) {
+    return 0;
+  }
+
+  // the projections determining the tiling, as in /tile_forward/, and those in
+  // which ties are tracked, as in /track_ties/; a NULL map means a direct access
+  std::vector<schedule_t*> sources, tieSources;
+  std::vector<map_t*> sourceMaps, tieMaps;
+  std::set<set_t*, bool(*)(const set_t* a, const set_t* b)> checkedSets (&set_cmp);
+  std::vector<index_t> candidates;
+
+  desc_list::const_iterator it, end;
+  for (it = descriptors->begin(), end = descriptors->end(); it != end; it++) {
+    // aliases
+    map_t* descMap = (*it)->map;
+    set_t* touchedSet = (descMap == DIRECT) ? toTile : descMap->outSet;
+
+    schedule_t projIter2tc = {touchedSet->name};
+    projection_t::iterator iprojIter2tc = prevLoopProj->find (&projIter2tc);
+    if (iprojIter2tc == prevLoopProj->end()) {
+      continue;
+    }
+    map_t* indMap = (descMap == DIRECT) ? NULL : descMap;
+    tieSources.push_back (*iprojIter2tc);
+    tieMaps.push_back (indMap);
+    if (checkedSets.find(touchedSet) == checkedSets.end()) {
+      sources.push_back (*iprojIter2tc);
+      sourceMaps.push_back (indMap);
+      checkedSets.insert (touchedSet);
+    }
+
+    // the iterations adjacent to a changed element have to be tiled again
+    std::vector<index_t>& projDirty = dirty[*iprojIter2tc];
+    if (! indMap) {
+      candidates.insert (candidates.end(), projDirty.begin(), projDirty.end());
+      continue;
+    }
+    map_t* invMap = map_invert_cached (indMap, inverseMaps);
+    for (size_t k = 0; k < projDirty.size(); k++) {
+      index_t e = projDirty[k];
+      candidates.insert (candidates.end(), invMap->values + invMap->offsets[e],
+                         invMap->values + invMap->offsets[e + 1]);
+    }
+  }
+
+  if (sources.empty()) {
+    // the tiling does not depend on the projections, but it is derived from one
+    // of them as a whole: derive it again
+    schedule_t* derived = schedule_cpy (loopIter2tc);
+    derive_dependency_free_tiling (curLoop, prevLoopProj, derived);
+    loopDirty.clear();
+    for (index_t i = 0; i < toTileSetSize; i++) {
+      if (derived->iter2tc[i] != loopValues[i]) {
+        *tilesChanged |= tc_tile(derived->iter2tc[i]) != tc_tile(loopValues[i]);
+        loopValues[i] = derived->iter2tc[i];
+        loopDirty.push_back (i);
+      }
+    }
+    schedule_free (derived);
+    return toTileSetSize;
+  }
+
+  sort_unique (candidates, toTileSetSize);
+  index_t nCandidates = candidates.size();
+  std::vector<char> changed (nCandidates);
+  bool anyTileChanged = false;
+  int nSources = sources.size();
+  int nTieSources = tieSources.size();
+
+  #pragma omp parallel reduction(||:anyTileChanged)
+  {
+    // conflicts detected by a thread
+    std::vector<uint64_t> localConflicts;
+    #pragma omp for schedule(static)
+    for (index_t k = 0; k < nCandidates; k++) {
+      index_t i = candidates[k];
+      tc_t iterTc = tc_pack (untouched, untouched);
+      for (int s = 0; s < nSources; s++) {
+        tc_t* projValues = sources[s]->iter2tc;
+        map_t* sourceMap = sourceMaps[s];
+        index_t* offsets = sourceMap ? sourceMap->offsets : NULL;
+        int arity = (sourceMap && ! offsets) ? sourceMap->size / toTileSetSize : 1;
+        index_t end = offsets ? offsets[i + 1] : (i + 1)*arity;
+        for (index_t j = offsets ? offsets[i] : i*arity; j < end; j++) {
+          index_t indIter = sourceMap ? sourceMap->values[j] : i;
+          if (indIter == -1) {
+            continue;
+          }
+          if (overrides (tc_color(iterTc), tc_color(projValues[indIter]), direction)) {
+            iterTc = projValues[indIter];
+          }
+        }
+      }
+      int iterTile = tc_tile(iterTc);
+      for (int s = 0; s < nTieSources; s++) {
+        tc_t* projValues = tieSources[s]->iter2tc;
+        map_t* tieMap = tieMaps[s];
+        index_t* offsets = tieMap ? tieMap->offsets : NULL;
+        int arity = (tieMap && ! offsets) ? tieMap->size / toTileSetSize : 1;
+        index_t end = offsets ? offsets[i + 1] : (i + 1)*arity;
+        for (index_t j = offsets ? offsets[i] : i*arity; j < end; j++) {
+          index_t indIter = tieMap ? tieMap->values[j] : i;
+          if (indIter == -1) {
+            continue;
+          }
+          tc_t indTc = projValues[indIter];
+          if (tc_color(indTc) == tc_color(iterTc) && indTc != iterTc) {
+            localConflicts.push_back (pack(iterTile, tc_tile(indTc)));
+            localConflicts.push_back (pack(tc_tile(indTc), iterTile));
+          }
+        }
       }
+      anyTileChanged = anyTileChanged || iterTile != tc_tile(loopValues[i]);
+      changed[k] = iterTc != loopValues[i];
+      loopValues[i] = iterTc;
     }
-    for (tIt = adjTiles.begin(), tEnd = adjTiles.end(); tIt != tEnd; tIt++) {
-      conflictsTracker[*tIt].erase (*tIt);
+
+    sort_unique (localConflicts);
+    #pragma omp critical
+    {
+      std::vector<uint64_t>& edges = conflictsTracker->edges;
+      edges.insert (edges.end(), localConflicts.begin(), localConflicts.end());
     }
   }
+
+  keep_changed (candidates, changed);
+  loopDirty.swap (candidates);
+  *tilesChanged = anyTileChanged;
+
+#ifdef SLOPE_VTK
+  if (curLoop->tiling && curLoop->coloring) {
+    schedule_unpack (loopIter2tc, curLoop->tiling, curLoop->coloring);
+  }
+#endif
+
+  return nCandidates;
+}
+
+/*
+ * Project again, as /project_forward/ (/project_backward/, if /direction/ is UP)
+ * would do, the elements adjacent to an iteration of /tiledLoop/ whose tile or
+ * color changed, as well as the elements of an older projection that changed.
+ * The projections in the trace, starting from /entry/, are updated in place,
+ * and the elements whose tile or color changed are recorded in /dirty/.
+ */
+static void reproject (loop_t* tiledLoop, schedule_t* tilingInfo,
+                       projection_t* prevLoopProj, projection_t* seedLoopProj,
+                       trace_t::iterator& entry, dirty_map& dirty,
+                       tracker_t* conflictsTracker, inverse_maps* inverseMaps,
+                       bool ignoreWAR, direction_t direction)
+{
+  // aliases
+  desc_list* descriptors = tiledLoop->descriptors;
+  tc_t* iter2tc = tilingInfo->iter2tc;
+  std::vector<index_t>& tiledDirty = dirty[tilingInfo];
+  int untouched = (direction == DOWN) ? -1 : TC_MAX;
+
+  bool directHandled = false;
+  desc_list::const_iterator it, end;
+  for (it = descriptors->begin(), end = descriptors->end(); it != end; it++) {
+    // aliases
+    map_t* descMap = (*it)->map;
+    am_t descMode = (*it)->mode;
+
+    schedule_t* projIter2tc;
+    if (descMap == DIRECT) {
+      if (directHandled) {
+        continue;
+      }
+      projIter2tc = tilingInfo;
+      directHandled = true;
+    }
+    else {
+      if (descMap->inSet->size == 0 || (descMode == READ && ignoreWAR)) {
+        continue;
+      }
+
+      // aliases
+      map_t* invMap = map_invert_cached (descMap, inverseMaps);
+      index_t* indMap = invMap->values;
+      index_t* offsets = invMap->offsets;
+
+      projIter2tc = *entry++;
+      tc_t* projValues = projIter2tc->iter2tc;
+      projection_t::iterator iOldProjIter2tc = prevLoopProj->find (projIter2tc);
+      schedule_t* oldProjIter2tc = (iOldProjIter2tc != prevLoopProj->end()) ?
+                                   *iOldProjIter2tc : NULL;
+
+      // the elements to project again
+      std::vector<index_t> candidates;
+      for (size_t k = 0; k < tiledDirty.size(); k++) {
+        index_t offset;
+        int size;
+        map_ofs (descMap, tiledDirty[k], &offset, &size);
+        for (index_t j = offset; j < offset + size; j++) {
+          index_t e = descMap->values[j];
+          if (e != -1) {
+            candidates.push_back (e);
+          }
+        }
+      }
+      if (oldProjIter2tc) {
+        std::vector<index_t>& oldDirty = dirty[oldProjIter2tc];
+        candidates.insert (candidates.end(), oldDirty.begin(), oldDirty.end());
+      }
+      sort_unique (candidates, invMap->inSet->size);
+      index_t nCandidates = candidates.size();
+      std::vector<char> changed (nCandidates);
+
+      #pragma omp parallel
+      {
+        // conflicts detected by a thread
+        std::vector<uint64_t> localConflicts;
+        // temporary buffer for updating the tracker, reused by all iterations
+        std::vector<uint64_t> iterTilesPerColor;
+        #pragma omp for schedule(static)
+        for (index_t k = 0; k < nCandidates; k++) {
+          index_t i = candidates[k];
+          tc_t iterTc = tc_pack (untouched, untouched);
+          iterTilesPerColor.clear();
+          for (index_t j = offsets[i]; j < offsets[i + 1]; j++) {
+            tc_t indTc = iter2tc[indMap[j]];
+            if (overrides (tc_color(iterTc), tc_color(indTc), direction)) {
+              iterTc = indTc;
+            }
+            iterTilesPerColor.push_back (pack(tc_color(indTc), tc_tile(indTc)));
+          }
+          update_tiles_tracker (iterTilesPerColor, localConflicts);
+
+          // an untouched element replicates the older projection, except for the
+          // elements untouched when tiling forward from the seed loop
+          if (tc_tile(iterTc) == untouched && oldProjIter2tc &&
+              (direction == DOWN || tc_tile(oldProjIter2tc->iter2tc[i]) != -1)) {
+            iterTc = oldProjIter2tc->iter2tc[i];
+          }
+          changed[k] = iterTc != projValues[i];
+          projValues[i] = iterTc;
+        }
+
+        sort_unique (localConflicts);
+        #pragma omp critical
+        {
+          std::vector<uint64_t>& edges = conflictsTracker->edges;
+          edges.insert (edges.end(), localConflicts.begin(), localConflicts.end());
+        }
+      }
+
+      keep_changed (candidates, changed);
+      dirty[projIter2tc].swap (candidates);
+    }
+
+    // update the projections as the tiling sweep does
+    if (seedLoopProj && seedLoopProj->find (projIter2tc) == seedLoopProj->end()) {
+      seedLoopProj->insert (projIter2tc);
+    }
+    projection_t::iterator toReplace = prevLoopProj->find (projIter2tc);
+    if (toReplace != prevLoopProj->end()) {
+      prevLoopProj->erase (toReplace);
+    }
+    prevLoopProj->insert (projIter2tc);
+  }
+}
+
+
+/*
+ * An iteration of /curLoop/ is assigned the tile with the maximum (minimum, if
+ * tiling backward) color among those of the elements it touches. If another tile
+ * with that same color touches one of these elements, possibly through a different
+ * descriptor, the two tiles must not run concurrently: track them as conflicting
+ */
+static void track_ties (loop_t* curLoop, projection_t* prevLoopProj,
+                        schedule_t* loopIter2tc, tracker_t* conflictsTracker)
+{
+  // aliases
+  set_t* toTile = curLoop->set;
+  index_t toTileSetSize = toTile->size;
+  desc_list* descriptors = curLoop->descriptors;
+  tc_t* loopValues = loopIter2tc->iter2tc;
+
+  desc_list::const_iterator it, end;
+  for (it = descriptors->begin(), end = descriptors->end(); it != end; it++) {
+    // aliases
+    map_t* descMap = (*it)->map;
+    set_t* touchedSet = (descMap == DIRECT) ? toTile : descMap->outSet;
+
+    schedule_t projIter2tc = {touchedSet->name};
+    projection_t::iterator iprojIter2tc = prevLoopProj->find (&projIter2tc);
+    if (iprojIter2tc == prevLoopProj->end()) {
+      continue;
+    }
+    tc_t* projValues = (*iprojIter2tc)->iter2tc;
+    index_t* indMap = (descMap == DIRECT) ? NULL : descMap->values;
+    index_t* offsets = (descMap == DIRECT) ? NULL : descMap->offsets;
+    int arity = (descMap == DIRECT || offsets) ? 1 : descMap->size / toTileSetSize;
+
+    #pragma omp parallel
+    {
+      std::vector<uint64_t> localConflicts;
+      #pragma omp for schedule(static)
+      for (index_t i = 0; i < toTileSetSize; i++) {
+        index_t end = offsets ? offsets[i + 1] : (i + 1)*arity;
+        for (index_t j = offsets ? offsets[i] : i*arity; j < end; j++) {
+          index_t indIter = indMap ? indMap[j] : i;
+          if (indIter == -1) {
+            continue;
+          }
+          // same color, different tile
+          tc_t indTc = projValues[indIter];
+          if (tc_color(indTc) == tc_color(loopValues[i]) && indTc != loopValues[i]) {
+            localConflicts.push_back (pack(tc_tile(loopValues[i]), tc_tile(indTc)));
+            localConflicts.push_back (pack(tc_tile(indTc), tc_tile(loopValues[i])));
+          }
+        }
+      }
+      sort_unique (localConflicts);
+      #pragma omp critical
+      {
+        std::vector<uint64_t>& edges = conflictsTracker->edges;
+        edges.insert (edges.end(), localConflicts.begin(), localConflicts.end());
+      }
+    }
+  }
+}
+
+inline static void update_tiles_tracker (std::vector<uint64_t>& iterTilesPerColor,
+                                         std::vector<uint64_t>& localConflicts)
+{
+  // most elements touch a single tile, and so cannot be in conflict
+  int nTouched = iterTilesPerColor.size();
+  int same = 1;
+  while (same < nTouched && iterTilesPerColor[same] == iterTilesPerColor[0]) {
+    same++;
+  }
+  if (same == nTouched) {
+    return;
+  }
+
+  // /iterTilesPerColor/ contains (color, tile) pairs, so once sorted the tiles
+  // having the same color are contiguous
+  sort_unique (iterTilesPerColor);
+  int nTiles = iterTilesPerColor.size();
+  for (int start = 0, end = 0; start < nTiles; start = end) {
+    uint64_t color = iterTilesPerColor[start] >> 32;
+    for (end = start + 1; end < nTiles && (iterTilesPerColor[end] >> 32) == color; end++);
+    // if conflicts detected on a color add the relevant information to tiles
+    // involved in the conflict
+    for (int j = start; j < end && end - start > 1; j++) {
+      for (int k = start; k < end; k++) {
+        if (j != k) {
+          int tile = (uint32_t)iterTilesPerColor[j];
+          int adjTile = (uint32_t)iterTilesPerColor[k];
+          localConflicts.push_back (pack(tile, adjTile));
+        }
+      }
+    }
+  }
+  // the same conflict is usually detected many times, so drop duplicates before
+  // the buffer needs to grow
+  if (localConflicts.size() >= (1 << 16) &&
+      localConflicts.size() == localConflicts.capacity()) {
+    sort_unique (localConflicts);
+  }
+}
+
+inline static void sort_unique (std::vector<uint64_t>& values)
+{
+  std::sort (values.begin(), values.end());
+  values.erase (std::unique (values.begin(), values.end()), values.end());
+}
+
+/*
+ * As above, for elements of a set of size /setSize/: if there are many elements,
+ * it is faster to mark them in a dense array than to sort them
+ */
+inline static void sort_unique (std::vector<index_t>& values, index_t setSize)
+{
+  if ((index_t)values.size() < setSize / 16) {
+    std::sort (values.begin(), values.end());
+    values.erase (std::unique (values.begin(), values.end()), values.end());
+    return;
+  }
+  std::vector<char> marked (setSize, false);
+  for (size_t k = 0; k < values.size(); k++) {
+    marked[values[k]] = true;
+  }
+  values.clear();
+  for (index_t i = 0; i < setSize; i++) {
+    if (marked[i]) {
+      values.push_back (i);
+    }
+  }
+}
+
+/*
+ * Keep in /candidates/ only the elements marked in /changed/
+ */
+inline static void keep_changed (std::vector<index_t>& candidates, std::vector<char>& changed)
+{
+  index_t nChanged = 0;
+  for (size_t k = 0; k < candidates.size(); k++) {
+    if (changed[k]) {
+      candidates[nChanged++] = candidates[k];
+    }
+  }
+  candidates.resize (nChanged);
+}
+
+/*
+ * Return true if, tiling in /direction/, an iteration of color /color/ adjacent
+ * to an iteration of color /candidate/ takes the latter's tile and color
+ */
+inline static bool overrides (int color, int candidate, direction_t direction)
+{
+  return (direction == DOWN) ? candidate > color : candidate < color;
+}
+
+inline static uint64_t pack (int high, int low)
+{
+  return ((uint64_t)(uint32_t)high << 32) | (uint32_t)low;
 }
 
 inline static void derive_dependency_free_tiling (loop_t* curLoop,
@@ -677,9 +1233,8 @@ inline static void derive_dependency_free_tiling (loop_t* curLoop,
                                                   schedule_t* loopIter2tc)
 {
   // aliases
-  int toTileSetSize = loopIter2tc->itSetSize;
-  int* loopIter2tile = loopIter2tc->iter2tile;
-  int* loopIter2color = loopIter2tc->iter2color;
+  index_t toTileSetSize = loopIter2tc->itSetSize;
+  tc_t* loopValues = loopIter2tc->iter2tc;
   map_t* indMap = curLoop->seedMap;
   bool fallback = true;
 
@@ -688,17 +1243,14 @@ inline static void derive_dependency_free_tiling (loop_t* curLoop,
     schedule_t projIter2tc = {indMap->outSet->name};
     projection_t::iterator iprojIter2tc = prevLoopProj->find (&projIter2tc);
     if (iprojIter2tc != prevLoopProj->end()) {
-      int indSetSize = (*iprojIter2tc)->itSetSize;
-      int* indIter2tile = (*iprojIter2tc)->iter2tile;
-      int* indIter2color = (*iprojIter2tc)->iter2color;
+      index_t indSetSize = (*iprojIter2tc)->itSetSize;
+      tc_t* indValues = (*iprojIter2tc)->iter2tc;
 
-      int maxSize = MIN(toTileSetSize, indSetSize);
-      memcpy (loopIter2tile, indIter2tile, sizeof(int)*maxSize);
-      memcpy (loopIter2color, indIter2color, sizeof(int)*maxSize);
+      index_t maxSize = MIN(toTileSetSize, indSetSize);
+      memcpy (loopValues, indValues, sizeof(tc_t)*maxSize);
       // remainder, if necessary
-      for (int i = indSetSize; i < toTileSetSize; i++) {
-        loopIter2tile[i] = loopIter2tile[i-1];
-        loopIter2color[i] = loopIter2color[i-1];
+      for (index_t i = indSetSize; i < toTileSetSize; i++) {
+        loopValues[i] = loopValues[i-1];
       }
       fallback = false;
     }
@@ -707,8 +1259,151 @@ inline static void derive_dependency_free_tiling (loop_t* curLoop,
   if (fallback) {
     // the /curLoop/ iteration space is never accessed directly and this is the
     // first time it's encountered; readapt one of the known schedules
-    std::fill_n (loopIter2tile, toTileSetSize, 0);
-    std::fill_n (loopIter2color, toTileSetSize, 0);
+    std::fill_n (loopValues, toTileSetSize, tc_pack (0, 0));
+  }
+
+}
+
+/*
+ * Tile the iterations of a loop through an indirect map, either of arity /arity/
+ * or irregular (i.e., with /offsets/), as /tile_forward/ (/tile_backward/, if
+ * /direction/ is UP) does. The arity is dispatched once, so that the common
+ * arities run a kernel specialized for them
+ */
+static void tile_indirect (tc_t* loopValues, tc_t* projValues, index_t* indMap,
+                           index_t* offsets, index_t nIters, int arity, direction_t direction)
+{
+  #pragma omp parallel
+  {
+    // /tile_indirect_kernel/ is inlined in each case, and the constant arity and
+    // direction are propagated into it
+    if (direction == DOWN) {
+      switch (offsets ? 0 : arity) {
+        case 1:
+          tile_indirect_kernel (loopValues, projValues, indMap, NULL, nIters, 1, DOWN);
+          break;
+        case 2:
+          tile_indirect_kernel (loopValues, projValues, indMap, NULL, nIters, 2, DOWN);
+          break;
+        case 3:
+          tile_indirect_kernel (loopValues, projValues, indMap, NULL, nIters, 3, DOWN);
+          break;
+        case 4:
+          tile_indirect_kernel (loopValues, projValues, indMap, NULL, nIters, 4, DOWN);
+          break;
+        case 6:
+          tile_indirect_kernel (loopValues, projValues, indMap, NULL, nIters, 6, DOWN);
+          break;
+        case 8:
+          tile_indirect_kernel (loopValues, projValues, indMap, NULL, nIters, 8, DOWN);
+          break;
+        default:
+          tile_indirect_kernel (loopValues, projValues, indMap, offsets, nIters, arity, DOWN);
+      }
+    }
+    else {
+      switch (offsets ? 0 : arity) {
+        case 1:
+          tile_indirect_kernel (loopValues, projValues, indMap, NULL, nIters, 1, UP);
+          break;
+        case 2:
+          tile_indirect_kernel (loopValues, projValues, indMap, NULL, nIters, 2, UP);
+          break;
+        case 3:
+          tile_indirect_kernel (loopValues, projValues, indMap, NULL, nIters, 3, UP);
+          break;
+        case 4:
+          tile_indirect_kernel (loopValues, projValues, indMap, NULL, nIters, 4, UP);
+          break;
+        case 6:
+          tile_indirect_kernel (loopValues, projValues, indMap, NULL, nIters, 6, UP);
+          break;
+        case 8:
+          tile_indirect_kernel (loopValues, projValues, indMap, NULL, nIters, 8, UP);
+          break;
+        default:
+          tile_indirect_kernel (loopValues, projValues, indMap, offsets, nIters, arity, UP);
+      }
+    }
+  }
+}
+
+/*
+ * The body of /tile_indirect/, to be called within a parallel region. The inner
+ * loop is branch-free: the tile and color of an iteration are selected rather
+ * than conditionally updated, and off-processor elements (set to -1 in the map)
+ * are read as the first element of the touched set, which must not be empty, and
+ * then ignored
+ */
+inline static void tile_indirect_kernel (tc_t* loopValues, tc_t* projValues, index_t* indMap,
+                                         index_t* offsets, index_t nIters, int arity,
+                                         direction_t direction)
+{
+  #pragma omp for schedule(static)
+  for (index_t i = 0; i < nIters; i++) {
+    tc_t iterTc = loopValues[i];
+    index_t end = offsets ? offsets[i + 1] : (i + 1)*arity;
+    for (index_t j = offsets ? offsets[i] : i*arity; j < end; j++) {
+      index_t indIter = indMap[j];
+      tc_t indTc = projValues[MAX(indIter, (index_t)0)];
+      bool takes = (indIter != -1) & overrides (tc_color(iterTc), tc_color(indTc), direction);
+      iterTc = takes ? indTc : iterTc;
+    }
+    // now all adjacent iterations have been examined, so assign the MAX (MIN, if
+    // tiling backward) color found and the corresponding tile
+    loopValues[i] = iterTc;
+  }
+}
+
+inline static void bucket_iterations (tc_t* iter2tc, index_t nIters, int nTiles,
+                                      index_t* offsets, index_t* tile2iter)
+{
+  // a counting sort of the tiles in /iter2tc/: each thread counts the iterations per tile
+  // in a contiguous chunk of the iteration space, then scatters its chunk
+  // starting from the position given by a prefix sum over (tile, thread)
+  int nThreads = 1;
+  index_t* counts = NULL;
+
+  #pragma omp parallel
+  {
+    int thread = 0;
+#ifdef SLOPE_OMP
+    thread = omp_get_thread_num();
+    #pragma omp single
+    nThreads = omp_get_num_threads();
+#endif
+    #pragma omp single
+    counts = new index_t[nThreads*nTiles]();
+
+    index_t* threadCounts = counts + thread*nTiles;
+    index_t chunkStart = (long)nIters*thread / nThreads;
+    index_t chunkEnd = (long)nIters*(thread + 1) / nThreads;
+
+    for (index_t i = chunkStart; i < chunkEnd; i++) {
+      int tile = tc_tile(iter2tc[i]);
+      ASSERT((tile >= 0) && (tile < nTiles), "Invalid tile ID");
+      threadCounts[tile]++;
+    }
+
+    #pragma omp barrier
+    #pragma omp single
+    {
+      index_t offset = 0;
+      for (int t = 0; t < nTiles; t++) {
+        offsets[t] = offset;
+        for (int j = 0; j < nThreads; j++) {
+          index_t count = counts[j*nTiles + t];
+          counts[j*nTiles + t] = offset;
+          offset += count;
+        }
+      }
+      offsets[nTiles] = offset;
+    }
+
+    for (index_t i = chunkStart; i < chunkEnd; i++) {
+      tile2iter[threadCounts[tc_tile(iter2tc[i])]++] = i;
+    }
   }
 
+  delete[] counts;
 }
@@ -0,0 +1,241 @@
+/*
+ *  tuner.cpp
+ *
+ * Implement the selection of the tile size, either empirical or driven by the
+ * cache sizes
+ */
+
+#include <vector>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <math.h>
+#include <limits.h>
+
+#include "tuner.h"
+#include "cache.h"
+#include "common.h"
+#include "utils.h"
+
+#define MAX_FITS 6
+
+/*
+ * File layout: one line per loop chain, made of the fingerprint of the inspection
+ * problem (in hexadecimal) followed by the best tile size
+ */
+
+// prototypes of static functions
+static int tune_lookup (std::string fileName, uint64_t key);
+static void tune_store (std::string fileName, uint64_t key, int avgTileSize);
+static long footprint_quantile (inspector_t* insp, double fraction);
+
+
+insp_info insp_tune (inspector_t* insp, int suggestedSeed, tune_kernel kernel, void* args,
+                     tuning_t* tuning, int* tileSizes, int nTileSizes, int nRuns,
+                     exec_mode mode, std::string fileName)
+{
+  ASSERT(insp != NULL, "Invalid NULL pointer to inspector");
+  ASSERT(kernel != NULL, "Invalid NULL pointer to kernel");
+
+  // aliases
+  int avgTileSize = insp->avgTileSize;
+
+  // the candidate tile sizes, in increasing order and without duplicates
+  int defaultSizes[] = {avgTileSize / 4, avgTileSize / 2, avgTileSize,
+                        avgTileSize * 2, avgTileSize * 4};
+  if (! tileSizes) {
+    tileSizes = defaultSizes;
+    nTileSizes = 5;
+  }
+  std::vector<int> candidates;
+  for (int i = 0; i < nTileSizes; i++) {
+    if (tileSizes[i] > 0) {
+      candidates.push_back (tileSizes[i]);
+    }
+  }
+  std::sort (candidates.begin(), candidates.end());
+  candidates.erase (std::unique (candidates.begin(), candidates.end()), candidates.end());
+  if (candidates.empty()) {
+    return INSP_ERR;
+  }
+
+  // the best tile size does not depend on the tile size the inspector was
+  // initialized with, which is therefore left out of the fingerprint
+  insp->avgTileSize = 0;
+  uint64_t key = cache_fingerprint (insp, suggestedSeed);
+  insp->avgTileSize = avgTileSize;
+
+  int bestTileSize = fileName.empty() ? 0 : tune_lookup (fileName, key);
+  double bestTime = 0.0;
+  int nTried = 0;
+  if (bestTileSize <= 0) {
+    for (size_t i = 0; i < candidates.size(); i++) {
+      insp->avgTileSize = candidates[i];
+      insp_run (insp, suggestedSeed);
+      executor_t* exec = exec_init (insp, mode);
+
+      // warm up, then keep the fastest run
+      kernel (exec, args);
+      double execTime = 0.0;
+      for (int r = 0; r < MAX(nRuns, 1); r++) {
+        double start = time_stamp();
+        kernel (exec, args);
+        double end = time_stamp();
+        execTime = (r == 0) ? end - start : MIN(execTime, end - start);
+      }
+
+      // the tiles are owned, and so freed, by the executor; the rest of the
+      // inspection is freed by the next /insp_run/
+      exec_free (exec);
+      nTried++;
+
+      if (bestTileSize <= 0 || execTime < bestTime) {
+        bestTileSize = candidates[i];
+        bestTime = execTime;
+      }
+    }
+    if (! fileName.empty()) {
+      tune_store (fileName, key, bestTileSize);
+    }
+  }
+
+  insp->avgTileSize = bestTileSize;
+  insp_run (insp, suggestedSeed);
+
+  if (tuning) {
+    tuning->avgTileSize = bestTileSize;
+    tuning->execTime = bestTime;
+    tuning->nTried = nTried;
+  }
+
+  return INSP_OK;
+}
+
+insp_info insp_fit_cache (inspector_t* insp, int suggestedSeed, int cacheLevel,
+                          double fraction, long cacheSize)
+{
+  ASSERT(insp != NULL, "Invalid NULL pointer to inspector");
+  ASSERT(fraction > 0.0 && fraction <= 1.0, "Invalid fraction of tiles");
+
+  // aliases
+  loop_list* loops = insp->loops;
+
+  cacheSize = (cacheSize > 0) ? cacheSize : cpu_cache_size (cacheLevel, insp->nThreads);
+  bool knownBytes = false;
+  loop_list::const_iterator lIt, lEnd;
+  for (lIt = loops->begin(), lEnd = loops->end(); lIt != lEnd; lIt++) {
+    desc_list::const_iterator dIt, dEnd;
+    for (dIt = (*lIt)->descriptors->begin(), dEnd = (*lIt)->descriptors->end(); dIt != dEnd; dIt++) {
+      knownBytes |= (*dIt)->bytes > 0;
+    }
+  }
+  if (cacheSize <= 0 || ! knownBytes) {
+    return INSP_ERR;
+  }
+
+  // /fitting/ is the largest tile size meeting the target, /exceeding/ the
+  // smallest one not meeting it
+  int tileSize = MAX(insp->avgTileSize, 1);
+  int fitting = 0, exceeding = INT_MAX;
+  for (int i = 0; i < MAX_FITS; i++) {
+    insp->avgTileSize = tileSize;
+    insp_run (insp, suggestedSeed);
+
+    // the footprint grows roughly linearly with the tile size
+    long footprint = footprint_quantile (insp, fraction);
+    if (footprint <= cacheSize) {
+      fitting = MAX(fitting, tileSize);
+    }
+    else {
+      exceeding = MIN(exceeding, tileSize);
+    }
+    double scale = (footprint > 0) ? (double)cacheSize / footprint : 2.0;
+    int next = MAX((int)(tileSize * scale), 1);
+    if (next <= fitting || next >= exceeding) {
+      // not quite linear: bisect between the tile sizes tried so far
+      next = (exceeding == INT_MAX) ? 2*fitting : fitting + (exceeding - fitting) / 2;
+    }
+    if (next <= fitting || next >= exceeding || abs(next - tileSize) <= tileSize / 20) {
+      break;
+    }
+    tileSize = next;
+  }
+
+  // if no tile size met the target, the smallest one tried is the closest
+  int bestTileSize = fitting ? fitting : exceeding;
+  if (bestTileSize != insp->avgTileSize) {
+    insp->avgTileSize = bestTileSize;
+    insp_run (insp, suggestedSeed);
+  }
+
+  return INSP_OK;
+}
+
+/***** Static / utility functions *****/
+
+/*
+ * Return the footprint that a /fraction/ of the core tiles does not exceed
+ */
+static long footprint_quantile (inspector_t* insp, double fraction)
+{
+  // aliases
+  tile_list* tiles = insp->tiles;
+  int nCore = insp->tileRegions->core;
+
+  if (nCore == 0) {
+    return 0;
+  }
+  std::vector<long> footprints (nCore);
+  for (int t = 0; t < nCore; t++) {
+    footprints[t] = tiles->at(t)->footprint;
+  }
+  int k = MIN(MAX((int)ceil(fraction*nCore) - 1, 0), nCore - 1);
+  std::nth_element (footprints.begin(), footprints.begin() + k, footprints.end());
+  return footprints[k];
+}
+
+/*
+ * Return the best tile size stored in /fileName/ for /key/, or 0 if not present
+ */
+static int tune_lookup (std::string fileName, uint64_t key)
+{
+  std::ifstream file (fileName.c_str());
+  std::string line;
+  while (std::getline (file, line)) {
+    std::istringstream entry (line);
+    uint64_t entryKey;
+    int avgTileSize;
+    if (entry >> std::hex >> entryKey >> std::dec >> avgTileSize && entryKey == key) {
+      return avgTileSize;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Store in /fileName/ the best tile size for /key/, replacing the entry for
+ * /key/, if any, and keeping the entries for any other key
+ */
+static void tune_store (std::string fileName, uint64_t key, int avgTileSize)
+{
+  std::vector<std::string> lines;
+  std::ifstream in (fileName.c_str());
+  std::string line;
+  while (std::getline (in, line)) {
+    std::istringstream entry (line);
+    uint64_t entryKey;
+    if (entry >> std::hex >> entryKey && entryKey != key) {
+      lines.push_back (line);
+    }
+  }
+  in.close();
+
+  std::ostringstream entry;
+  entry << std::hex << key << std::dec << " " << avgTileSize;
+  lines.push_back (entry.str());
+
+  std::ofstream out (fileName.c_str(), std::ios::out | std::ios::trunc);
+  for (size_t i = 0; i < lines.size(); i++) {
+    out << lines[i] << std::endl;
+  }
+}
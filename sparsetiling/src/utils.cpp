@@ -7,6 +7,53 @@
 #include <unordered_map>
 
 #include "utils.h"
+#include "common.h"
+
+long cpu_cache_size (int level, int nThreads)
+{
+  for (int index = 0; ; index++) {
+    std::ostringstream path;
+    path << "/sys/devices/system/cpu/cpu0/cache/index" << index << "/";
+    std::ifstream levelFile ((path.str() + "level").c_str());
+    std::ifstream typeFile ((path.str() + "type").c_str());
+    int cacheLevel;
+    std::string type;
+    if (! (levelFile >> cacheLevel) || ! (typeFile >> type)) {
+      // no more caches
+      return 0;
+    }
+    if (cacheLevel != level || type == "Instruction") {
+      continue;
+    }
+
+    // the size is given as, e.g., "32K"
+    std::ifstream sizeFile ((path.str() + "size").c_str());
+    long size;
+    char unit = ' ';
+    if (! (sizeFile >> size)) {
+      return 0;
+    }
+    sizeFile >> unit;
+    size *= (unit == 'K') ? 1024 : (unit == 'M') ? 1024*1024 : (unit == 'G') ? 1024*1024*1024 : 1;
+
+    // the CPUs sharing the cache are given as, e.g., "0-3,8-11"
+    std::ifstream sharingFile ((path.str() + "shared_cpu_list").c_str());
+    std::string range;
+    int nSharing = 0;
+    while (std::getline (sharingFile, range, ',')) {
+      int first, last;
+      char dash;
+      std::istringstream rangeStream (range);
+      if (rangeStream >> first) {
+        if (! (rangeStream >> dash >> last)) {
+          last = first;
+        }
+        nSharing += last - first + 1;
+      }
+    }
+    return size / MAX(MIN(nThreads, nSharing), 1);
+  }
+}
 
 void generate_vtk (inspector_t* insp,
                    insp_verbose level,
@@ -22,7 +69,7 @@ void generate_vtk (inspector_t* insp,
 
   // aliases
   loop_list* loops = insp->loops;
-  int nNodes = nodes->size;
+  index_t nNodes = nodes->size;
   std::string nodesSetName = nodes->name;
 
   // create directory in which the VTK files will be stored (if not already exists)
@@ -50,7 +97,7 @@ void generate_vtk (inspector_t* insp,
     // aliases
     loop_t* loop = *it;
     set_t* loopSet = loop->set;
-    int loopSetSize = loopSet->size;
+    index_t loopSetSize = loopSet->size;
     std::string loopSetName = loopSet->name;
     std::string loopName = loop->name;
     desc_list* descriptors = loop->descriptors;
@@ -76,7 +123,7 @@ void generate_vtk (inspector_t* insp,
     // write coordinates of nodes
     vtkfile << "DATASET POLYDATA" << std::endl;
     vtkfile << "POINTS " << nNodes << " float" << std::endl;
-    for (int j = 0; j < nNodes; j++) {
+    for (index_t j = 0; j < nNodes; j++) {
       vtkfile << coordinates[j*meshDim] << " " << coordinates[j*meshDim + 1];
       switch (meshDim) {
         case 1:
@@ -102,14 +149,14 @@ void generate_vtk (inspector_t* insp,
     itmap = (loopSetName == nodesSetName) ? mapCache.begin() : mapCache.find(loopSet);
     if (itmap != mapCache.end()) {
       map_t* map = itmap->second;
-      int toNodesSize = map->inSet->size;
-      int toNodesExecSize = map->inSet->core + map->inSet->execHalo;
+      index_t toNodesSize = map->inSet->size;
+      index_t toNodesExecSize = map->inSet->core + map->inSet->execHalo;
       int arity = map->size / toNodesSize;
       std::string shape = (arity == 2) ? "LINES " : "POLYGONS ";
       stream << shape << toNodesSize << " " << toNodesSize*(arity + 1) << std::endl;
       vtkfile << stream.str();
       // first core + exec ...
-      for (int k = 0; k < toNodesExecSize; k++) {
+      for (index_t k = 0; k < toNodesExecSize; k++) {
         vtkfile << arity;
         for (int l = 0; l < arity; l++) {
           vtkfile << " " << map->values[k*arity + l];
@@ -117,11 +164,11 @@ void generate_vtk (inspector_t* insp,
         vtkfile << std::endl;
       }
       // ... then non-exec, since there may be -1 for off-processor entities
-      for (int k = toNodesExecSize; k < toNodesSize; k++) {
+      for (index_t k = toNodesExecSize; k < toNodesSize; k++) {
         vtkfile << arity;
         for (int l = 0; l < arity; l++) {
           vtkfile << " ";
-          int e = k*arity + l;
+          index_t e = k*arity + l;
           if (map->values[e] != -1) {
             vtkfile << map->values[e];
           }
@@ -149,7 +196,7 @@ void generate_vtk (inspector_t* insp,
     vtkfile << std::endl << type << " " << loopSetSize << std::endl;
     vtkfile << "SCALARS colors int" << std::endl;
     vtkfile << "LOOKUP_TABLE default" << std::endl;
-    for (int k = 0; k < loopSetSize; k++) {
+    for (index_t k = 0; k < loopSetSize; k++) {
       vtkfile << loop->coloring[k] << std::endl;
     }
 
@@ -3,10 +3,14 @@
  *
  */
 
-#ifndef _COMMON_H_
-#define _COMMON_H_
+#ifndef _COMMON_HPP_
+#define _COMMON_HPP_
 
+#include <algorithm>
 #include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
 
 enum mesh_t {TRI = 3, RECT};
 
@@ -19,15 +23,15 @@ public:
   int vertices;
   int edges;
   int cells;
-  int *e2v;
+  index_t *e2v;
   int e2vSize;
-  int *c2v;
+  index_t *c2v;
   int c2vSize;
 
   // Data
   double *coords;
 
-  ExampleMesh(int vertices, int edges, int cells, int* e2v, int* c2v,
+  ExampleMesh(int vertices, int edges, int cells, index_t* e2v, index_t* c2v,
               double* coords, mesh_t type)
   {
     this->vertices = vertices;
@@ -51,10 +55,10 @@ public:
  * 10 -- 11 -- 12 -- 13 -- 14
  *
  */
-static int mesh1_e2v[] = {0,1 , 1,2 , 2,3 , 3,4 , 0,5 , 5,10, 1,6 , 6,11 , 2,7,
+static index_t mesh1_e2v[] = {0,1 , 1,2 , 2,3 , 3,4 , 0,5 , 5,10, 1,6 , 6,11 , 2,7,
                           7,12 , 3,8, 8,13 , 4,9 , 9,14 , 5,6 , 6,7 , 7,8 , 8,9,
                           10, 11 , 11,12 , 12,13, 13,14};
-static int mesh1_c2v[] = {0,1,6,5 , 1,2,7,6 , 2,3,8,7 , 3,4,9,8 , 5,6,11,10,
+static index_t mesh1_c2v[] = {0,1,6,5 , 1,2,7,6 , 2,3,8,7 , 3,4,9,8 , 5,6,11,10,
                           6,7,12,11 , 7,8,13,12 , 8,9,14,13};
 static double mesh1_coords[] = {0,0 , 0,1 , 0,2 , 0,3 , 0,4 , 1,0 , 1,1 , 1,2,
                                 1,3 , 1,4 , 2,0, 2,1 , 2,2 , 2,3 , 2,4};
@@ -68,9 +72,9 @@ static double mesh1_coords[] = {0,0 , 0,1 , 0,2 , 0,3 , 0,4 , 1,0 , 1,1 , 1,2,
  *  5 -- 6
  *
  */
-static int mesh2_e2v[] = {0,1 , 0,2 , 1,3 , 0,3 , 1,4 , 2,3 , 3,4 , 2,5 , 3,6,
+static index_t mesh2_e2v[] = {0,1 , 0,2 , 1,3 , 0,3 , 1,4 , 2,3 , 3,4 , 2,5 , 3,6,
                           2,6 , 6,4 , 5,6};
-static int mesh2_c2v[] = {0,2,3 , 0,1,3 , 1,3,4 , 2,5,6 , 2,3,6 , 3,4,6};
+static index_t mesh2_c2v[] = {0,2,3 , 0,1,3 , 1,3,4 , 2,5,6 , 2,3,6 , 3,4,6};
 
 
 ExampleMesh* example_mesh(mesh_t type)
@@ -89,6 +93,63 @@ ExampleMesh* example_mesh(mesh_t type)
 }
 
 
+/*
+ * A structured mesh of nx*ny quadrilateral cells, with unit spacing. Vertices,
+ * edges and cells are numbered row by row; the horizontal edges come first.
+ * Unlike the meshes above, its arrays are allocated, and freed along with it
+ */
+class ExampleGrid: public ExampleMesh
+{
+public:
+  ExampleGrid(int nx, int ny)
+  : ExampleMesh((nx + 1)*(ny + 1), nx*(ny + 1) + (nx + 1)*ny, nx*ny,
+                new index_t[(nx*(ny + 1) + (nx + 1)*ny)*2], new index_t[nx*ny*RECT],
+                new double[(nx + 1)*(ny + 1)*2], RECT)
+  {
+    int e = 0;
+    for (int j = 0; j <= ny; j++) {
+      for (int i = 0; i < nx; i++, e++) {
+        e2v[e*2] = j*(nx + 1) + i;
+        e2v[e*2 + 1] = j*(nx + 1) + i + 1;
+      }
+    }
+    for (int j = 0; j < ny; j++) {
+      for (int i = 0; i <= nx; i++, e++) {
+        e2v[e*2] = j*(nx + 1) + i;
+        e2v[e*2 + 1] = (j + 1)*(nx + 1) + i;
+      }
+    }
+    for (int j = 0; j < ny; j++) {
+      for (int i = 0; i < nx; i++) {
+        index_t* c = c2v + (j*nx + i)*RECT;
+        c[0] = j*(nx + 1) + i;
+        c[1] = j*(nx + 1) + i + 1;
+        c[2] = (j + 1)*(nx + 1) + i + 1;
+        c[3] = (j + 1)*(nx + 1) + i;
+      }
+    }
+    for (int j = 0; j <= ny; j++) {
+      for (int i = 0; i <= nx; i++) {
+        coords[(j*(nx + 1) + i)*2] = i;
+        coords[(j*(nx + 1) + i)*2 + 1] = j;
+      }
+    }
+  }
+
+  ~ExampleGrid()
+  {
+    delete[] e2v;
+    delete[] c2v;
+    delete[] coords;
+  }
+};
+
+ExampleGrid* example_grid(int nx, int ny)
+{
+  return new ExampleGrid(nx, ny);
+}
+
+
 // Meshes for MPI execution
 
 class ExampleMeshMPI: public ExampleMesh
@@ -99,7 +160,7 @@ public:
   int edges_halo;
   int cells_halo;
 
-  ExampleMeshMPI(int vertices[2], int edges[2], int cells[2], int* e2v, int* c2v,
+  ExampleMeshMPI(int vertices[2], int edges[2], int cells[2], index_t* e2v, index_t* c2v,
                  double* coords, mesh_t type)
   : ExampleMesh(vertices[0], edges[0], cells[0], e2v, c2v, coords, type)
   {
@@ -173,7 +234,7 @@ static int mesh_mpi1_e_set[][2] = {{-1, -1},  // (local size, halo size)
                                    {-1, -1}};
 static int mesh_mpi1_c_set[][2] = {{9, 6},  // (local size, halo size)
                                    {9, 6}};
-static int mesh_mpi1_c2v[][60] = {{0,1,5,4 , 1,2,6,5 , 2,3,7,6 , 4,5,9,8 , 5,6,10,9,
+static index_t mesh_mpi1_c2v[][60] = {{0,1,5,4 , 1,2,6,5 , 2,3,7,6 , 4,5,9,8 , 5,6,10,9,
                                    6,7,11,10 , 8,9,13,12 , 9,10,14,13 , 10,11,15,14,
                                    3,16,18,7 , 16,17,19,18 , 7,18,20,11 , 18,19,21,20,
                                    11,20,22,15 , 20,21,23,22},
@@ -202,4 +263,401 @@ ExampleMeshMPI* example_mpi_mesh(mesh_t type, int rank)
   }
 }
 
+
+// A loop chain over a mesh, to check the inspector and the executor
+
+/*
+ * The sets, maps and access descriptors of the loop chain:
+ * - loop over edges (PL0):
+ *     read indirectly vertices
+ *     write directly edges
+ * - loop over edges (PL1):
+ *     read directly edges
+ *     increment indirectly vertices
+ * - loop over cells (PL2):
+ *     read indirectly vertices
+ *     write directly cells
+ * - loop over cells (PL3):
+ *     read directly cells
+ *     increment indirectly vertices
+ * - only if /irregular/, loop over vertices (PL4):
+ *     read indirectly edges, through the irregular map from vertices to edges
+ *     read and write directly vertices
+ * Sets, maps and descriptors are freed along with the inspector the loops are
+ * added to, which must be freed before the chain
+ */
+class ExampleChain
+{
+public:
+  static const int maxLoops = 5;
+
+  int nLoops;
+  set_t *vertices, *edges, *cells;
+  map_t *e2v, *c2v, *v2e;
+  /* the iteration set of each loop, and the map it accesses */
+  set_t* sets[maxLoops];
+  map_t* maps[maxLoops];
+  desc_list descriptors[maxLoops];
+
+  ExampleChain(ExampleMesh* mesh, bool irregular = false)
+  {
+    vertices = set("vertices", mesh->vertices);
+    edges = set("edges", mesh->edges);
+    cells = set("cells", mesh->cells);
+    e2v = map("e2v", edges, vertices, mesh->e2v, mesh->e2vSize);
+    c2v = map("c2v", cells, vertices, mesh->c2v, mesh->c2vSize);
+    descriptors[0] = desc_list ({desc(e2v, READ),
+                                 desc(DIRECT, WRITE)});
+    descriptors[1] = desc_list ({desc(DIRECT, READ),
+                                 desc(e2v, INC)});
+    descriptors[2] = desc_list ({desc(c2v, READ),
+                                 desc(DIRECT, WRITE)});
+    descriptors[3] = desc_list ({desc(DIRECT, READ),
+                                 desc(c2v, INC)});
+    set_t* loopSets[] = {edges, edges, cells, cells, vertices};
+    map_t* loopMaps[] = {e2v, e2v, c2v, c2v, NULL};
+    nLoops = 4;
+
+    // the edges of each vertex, in increasing order
+    v2e = NULL;
+    v2eValues = NULL;
+    if (irregular) {
+      index_t* offsets = new index_t[mesh->vertices + 1];
+      std::fill (offsets, offsets + mesh->vertices + 1, 0);
+      for (int i = 0; i < mesh->e2vSize; i++) {
+        offsets[mesh->e2v[i] + 1]++;
+      }
+      for (int v = 0; v < mesh->vertices; v++) {
+        offsets[v + 1] += offsets[v];
+      }
+      v2eValues = new index_t[mesh->e2vSize];
+      std::vector<index_t> inserted (offsets, offsets + mesh->vertices);
+      for (int i = 0; i < mesh->e2vSize; i++) {
+        v2eValues[inserted[mesh->e2v[i]]++] = i / 2;
+      }
+      v2e = imap("v2e", vertices, edges, v2eValues, offsets);
+      descriptors[4] = desc_list ({desc(v2e, READ),
+                                   desc(DIRECT, RW)});
+      loopMaps[4] = v2e;
+      nLoops = 5;
+    }
+    std::copy (loopSets, loopSets + maxLoops, sets);
+    std::copy (loopMaps, loopMaps + maxLoops, maps);
+  }
+
+  ~ExampleChain()
+  {
+    // the offsets of /v2e/ are freed along with it
+    delete[] v2eValues;
+  }
+
+private:
+  index_t* v2eValues;
+};
+
+/*
+ * Add the loops of /chain/ to /insp/
+ */
+void example_add_loops(inspector_t* insp, ExampleChain* chain)
+{
+  for (int l = 0; l < chain->nLoops; l++) {
+    insp_add_parloop (insp, "pl" + std::to_string (l), chain->sets[l],
+                      &chain->descriptors[l]);
+  }
+}
+
+/*
+ * Return the entries of /map/ for /element/, and set /size/ to their number
+ */
+index_t* example_map_row(map_t* map, index_t element, int* size)
+{
+  if (map->offsets) {
+    *size = map->offsets[element + 1] - map->offsets[element];
+    return map->values + map->offsets[element];
+  }
+  *size = map->size / map->inSet->size;
+  return map->values + element*(*size);
+}
+
+/*
+ * The values updated by the loop chain, one per set element. They are integers
+ * modulo a prime, so that the results of tiled and untiled executions can be
+ * compared exactly, whatever the order of the increments
+ */
+class ExampleData
+{
+public:
+  int nVertices, nEdges, nCells;
+  long *vertices, *edges, *cells;
+
+  ExampleData(ExampleMesh* mesh)
+  {
+    nVertices = mesh->vertices;
+    nEdges = mesh->edges;
+    nCells = mesh->cells;
+    vertices = new long[nVertices];
+    edges = new long[nEdges];
+    cells = new long[nCells];
+    for (int i = 0; i < nVertices; i++) {
+      vertices[i] = i % 13;
+    }
+    std::fill (edges, edges + nEdges, 0);
+    std::fill (cells, cells + nCells, 0);
+  }
+
+  ~ExampleData()
+  {
+    delete[] vertices;
+    delete[] edges;
+    delete[] cells;
+  }
+
+  bool operator== (const ExampleData& other) const
+  {
+    return std::equal (vertices, vertices + nVertices, other.vertices) &&
+           std::equal (edges, edges + nEdges, other.edges) &&
+           std::equal (cells, cells + nCells, other.cells);
+  }
+};
+
+/*
+ * Execute the iteration /element/ of the /loop/-th loop of the chain, which is
+ * mapped to the /size/ elements in /m/
+ */
+void example_kernel(ExampleData* data, int loop, index_t element, index_t* m, int size)
+{
+  const long p = 1000003;
+  long* vertices = data->vertices;
+  switch(loop)
+  {
+    case 0:
+      data->edges[element] = (vertices[m[0]] + 2*vertices[m[1]] + 1) % p;
+      break;
+    case 1:
+      for (int k = 0; k < size; k++) {
+        vertices[m[k]] = (vertices[m[k]] + data->edges[element]) % p;
+      }
+      break;
+    case 2:
+      data->cells[element] = (vertices[m[0]] + vertices[m[1]] + 3*vertices[m[2]] +
+                              vertices[m[3]]) % p;
+      break;
+    case 3:
+      for (int k = 0; k < size; k++) {
+        vertices[m[k]] = (vertices[m[k]] + data->cells[element]) % p;
+      }
+      break;
+    case 4:
+      for (int k = 0; k < size; k++) {
+        vertices[element] = (vertices[element] + (k + 1)*data->edges[m[k]]) % p;
+      }
+      break;
+  }
+}
+
+/*
+ * Execute the loop chain without tiling
+ */
+void example_run(ExampleChain* chain, ExampleData* data)
+{
+  for (int l = 0; l < chain->nLoops; l++) {
+    for (index_t e = 0; e < chain->sets[l]->size; e++) {
+      int size;
+      index_t* row = example_map_row (chain->maps[l], e, &size);
+      example_kernel (data, l, e, row, size);
+    }
+  }
+}
+
+/*
+ * Execute the /tileLoopSize/ /iterations/ of a tile in the /loop/-th loop of
+ * the chain, through the local map /localMap/ of the tile, along with its
+ * offsets /localOffsets/ if the map is irregular
+ */
+void example_run_iterations(ExampleChain* chain, ExampleData* data, int loop,
+                            index_t* iterations, int tileLoopSize,
+                            index_t* localMap, index_t* localOffsets)
+{
+  map_t* map = chain->maps[loop];
+  int arity = map->offsets ? 0 : map->size / map->inSet->size;
+  for (int i = 0; i < tileLoopSize; i++) {
+    if (localOffsets) {
+      example_kernel (data, loop, iterations[i], localMap + localOffsets[i] - localOffsets[0],
+                      localOffsets[i + 1] - localOffsets[i]);
+    }
+    else {
+      example_kernel (data, loop, iterations[i], localMap + i*arity, arity);
+    }
+  }
+}
+
+/*
+ * Execute the loop chain tile by tile, in increasing order of color, through
+ * the local maps of the tiles of /insp/, on which /insp_run/ has been called
+ */
+void example_run_tiles(inspector_t* insp, ExampleChain* chain, ExampleData* data)
+{
+  tile_list* tiles = insp->tiles;
+  int nColors = 0;
+  for (size_t t = 0; t < tiles->size(); t++) {
+    nColors = std::max (nColors, tiles->at(t)->color + 1);
+  }
+  for (int c = 0; c < nColors; c++) {
+    for (size_t t = 0; t < tiles->size(); t++) {
+      tile_t* tile = tiles->at(t);
+      if (tile->color != c) {
+        continue;
+      }
+      for (int l = 0; l < chain->nLoops; l++) {
+        std::string mapName = chain->maps[l]->name;
+        example_run_iterations (chain, data, l, tile_get_iterations (tile, l).data(),
+                                tile_loop_size (tile, l),
+                                tile_get_local_map (tile, l, mapName),
+                                tile_get_local_offsets (tile, l, mapName));
+      }
+    }
+  }
+}
+
+typedef struct {
+  ExampleChain* chain;
+  ExampleData* data;
+  int handles[ExampleChain::maxLoops];
+} example_args_t;
+
+void example_tile_kernel(executor_t* exec, int color, int ithTile, void* args)
+{
+  example_args_t* tileArgs = (example_args_t*)args;
+  for (int l = 0; l < tileArgs->chain->nLoops; l++) {
+    int handle = tileArgs->handles[l];
+    example_run_iterations (tileArgs->chain, tileArgs->data, l,
+                            exec_iterations (exec, color, ithTile, l),
+                            exec_loop_size (exec, color, ithTile, l),
+                            exec_local_map (exec, color, ithTile, l, handle),
+                            exec_local_offsets (exec, color, ithTile, l, handle));
+  }
+}
+
+/*
+ * Execute the loop chain through /exec/, built from an inspection of /chain/
+ */
+void example_run_executor(executor_t* exec, ExampleChain* chain, ExampleData* data)
+{
+  example_args_t args;
+  args.chain = chain;
+  args.data = data;
+  for (int l = 0; l < chain->nLoops; l++) {
+    args.handles[l] = exec_map_handle (exec, l, chain->maps[l]->name);
+  }
+  exec_run (exec, example_tile_kernel, &args);
+}
+
+/*
+ * Return the number of times two tiles with the same color touch a same set
+ * element, in any loop, with at least one of the two tiles writing it
+ */
+long example_conflicts(inspector_t* insp)
+{
+  tile_list* tiles = insp->tiles;
+  loop_list* loops = insp->loops;
+
+  // the tiles touching each element of each set, and whether they write it
+  std::vector<std::string> names;
+  std::vector<std::vector<std::vector<std::pair<int, bool> > > > touches;
+  for (size_t l = 0; l < loops->size(); l++) {
+    loop_t* loop = loops->at(l);
+    desc_list::const_iterator it, end;
+    for (it = loop->descriptors->begin(), end = loop->descriptors->end(); it != end; it++) {
+      map_t* map = (*it)->map;
+      set_t* target = map ? map->outSet : loop->set;
+      bool write = (*it)->mode != READ;
+      size_t s = std::find (names.begin(), names.end(), target->name) - names.begin();
+      if (s == names.size()) {
+        names.push_back (target->name);
+        touches.push_back (std::vector<std::vector<std::pair<int, bool> > > (target->size));
+      }
+      for (size_t t = 0; t < tiles->size(); t++) {
+        iterations_list& iterations = tile_get_iterations (tiles->at(t), l);
+        for (int i = 0; i < tile_loop_size (tiles->at(t), l); i++) {
+          int size = 1;
+          index_t* row = map ? example_map_row (map, iterations[i], &size) : &iterations[i];
+          for (int k = 0; k < size; k++) {
+            touches[s][row[k]].push_back (std::make_pair ((int)t, write));
+          }
+        }
+      }
+    }
+  }
+
+  long nConflicts = 0;
+  for (size_t s = 0; s < touches.size(); s++) {
+    for (size_t e = 0; e < touches[s].size(); e++) {
+      std::vector<std::pair<int, bool> >& tilesAt = touches[s][e];
+      for (size_t i = 0; i < tilesAt.size(); i++) {
+        for (size_t j = i + 1; j < tilesAt.size(); j++) {
+          int a = tilesAt[i].first;
+          int b = tilesAt[j].first;
+          nConflicts += a != b && tiles->at(a)->color == tiles->at(b)->color &&
+                        (tilesAt[i].second || tilesAt[j].second);
+        }
+      }
+    }
+  }
+  return nConflicts;
+}
+
+/*
+ * Print whether /condition/, described by /what/, holds; return 0 if it does,
+ * 1 otherwise, so that a test can count its failures
+ */
+int example_check(bool condition, std::string what)
+{
+  std::cout << (condition ? "PASSED: " : "FAILED: ") << what << std::endl;
+  return condition ? 0 : 1;
+}
+
+/*
+ * Return true if the tiles of two inspections of /chain/ have the same colors,
+ * regions, iterations and local maps
+ */
+bool example_same_tiles(tile_list* a, tile_list* b, ExampleChain* chain)
+{
+  if (a->size() != b->size()) {
+    return false;
+  }
+  for (size_t t = 0; t < a->size(); t++) {
+    tile_t* x = a->at(t);
+    tile_t* y = b->at(t);
+    if (x->color != y->color || x->region != y->region) {
+      return false;
+    }
+    for (int l = 0; l < chain->nLoops; l++) {
+      std::string mapName = chain->maps[l]->name;
+      if (tile_get_iterations (x, l) != tile_get_iterations (y, l)) {
+        return false;
+      }
+      // a tile without iterations in a loop has no extra iterations either
+      int tileLoopSize = std::max (tile_loop_size (x, l), 0);
+      index_t* xOffsets = tile_get_local_offsets (x, l, mapName);
+      index_t* yOffsets = tile_get_local_offsets (y, l, mapName);
+      if ((xOffsets == NULL) != (yOffsets == NULL)) {
+        return false;
+      }
+      int arity = xOffsets ? 0 : chain->maps[l]->size / chain->maps[l]->inSet->size;
+      int size = xOffsets ? xOffsets[tileLoopSize] - xOffsets[0] : tileLoopSize*arity;
+      for (int i = 0; xOffsets && i <= tileLoopSize; i++) {
+        if (xOffsets[i] - xOffsets[0] != yOffsets[i] - yOffsets[0]) {
+          return false;
+        }
+      }
+      index_t* xMap = tile_get_local_map (x, l, mapName);
+      index_t* yMap = tile_get_local_map (y, l, mapName);
+      if (! std::equal (xMap, xMap + size, yMap)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 #endif
@@ -0,0 +1,147 @@
+/*
+ *  test_assign.cpp
+ *
+ * Check that the iterations of each tile are executed in the same order as
+ * the original algorithm, which looked each iteration of the closest loop over
+ * the same set up in the tile (std::find) and moved it to the front (erase)
+ */
+
+#include "inspector.h"
+#include "executor.h"
+#include "tiling.h"
+#include "common.hpp"
+
+/*
+ * Direct port of the original iteration ordering: given the iterations of
+ * /tile/ in loop /loopIndex/, return them in the order they must be executed
+ * when the loop is tiled in /direction/
+ */
+static iterations_list assign_loop_reference (tile_t* tile, loop_list* loops,
+                                              int loopIndex, direction_t direction)
+{
+  // aliases
+  loop_t* loop = loops->at(loopIndex);
+  int nLoops = tile->crossedLoops;
+
+  int tileLoopSize = tile_loop_size (tile, loopIndex);
+  if (tileLoopSize <= 0) {
+    return iterations_list();
+  }
+  iterations_list iterations (tile->iterations[loopIndex]->begin(),
+                              tile->iterations[loopIndex]->begin() + tileLoopSize);
+  std::sort (iterations.begin(), iterations.end());
+
+  iterations_list sortedIters;
+  int prevIndex = -1;
+  if (direction == DOWN) {
+    for (int i = loopIndex - 1; i >= 0 && prevIndex == -1; i--) {
+      prevIndex = loop_eq_itspace (loop, loops->at(i)) ? i : -1;
+    }
+  }
+  if (direction == UP) {
+    for (int i = loopIndex + 1; i < nLoops && prevIndex == -1; i++) {
+      prevIndex = loop_eq_itspace (loop, loops->at(i)) ? i : -1;
+    }
+  }
+  if (prevIndex != -1) {
+    iterations_list& prevIters = *(tile->iterations[prevIndex]);
+    int tilePrevLoopSize = prevIters.size();
+    for (int e = 0; e < tilePrevLoopSize; e++) {
+      iterations_list::iterator isIn;
+      isIn = std::find (iterations.begin(), iterations.end(), prevIters[e]);
+      if (isIn != iterations.end()) {
+        sortedIters.push_back(*isIn);
+        iterations.erase(isIn);
+      }
+    }
+  }
+  std::sort (iterations.begin(), iterations.end());
+  sortedIters.insert (sortedIters.end(), iterations.begin(), iterations.end());
+
+  for (int i = 0; i < tile->prefetchHalo; i++) {
+    sortedIters.push_back(sortedIters.back());
+  }
+  return sortedIters;
+}
+
+/*
+ * Assign again the iterations of loop /loopIndex/ to the tiles they already
+ * belong to, and check that they are ordered as by the original algorithm
+ */
+static bool same_order (inspector_t* insp, int loopIndex, direction_t direction)
+{
+  // aliases
+  tile_list* tiles = insp->tiles;
+  loop_t* loop = insp->loops->at(loopIndex);
+
+  int execSize = loop->set->core + loop->set->execHalo;
+  tc_t* iter2tc = new tc_t[execSize];
+  for (size_t t = 0; t < tiles->size(); t++) {
+    tile_t* tile = tiles->at(t);
+    for (int j = 0; j < tile_loop_size (tile, loopIndex); j++) {
+      iter2tc[tile->iterations[loopIndex]->at(j)] = tc_pack (t, tile->color);
+    }
+  }
+  assign_loop (loop, insp->loops, tiles, iter2tc, direction);
+
+  bool sameOrder = true;
+  for (size_t t = 0; t < tiles->size(); t++) {
+    tile_t* tile = tiles->at(t);
+    sameOrder &= *(tile->iterations[loopIndex]) ==
+                 assign_loop_reference (tile, insp->loops, loopIndex, direction);
+  }
+  delete[] iter2tc;
+  return sameOrder;
+}
+
+int main ()
+{
+  ExampleGrid* mesh = example_grid(30, 20);
+  const int tileSizes[] = {7, 25};
+  const int seeds[] = {0, 3, 5};
+  const int prefetchHalos[] = {1, 2};
+  const direction_t directions[] = {SEED, DOWN, UP};
+  // several loops over edges and over cells, interleaved
+  const int order[] = {0, 1, 2, 3, 1, 0, 3, 2};
+  const int nLoops = sizeof(order) / sizeof(int);
+  int nFailures = 0;
+
+  for (int i = 0; i < 2; i++) {
+    for (int s = 0; s < 3; s++) {
+      for (int p = 0; p < 2; p++) {
+        std::string what = "tile size " + std::to_string (tileSizes[i]) +
+                           ", seed loop " + std::to_string (seeds[s]) +
+                           ", prefetch halo " + std::to_string (prefetchHalos[p]);
+        ExampleChain* chain = new ExampleChain(mesh);
+        inspector_t* insp = insp_init(tileSizes[i], OMP, COL_DEFAULT, NULL, NULL,
+                                      prefetchHalos[p]);
+        for (int l = 0; l < nLoops; l++) {
+          int c = order[l];
+          insp_add_parloop (insp, "pl" + std::to_string (l), chain->sets[c],
+                            &chain->descriptors[c]);
+        }
+        insp_run (insp, seeds[s]);
+
+        // the tiles of the actual inspection, with any tiling direction
+        bool sameOrder = true;
+        for (int l = 0; l < nLoops; l++) {
+          for (int d = 0; d < 3; d++) {
+            sameOrder &= same_order (insp, l, directions[d]);
+          }
+        }
+        nFailures += example_check (sameOrder, "the iterations are in the original order, " +
+                                    what);
+
+        // free memory
+        executor_t* exec = exec_init (insp);
+        insp_free (insp);
+        exec_free (exec);
+        delete chain;
+      }
+    }
+  }
+
+  delete mesh;
+
+  return nFailures;
+}
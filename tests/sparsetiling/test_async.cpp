@@ -0,0 +1,81 @@
+/*
+ *  test_async.cpp
+ *
+ * Check that an inspection run in the background computes the same tiles as
+ * one run in the foreground, while the untiled loops keep executing
+ */
+
+#include <cstdio>
+
+#include "inspector.h"
+#include "executor.h"
+#include "async.h"
+#include "common.hpp"
+
+int main ()
+{
+  ExampleGrid* mesh = example_grid(40, 30);
+  const std::string fileName = "test_async.slope";
+  const int tileSize = 12;
+  const int seed = 2;
+  int nFailures = 0;
+
+  // inspect in the foreground
+  ExampleChain* chain = new ExampleChain(mesh);
+  inspector_t* insp = insp_init(tileSize, OMP);
+  example_add_loops (insp, chain);
+  insp_run (insp, seed);
+  ExampleData expected (mesh);
+  example_run (chain, &expected);
+
+  // inspect in the background, on 2 threads, while executing the untiled loops
+  ExampleChain* asyncChain = new ExampleChain(mesh);
+  inspector_t* asyncInsp = insp_init(tileSize, OMP);
+  example_add_loops (asyncInsp, asyncChain);
+  insp_async_t* handle = insp_run_async (asyncInsp, seed, 2);
+  ExampleData untiled (mesh);
+  int nSteps = 0;
+  do {
+    example_run (asyncChain, &untiled);
+    nSteps++;
+  } while (! insp_ready (handle));
+  nFailures += example_check (insp_wait (handle) == INSP_OK,
+                              "the background inspection succeeds");
+  nFailures += example_check (example_same_tiles (insp->tiles, asyncInsp->tiles, chain),
+                              "the background inspection computes the same tiles");
+  ExampleData tiled (mesh);
+  example_run_tiles (asyncInsp, chain, &tiled);
+  nFailures += example_check (tiled == expected && nSteps > 0,
+                              "the tiles execute the loop chain");
+
+  // the first background inspection through a file stores it, the second loads it
+  ExampleChain* storedChain = new ExampleChain(mesh);
+  inspector_t* storedInsp = insp_init(tileSize, OMP);
+  example_add_loops (storedInsp, storedChain);
+  std::remove (fileName.c_str());
+  handle = insp_run_async (storedInsp, seed, 0, fileName);
+  nFailures += example_check (insp_wait (handle) == INSP_OK &&
+                              example_same_tiles (insp->tiles, storedInsp->tiles, chain),
+                              "the background inspection is stored");
+  ExampleChain* loadedChain = new ExampleChain(mesh);
+  inspector_t* loadedInsp = insp_init(tileSize, OMP);
+  example_add_loops (loadedInsp, loadedChain);
+  handle = insp_run_async (loadedInsp, seed, 0, fileName);
+  nFailures += example_check (insp_wait (handle) == INSP_OK &&
+                              example_same_tiles (insp->tiles, loadedInsp->tiles, chain),
+                              "the background inspection is loaded");
+  std::remove (fileName.c_str());
+
+  // free memory
+  inspector_t* insps[] = {insp, asyncInsp, storedInsp, loadedInsp};
+  ExampleChain* chains[] = {chain, asyncChain, storedChain, loadedChain};
+  for (int i = 0; i < 4; i++) {
+    executor_t* exec = exec_init (insps[i]);
+    insp_free (insps[i]);
+    exec_free (exec);
+    delete chains[i];
+  }
+  delete mesh;
+
+  return nFailures;
+}
@@ -0,0 +1,81 @@
+/*
+ *  test_cache.cpp
+ *
+ * Check that an inspection stored on file is loaded back unchanged, and only
+ * by an inspector for the same problem
+ */
+
+#include <cstdio>
+
+#include "inspector.h"
+#include "executor.h"
+#include "cache.h"
+#include "common.hpp"
+
+int main ()
+{
+  ExampleGrid* mesh = example_grid(24, 16);
+  const std::string fileName = "test_cache.slope";
+  const int tileSize = 16;
+  const int seed = 1;
+  int nFailures = 0;
+
+  // inspect and store
+  ExampleChain* chain = new ExampleChain(mesh, true);
+  inspector_t* insp = insp_init(tileSize, OMP);
+  example_add_loops (insp, chain);
+  insp_run (insp, seed);
+  nFailures += example_check (insp_save (insp, seed, fileName) == INSP_OK,
+                              "the inspection is stored");
+
+  // load into a new inspector for the same problem
+  ExampleChain* loadedChain = new ExampleChain(mesh, true);
+  inspector_t* loaded = insp_init(tileSize, OMP);
+  example_add_loops (loaded, loadedChain);
+  nFailures += example_check (insp_load (loaded, seed, fileName) == INSP_OK,
+                              "the inspection is loaded");
+  nFailures += example_check (loaded->tiles &&
+                              example_same_tiles (insp->tiles, loaded->tiles, chain),
+                              "the loaded tiles are those stored");
+  nFailures += example_check (loaded->seed == insp->seed, "the loaded seed loop is the same");
+
+  // loading again discards the tiles just loaded
+  tile_list* previous = loaded->tiles;
+  insp_load (loaded, seed, fileName);
+  nFailures += example_check (loaded->tiles != previous &&
+                              example_same_tiles (insp->tiles, loaded->tiles, chain),
+                              "loading again replaces the loaded tiles");
+
+  // the loaded tiles compute what the untiled loops compute
+  ExampleData expected (mesh);
+  ExampleData actual (mesh);
+  example_run (chain, &expected);
+  example_run_tiles (loaded, chain, &actual);
+  nFailures += example_check (actual == expected, "the loaded tiles execute the loop chain");
+
+  // an inspector for a different problem does not load the file
+  ExampleChain* otherChain = new ExampleChain(mesh, true);
+  inspector_t* other = insp_init(tileSize*2, OMP);
+  example_add_loops (other, otherChain);
+  nFailures += example_check (insp_load (other, seed, fileName) != INSP_OK && ! other->tiles,
+                              "a different tile size does not load the inspection");
+  nFailures += example_check (insp_load (insp, seed + 1, fileName) != INSP_OK,
+                              "a different seed loop does not load the inspection");
+
+  std::remove (fileName.c_str());
+
+  // free memory
+  executor_t* exec = exec_init (insp);
+  executor_t* loadedExec = exec_init (loaded);
+  insp_free (insp);
+  insp_free (loaded);
+  insp_free (other);
+  exec_free (exec);
+  exec_free (loadedExec);
+  delete chain;
+  delete loadedChain;
+  delete otherChain;
+  delete mesh;
+
+  return nFailures;
+}
@@ -0,0 +1,136 @@
+/*
+ *  test_coloring.cpp
+ *
+ * Check that the colorings of the tiles are legal: no two tiles with the same
+ * color touch a same element, unless both only read it
+ */
+
+#ifdef SLOPE_OMP
+#include <omp.h>
+#endif
+
+#include "inspector.h"
+#include "executor.h"
+#include "common.hpp"
+
+/*
+ * Inspect the loop chain over /mesh/ on /nThreads/ threads, check that the
+ * tiles are legal and compute what the untiled loop chain computes, and return
+ * the color of each tile. The outcome of the inspection is stored in /result/,
+ * if given
+ */
+static std::vector<int> inspect (ExampleMesh* mesh, int tileSize, insp_coloring coloring,
+                                 int maxColors, int nThreads, std::string what,
+                                 int* nFailures, insp_info* result = NULL)
+{
+  // conflicts are not repaired, as repairs recolor tiles out of /coloring/
+  ExampleChain* chain = new ExampleChain(mesh);
+  inspector_t* insp = insp_init(tileSize, OMP, coloring, NULL, NULL, 1, false, "",
+                                PART_DEFAULT, NULL, DIM2, maxColors, false);
+  example_add_loops (insp, chain);
+#ifdef SLOPE_OMP
+  // the tiling depends on the number of threads set when the inspector was
+  // initialized, but not on the number of threads running the inspection
+  int defaultThreads = omp_get_max_threads();
+  omp_set_num_threads (nThreads);
+#endif
+  insp_info info = insp_run (insp, 2);
+#ifdef SLOPE_OMP
+  omp_set_num_threads (defaultThreads);
+#endif
+
+  ExampleData expected (mesh);
+  ExampleData actual (mesh);
+  example_run (chain, &expected);
+  example_run_tiles (insp, chain, &actual);
+  *nFailures += example_check (example_conflicts (insp) == 0 && actual == expected,
+                               "the tiles are legal, " + what);
+  if (result) {
+    *result = info;
+  }
+
+  std::vector<int> colors;
+  for (size_t t = 0; t < insp->tiles->size(); t++) {
+    colors.push_back (insp->tiles->at(t)->color);
+  }
+
+  // free memory
+  executor_t* exec = exec_init (insp);
+  insp_free (insp);
+  exec_free (exec);
+  delete chain;
+
+  return colors;
+}
+
+/*
+ * Return the number of tiles of each color
+ */
+static std::vector<int> tiles_per_color (const std::vector<int>& colors)
+{
+  std::vector<int> tilesPerColor (*std::max_element (colors.begin(), colors.end()) + 1, 0);
+  for (size_t t = 0; t < colors.size(); t++) {
+    tilesPerColor[colors[t]]++;
+  }
+  return tilesPerColor;
+}
+
+int main ()
+{
+  ExampleGrid* mesh = example_grid(40, 30);
+  const int tileSizes[] = {6, 12, 30};
+  int nFailures = 0;
+
+  // tiles are colored speculatively, in parallel, and then conflicts are fixed
+  for (int i = 0; i < 3; i++) {
+    std::string what = "tile size " + std::to_string (tileSizes[i]);
+    std::vector<int> sequential = inspect (mesh, tileSizes[i], COL_DEFAULT, 0, 1,
+                                           "default coloring, 1 thread, " + what, &nFailures);
+    std::vector<int> parallel = inspect (mesh, tileSizes[i], COL_DEFAULT, 0, 4,
+                                         "default coloring, 4 threads, " + what, &nFailures);
+    nFailures += example_check (sequential == parallel,
+                                "the coloring does not depend on the threads, " + what);
+  }
+
+  // balancing moves tiles across colors, so that each color has about as many
+  // tiles as the others
+  for (int i = 0; i < 3; i++) {
+    std::string what = "tile size " + std::to_string (tileSizes[i]);
+    std::vector<int> minimal = tiles_per_color (
+      inspect (mesh, tileSizes[i], COL_MINCOLS, 0, 1, "fewest colors, " + what, &nFailures));
+    std::vector<int> balanced = tiles_per_color (
+      inspect (mesh, tileSizes[i], COL_BALANCED, 0, 1, "balanced coloring, " + what, &nFailures));
+    int minimalSpread = *std::max_element (minimal.begin(), minimal.end()) -
+                        *std::min_element (minimal.begin(), minimal.end());
+    int balancedSpread = *std::max_element (balanced.begin(), balanced.end()) -
+                         *std::min_element (balanced.begin(), balanced.end());
+    nFailures += example_check (balanced.size() <= minimal.size() &&
+                                balancedSpread <= minimalSpread,
+                                "the balanced coloring evens out the colors, " + what);
+  }
+
+  // with a cap on the colors, tiles are merged until the cap is met
+  const int maxColors[] = {3, 4, 6};
+  for (int i = 0; i < 3; i++) {
+    std::string what = "at most " + std::to_string (maxColors[i]) + " colors";
+    insp_info result;
+    std::vector<int> capped = tiles_per_color (inspect (mesh, 12, COL_DEFAULT, maxColors[i], 1,
+                                                        what, &nFailures, &result));
+    nFailures += example_check (result == INSP_OK && (int)capped.size() <= maxColors[i] &&
+                                std::count (capped.begin(), capped.end(), 0) == 0,
+                                "the cap on the colors is met, " + what);
+  }
+
+  // adjacent tiles never share a color, so a single color cannot be met by
+  // merging a bounded number of times: the tiles stay legal, but the inspection
+  // reports the cap as missed
+  insp_info result;
+  std::vector<int> uncapped = tiles_per_color (inspect (mesh, 1, COL_DEFAULT, 1, 1,
+                                                        "at most 1 color", &nFailures, &result));
+  nFailures += example_check (result == INSP_ERR && uncapped.size() > 1,
+                              "the cap on the colors is missed, at most 1 color");
+
+  delete mesh;
+
+  return nFailures;
+}
@@ -0,0 +1,70 @@
+/*
+ *  test_dag.cpp
+ *
+ * Check that executing tiles as their dependencies are met computes the same
+ * as executing them color by color
+ */
+
+#include "inspector.h"
+#include "executor.h"
+#include "common.hpp"
+
+int main ()
+{
+  ExampleGrid* mesh = example_grid(32, 24);
+  const int tileSizes[] = {8, 48};
+  const int seed = 2;
+  int nFailures = 0;
+
+  for (int i = 0; i < 2; i++) {
+    std::string tileSize = std::to_string (tileSizes[i]);
+    ExampleChain* chain = new ExampleChain(mesh);
+    ExampleChain* dagChain = new ExampleChain(mesh);
+    inspector_t* insp = insp_init(tileSizes[i], OMP);
+    inspector_t* dagInsp = insp_init(tileSizes[i], OMP);
+    example_add_loops (insp, chain);
+    example_add_loops (dagInsp, dagChain);
+    insp_run (insp, seed);
+    insp_run (dagInsp, seed);
+    ExampleData expected (mesh);
+    example_run (chain, &expected);
+
+    // the edges of the DAG go from a color to a larger one
+    map_t* tileDag = insp_tile_dag (dagInsp);
+    bool oriented = true;
+    for (size_t t = 0; t < dagInsp->tiles->size(); t++) {
+      for (index_t k = tileDag->offsets[t]; k < tileDag->offsets[t + 1]; k++) {
+        oriented &= dagInsp->tiles->at(tileDag->values[k])->color >
+                    dagInsp->tiles->at(t)->color;
+      }
+    }
+    map_free (tileDag, true);
+    nFailures += example_check (oriented, "the tile DAG is oriented by color, tile size " +
+                                tileSize);
+
+    // the executor takes the tiles, so the loop chain is inspected once per mode
+    executor_t* colorsExec = exec_init (insp, EXEC_COLORS);
+    executor_t* dagExec = exec_init (dagInsp, EXEC_DAG);
+
+    ExampleData byColors (mesh);
+    ExampleData byDag (mesh);
+    example_run_executor (colorsExec, chain, &byColors);
+    example_run_executor (dagExec, dagChain, &byDag);
+    nFailures += example_check (byColors == expected,
+                                "EXEC_COLORS executes the loop chain, tile size " + tileSize);
+    nFailures += example_check (byDag == expected,
+                                "EXEC_DAG executes the loop chain, tile size " + tileSize);
+
+    // free memory
+    insp_free (insp);
+    insp_free (dagInsp);
+    exec_free (colorsExec);
+    exec_free (dagExec);
+    delete chain;
+    delete dagChain;
+  }
+
+  delete mesh;
+
+  return nFailures;
+}
@@ -0,0 +1,177 @@
+/*
+ *  test_footprint.cpp
+ *
+ * Check the data footprint of the tiles, i.e. the bytes of data touched by a
+ * tile across the loop chain
+ */
+
+#include <set>
+
+#include "inspector.h"
+#include "executor.h"
+#include "tuner.h"
+#include "common.hpp"
+
+/*
+ * A loop chain touching vertex data through two maps, along with its own data,
+ * with the bytes per element of each piece of data known
+ */
+class FootprintChain
+{
+public:
+  static const int nLoops = 3;
+
+  set_t *vertices, *edges, *cells;
+  map_t *e2v, *c2v;
+  set_t* sets[nLoops];
+  desc_list descriptors[nLoops];
+
+  FootprintChain(ExampleMesh* mesh)
+  {
+    vertices = set("vertices", mesh->vertices);
+    edges = set("edges", mesh->edges);
+    cells = set("cells", mesh->cells);
+    e2v = map("e2v", edges, vertices, mesh->e2v, mesh->e2vSize);
+    c2v = map("c2v", cells, vertices, mesh->c2v, mesh->c2vSize);
+    // 8 bytes per vertex, shared by all loops; 4 bytes per edge; 16 bytes per
+    // cell; 4 more bytes per vertex, only read by the last loop. The descriptor
+    // with no bytes does not count
+    descriptors[0] = desc_list ({desc(e2v, READ, 8),
+                                 desc(DIRECT, WRITE, 4)});
+    descriptors[1] = desc_list ({desc(DIRECT, READ, 16),
+                                 desc(c2v, INC, 8),
+                                 desc(c2v, READ)});
+    descriptors[2] = desc_list ({desc(DIRECT, RW, 8),
+                                 desc(DIRECT, READ, 4)});
+    sets[0] = edges;
+    sets[1] = cells;
+    sets[2] = vertices;
+  }
+};
+
+static inspector_t* inspect (FootprintChain* chain, int tileSize, int seed, bool run = true)
+{
+  inspector_t* insp = insp_init(tileSize, OMP);
+  for (int l = 0; l < FootprintChain::nLoops; l++) {
+    insp_add_parloop (insp, "pl" + std::to_string (l), chain->sets[l],
+                      &chain->descriptors[l]);
+  }
+  if (run) {
+    insp_run (insp, seed);
+  }
+  return insp;
+}
+
+/*
+ * Count the bytes touched by /tile/, element by element
+ */
+static long count_footprint (tile_t* tile, ExampleMesh* mesh)
+{
+  std::set<index_t> vertices8, vertices4, edges, cells;
+  iterations_list& edgeIters = *(tile->iterations[0]);
+  for (size_t j = 0; j < edgeIters.size(); j++) {
+    edges.insert (edgeIters[j]);
+    vertices8.insert (mesh->e2v + edgeIters[j]*2, mesh->e2v + edgeIters[j]*2 + 2);
+  }
+  iterations_list& cellIters = *(tile->iterations[1]);
+  for (size_t j = 0; j < cellIters.size(); j++) {
+    cells.insert (cellIters[j]);
+    vertices8.insert (mesh->c2v + cellIters[j]*4, mesh->c2v + cellIters[j]*4 + 4);
+  }
+  iterations_list& vertexIters = *(tile->iterations[2]);
+  vertices8.insert (vertexIters.begin(), vertexIters.end());
+  vertices4.insert (vertexIters.begin(), vertexIters.end());
+  return vertices8.size()*8 + edges.size()*4 + cells.size()*16 + vertices4.size()*4;
+}
+
+int main ()
+{
+  int nFailures = 0;
+
+  // a 4x3 grid has 20 vertices, 31 edges and 12 cells; with a single tile, all
+  // data is touched
+  ExampleGrid* small = example_grid(4, 3);
+  FootprintChain* smallChain = new FootprintChain(small);
+  inspector_t* smallInsp = inspect (smallChain, 1000, 0);
+  long expected = 20*8 + 31*4 + 12*16 + 20*4;
+  nFailures += example_check (smallInsp->tiles->size() == 1 &&
+                              smallInsp->tiles->at(0)->footprint == expected,
+                              "the footprint of a single tile is " + std::to_string (expected));
+
+  executor_t* smallExec = exec_init (smallInsp);
+  insp_free (smallInsp);
+  exec_free (smallExec);
+  delete smallChain;
+  delete small;
+
+  // with several tiles, each tile touches a part of the data
+  ExampleGrid* mesh = example_grid(20, 15);
+  const int tileSizes[] = {12, 40};
+  const int seeds[] = {0, 1};
+  for (int i = 0; i < 2; i++) {
+    for (int s = 0; s < 2; s++) {
+      std::string what = "tile size " + std::to_string (tileSizes[i]) +
+                         ", seed loop " + std::to_string (seeds[s]);
+      FootprintChain* chain = new FootprintChain(mesh);
+      inspector_t* insp = inspect (chain, tileSizes[i], seeds[s]);
+      bool counted = insp->tiles->size() > 1;
+      for (size_t t = 0; t < insp->tiles->size(); t++) {
+        tile_t* tile = insp->tiles->at(t);
+        counted &= tile->footprint == count_footprint (tile, mesh);
+      }
+      nFailures += example_check (counted, "the footprint of each tile, " + what);
+
+      executor_t* exec = exec_init (insp);
+      insp_free (insp);
+      exec_free (exec);
+      delete chain;
+    }
+  }
+
+  // fitting the tiles in a cache of a given size: at least the target fraction
+  // of the core tiles fits, and a larger cache gets tiles at least as large
+  const long cacheSizes[] = {1024, 4096};
+  const double fraction = 0.9;
+  int fittedSizes[2];
+  for (int c = 0; c < 2; c++) {
+    std::string what = std::to_string (cacheSizes[c]) + " bytes of cache";
+    FootprintChain* chain = new FootprintChain(mesh);
+    inspector_t* insp = inspect (chain, 12, 0, false);
+    insp_info result = insp_fit_cache (insp, 0, 2, fraction, cacheSizes[c]);
+    int nCore = insp->tileRegions->core;
+    int nFitting = 0;
+    for (int t = 0; t < nCore; t++) {
+      nFitting += insp->tiles->at(t)->footprint <= cacheSizes[c];
+    }
+    fittedSizes[c] = insp->avgTileSize;
+    nFailures += example_check (result == INSP_OK && nCore > 1 && nFitting >= fraction*nCore,
+                                "the tiles fit in cache, " + what);
+
+    executor_t* exec = exec_init (insp);
+    insp_free (insp);
+    exec_free (exec);
+    delete chain;
+  }
+  nFailures += example_check (fittedSizes[0] <= fittedSizes[1],
+                              "a larger cache gets tiles at least as large");
+
+  // no bytes known, no footprint
+  ExampleChain* unknownChain = new ExampleChain(mesh);
+  inspector_t* unknownInsp = insp_init(12, OMP);
+  example_add_loops (unknownInsp, unknownChain);
+  insp_run (unknownInsp, 0);
+  bool unknown = true;
+  for (size_t t = 0; t < unknownInsp->tiles->size(); t++) {
+    unknown &= unknownInsp->tiles->at(t)->footprint == 0;
+  }
+  nFailures += example_check (unknown, "no footprint if the bytes are not known");
+
+  // free memory
+  executor_t* unknownExec = exec_init (unknownInsp);
+  insp_free (unknownInsp);
+  exec_free (unknownExec);
+  delete unknownChain;
+  delete mesh;
+
+  return nFailures;
+}
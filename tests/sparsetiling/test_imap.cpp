@@ -0,0 +1,58 @@
+/*
+ *  test_imap.cpp
+ *
+ * Check the tiling of a loop accessing its data through an irregular map, in
+ * which each iteration touches a varying number of elements
+ */
+
+#include "inspector.h"
+#include "executor.h"
+#include "common.hpp"
+
+int main ()
+{
+  ExampleGrid* mesh = example_grid(32, 24);
+  const int tileSizes[] = {8, 40};
+  const int seeds[] = {0, 4};
+  const exec_mode modes[] = {EXEC_COLORS, EXEC_DAG};
+  const std::string names[] = {"EXEC_COLORS", "EXEC_DAG"};
+  int nFailures = 0;
+
+  for (int i = 0; i < 2; i++) {
+    for (int s = 0; s < 2; s++) {
+      for (int m = 0; m < 2; m++) {
+        std::string what = names[m] + ", tile size " + std::to_string (tileSizes[i]) +
+                           ", seed loop " + std::to_string (seeds[s]);
+        ExampleChain* chain = new ExampleChain(mesh, true);
+        inspector_t* insp = insp_init(tileSizes[i], OMP);
+        example_add_loops (insp, chain);
+        insp_run (insp, seeds[s]);
+
+        ExampleData expected (mesh);
+        ExampleData actual (mesh);
+        example_run (chain, &expected);
+        example_run_tiles (insp, chain, &actual);
+        nFailures += example_check (example_conflicts (insp) == 0 && actual == expected,
+                                    "the tiles are legal, " + what);
+
+        // the executor reads the irregular map through its local offsets
+        executor_t* exec = exec_init (insp, modes[m]);
+        int handle = exec_map_handle (exec, 4, "v2e");
+        ExampleData executed (mesh);
+        example_run_executor (exec, chain, &executed);
+        nFailures += example_check (handle != -1 && exec_local_offsets (exec, 0, 0, 4, handle) &&
+                                    executed == expected,
+                                    "the executor executes the loop chain, " + what);
+
+        // free memory
+        insp_free (insp);
+        exec_free (exec);
+        delete chain;
+      }
+    }
+  }
+
+  delete mesh;
+
+  return nFailures;
+}
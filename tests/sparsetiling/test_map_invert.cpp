@@ -0,0 +1,128 @@
+/*
+ *  test_map_invert.cpp
+ *
+ * Check that inverting a map, possibly in parallel, gives the same result as a
+ * simple sequential inversion
+ */
+
+#ifdef SLOPE_OMP
+#include <omp.h>
+#endif
+
+#include "inspector.h"
+#include "executor.h"
+#include "common.hpp"
+
+/*
+ * Invert /x2y/ one x element at a time, ignoring entries set to -1; return true
+ * if /y2x/ and /maxIncidence/ are the same
+ */
+static bool check_inverse (map_t* x2y, map_t* y2x, int maxIncidence)
+{
+  index_t xSize = x2y->inSet->size;
+  index_t ySize = x2y->outSet->size;
+  int arity = x2y->offsets ? 0 : x2y->size / xSize;
+
+  std::vector<std::vector<index_t> > inverse (ySize);
+  for (index_t i = 0; i < xSize; i++) {
+    index_t start = x2y->offsets ? x2y->offsets[i] : i*arity;
+    index_t end = x2y->offsets ? x2y->offsets[i + 1] : (i + 1)*arity;
+    for (index_t j = start; j < end; j++) {
+      if (x2y->values[j] != -1) {
+        inverse[x2y->values[j]].push_back (i);
+      }
+    }
+  }
+
+  if (y2x->inSet->size != ySize || y2x->outSet->size != xSize || ! y2x->offsets ||
+      y2x->offsets[0] != 0) {
+    return false;
+  }
+  int incidence = 0;
+  for (index_t i = 0; i < ySize; i++) {
+    index_t* values = y2x->values + y2x->offsets[i];
+    index_t size = y2x->offsets[i + 1] - y2x->offsets[i];
+    if (size != (index_t)inverse[i].size() ||
+        ! std::equal (values, values + size, inverse[i].begin())) {
+      return false;
+    }
+    incidence = std::max (incidence, (int)size);
+  }
+  return y2x->size == y2x->offsets[ySize] && incidence == maxIncidence;
+}
+
+int main ()
+{
+  // large enough for the inversion to run in parallel
+  ExampleGrid* mesh = example_grid(160, 120);
+  int nFailures = 0;
+
+  // some cells touch off-processor vertices
+  index_t* c2vHalo = new index_t[mesh->c2vSize];
+  std::copy (mesh->c2v, mesh->c2v + mesh->c2vSize, c2vHalo);
+  for (int i = 0; i < mesh->c2vSize; i += 7) {
+    c2vHalo[i] = -1;
+  }
+
+  map_t* e2v = map("e2v", set("edges", mesh->edges), set("vertices", mesh->vertices),
+                   mesh->e2v, mesh->e2vSize);
+  map_t* c2v = map("c2v", set("cells", mesh->cells), set("vertices", mesh->vertices),
+                   c2vHalo, mesh->c2vSize);
+
+  std::vector<int> nThreads (1, 1);
+#ifdef SLOPE_OMP
+  nThreads.push_back (2);
+  nThreads.push_back (3);
+  nThreads.push_back (8);
+#endif
+
+  for (size_t n = 0; n < nThreads.size(); n++) {
+#ifdef SLOPE_OMP
+    omp_set_num_threads (nThreads[n]);
+#endif
+    std::string threads = ", " + std::to_string (nThreads[n]) + " thread(s)";
+    int maxIncidence = -1;
+
+    map_t* v2e = map_invert (e2v, &maxIncidence);
+    nFailures += example_check (check_inverse (e2v, v2e, maxIncidence),
+                                "a map of arity 2 is inverted" + threads);
+
+    map_t* v2c = map_invert (c2v, &maxIncidence);
+    nFailures += example_check (check_inverse (c2v, v2c, maxIncidence),
+                                "entries set to -1 are ignored" + threads);
+
+    // the inverse of an inverse is an irregular map
+    map_t* e2vAgain = map_invert (v2e, &maxIncidence);
+    nFailures += example_check (check_inverse (v2e, e2vAgain, maxIncidence) &&
+                                std::equal (mesh->e2v, mesh->e2v + mesh->e2vSize,
+                                            e2vAgain->values),
+                                "an irregular map is inverted" + threads);
+
+    map_free (v2e, true);
+    map_free (v2c, true);
+    map_free (e2vAgain, true);
+  }
+
+  // inverse maps are computed once, until erased
+  inverse_maps* cache = inverse_maps_init();
+  int maxIncidence = -1;
+  map_t* v2e = map_invert_cached (e2v, cache, &maxIncidence);
+  nFailures += example_check (check_inverse (e2v, v2e, maxIncidence),
+                              "a cached inverse map is correct");
+  maxIncidence = -1;
+  nFailures += example_check (map_invert_cached (e2v, cache, &maxIncidence) == v2e &&
+                              maxIncidence == 4,
+                              "a cached inverse map is not computed again");
+  inverse_maps_erase (cache, e2v);
+  nFailures += example_check (cache->empty(), "an inverse map is erased from the cache");
+  map_invert_cached (c2v, cache);
+  inverse_maps_free (cache);
+
+  // free memory
+  map_free (e2v);
+  map_free (c2v);
+  delete[] c2vHalo;
+  delete mesh;
+
+  return nFailures;
+}
@@ -0,0 +1,83 @@
+/*
+ *  test_partitioning.cpp
+ *
+ * Check that each partitioning of the seed loop assigns each of its iterations
+ * to exactly one tile, and that the resulting tiles are legal
+ */
+
+#include "inspector.h"
+#include "executor.h"
+#include "common.hpp"
+
+/*
+ * Return true if each core iteration of the seed loop belongs to exactly one
+ * tile, the one /insp->iter2tile/ assigns it to, and no tile is empty
+ */
+static bool check_partition (inspector_t* insp)
+{
+  tile_list* tiles = insp->tiles;
+  int seed = insp->seed;
+  index_t setSize = insp->loops->at(seed)->set->core;
+
+  std::vector<int> owners (setSize, 0);
+  for (size_t t = 0; t < tiles->size(); t++) {
+    iterations_list& iterations = tile_get_iterations (tiles->at(t), seed);
+    int tileLoopSize = tile_loop_size (tiles->at(t), seed);
+    if (tileLoopSize == 0) {
+      return false;
+    }
+    for (int i = 0; i < tileLoopSize; i++) {
+      index_t element = iterations[i];
+      if (element < 0 || element >= setSize || insp->iter2tile->values[element] != (index_t)t) {
+        return false;
+      }
+      owners[element]++;
+    }
+  }
+  return std::count (owners.begin(), owners.end(), 1) == setSize;
+}
+
+int main ()
+{
+  ExampleGrid* mesh = example_grid(40, 30);
+  const int nModes = 4;
+  const insp_partitioning modes[] = {PART_HILBERT, PART_MORTON, PART_RCB, PART_BFS};
+  const std::string names[] = {"hilbert", "morton", "rcb", "bfs"};
+  const int seeds[] = {0, 2};
+  const int tileSize = 20;
+  int nFailures = 0;
+
+  for (int m = 0; m < nModes; m++) {
+    for (int s = 0; s < 2; s++) {
+      std::string what = names[m] + ", seed loop " + std::to_string (seeds[s]);
+      ExampleChain* chain = new ExampleChain(mesh);
+      // growing tiles by breadth-first search only needs the topology
+      bool geometric = modes[m] != PART_BFS;
+      map_list meshMaps ({chain->e2v, chain->c2v});
+      inspector_t* insp = insp_init(tileSize, OMP, COL_DEFAULT, geometric ? &meshMaps : NULL,
+                                    NULL, 1, false, "", modes[m],
+                                    geometric ? mesh->coords : NULL, DIM2);
+      example_add_loops (insp, chain);
+      insp_run (insp, seeds[s]);
+
+      ExampleData expected (mesh);
+      ExampleData actual (mesh);
+      example_run (chain, &expected);
+      example_run_tiles (insp, chain, &actual);
+      nFailures += example_check (insp->partitioningMode == names[m] && check_partition (insp),
+                                  "each iteration is in one tile, " + what);
+      nFailures += example_check (example_conflicts (insp) == 0 && actual == expected,
+                                  "the tiles execute the loop chain, " + what);
+
+      // free memory
+      executor_t* exec = exec_init (insp);
+      insp_free (insp);
+      exec_free (exec);
+      delete chain;
+    }
+  }
+
+  delete mesh;
+
+  return nFailures;
+}
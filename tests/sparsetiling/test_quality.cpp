@@ -0,0 +1,133 @@
+/*
+ *  test_quality.cpp
+ *
+ * Check the measures of the quality of a tiling on a line of vertices and
+ * edges, small enough for the tiling to be worked out by hand
+ */
+
+#include <cmath>
+
+#include "inspector.h"
+#include "executor.h"
+#include "common.hpp"
+
+static bool near (double a, double b)
+{
+  return fabs(a - b) < 1e-9;
+}
+
+static bool same_sizes (loop_stats_t& loopStats, int minSize, double meanSize,
+                        int maxSize, double stddevSize, double growth, double maxGrowth)
+{
+  return loopStats.minSize == minSize && near (loopStats.meanSize, meanSize) &&
+         loopStats.maxSize == maxSize && near (loopStats.stddevSize, stddevSize) &&
+         near (loopStats.growth, growth) && near (loopStats.maxGrowth, maxGrowth);
+}
+
+static bool same_access (access_stats_t& access, std::string map, std::string set,
+                         std::vector<index_t> touched, index_t boundary, double redundancy)
+{
+  return access.map == map && access.set == set && access.touched == touched &&
+         access.boundary == boundary && near (access.redundancy, redundancy);
+}
+
+static bool same_color (color_stats_t& color, int nTiles, long nIterations,
+                        long maxIterations, double imbalance)
+{
+  return color.nTiles == nTiles && color.nIterations == nIterations &&
+         color.maxIterations == maxIterations && near (color.imbalance, imbalance);
+}
+
+int main ()
+{
+  int nFailures = 0;
+
+  // 13 vertices on a line, joined by 12 edges
+  const int nEdges = 12;
+  index_t* e2vValues = new index_t[2*nEdges];
+  for (int e = 0; e < nEdges; e++) {
+    e2vValues[2*e] = e;
+    e2vValues[2*e + 1] = e + 1;
+  }
+  set_t* vertices = set("vertices", nEdges + 1);
+  set_t* edges = set("edges", nEdges);
+  map_t* e2v = map("e2v", edges, vertices, e2vValues, 2*nEdges);
+  desc_list descriptors0 ({desc(e2v, READ),
+                           desc(DIRECT, WRITE)});
+  desc_list descriptors1 ({desc(DIRECT, READ),
+                           desc(e2v, INC)});
+  desc_list descriptors2 ({desc(DIRECT, RW)});
+
+  inspector_t* insp = insp_init(4, OMP);
+  insp_add_parloop (insp, "pl0", edges, &descriptors0);
+  insp_add_parloop (insp, "pl1", edges, &descriptors1);
+  insp_add_parloop (insp, "pl2", vertices, &descriptors2);
+  insp_run (insp, 0);
+
+  // the seed loop is cut into the tiles {0-3}, {4-7}, {8-11}, which only touch
+  // their neighbours, so they are colored 0, 1, 0. In pl1, edges 3 and 8 follow
+  // the vertices 4 and 8 they increment, read by tile 1 in pl0; in pl2, vertices
+  // 3 and 9 follow the edges 3 and 8 incrementing them in pl1. Hence tile 1
+  // grows to {3-8} in pl1 and to {3-9} in pl2, while tiles 0 and 2 shrink to
+  // three iterations
+  std::vector<int> colors;
+  for (size_t t = 0; t < insp->tiles->size(); t++) {
+    colors.push_back (insp->tiles->at(t)->color);
+  }
+  nFailures += example_check (colors == std::vector<int>({0, 1, 0}) &&
+                              example_conflicts (insp) == 0,
+                              "the tiles are worked out by hand");
+
+  insp->nThreads = 1;
+  insp_measure_quality (insp);
+  insp_stats_t* stats = insp->stats;
+
+  // iterations per tile: {4, 4, 4}, {3, 6, 3}, {3, 7, 3}
+  nFailures += example_check (same_sizes (stats->loops[0], 4, 4.0, 4, 0.0, 1.0, 1.0) &&
+                              same_sizes (stats->loops[1], 3, 4.0, 6, sqrt(2.0), 1.0, 1.5) &&
+                              same_sizes (stats->loops[2], 3, 13.0/3, 7, sqrt(32.0)/3,
+                                          13.0/12, 7.0/4),
+                              "the iterations per tile, and their growth");
+
+  // vertices touched through /e2v/: {0-4}, {4-8}, {8-12} in pl0, and {0-3},
+  // {3-9}, {9-12} in pl1. Either way two vertices are touched twice, so 15
+  // vertices are touched out of 13
+  nFailures += example_check (stats->loops[0].accesses.size() == 2 &&
+                              same_access (stats->loops[0].accesses[0], "", "edges",
+                                           {4, 4, 4}, 0, 1.0) &&
+                              same_access (stats->loops[0].accesses[1], "e2v", "vertices",
+                                           {5, 5, 5}, 2, 15.0/13) &&
+                              stats->loops[1].accesses.size() == 2 &&
+                              same_access (stats->loops[1].accesses[0], "", "edges",
+                                           {3, 6, 3}, 0, 1.0) &&
+                              same_access (stats->loops[1].accesses[1], "e2v", "vertices",
+                                           {4, 7, 4}, 2, 15.0/13) &&
+                              stats->loops[2].accesses.size() == 1 &&
+                              same_access (stats->loops[2].accesses[0], "", "vertices",
+                                           {3, 7, 3}, 0, 1.0),
+                              "the data touched by the tiles");
+
+  // tiles 0 and 2 execute 10 iterations each, tile 1 17: with one thread, the
+  // critical path is all of the 37 iterations
+  nFailures += example_check (stats->colors.size() == 2 &&
+                              same_color (stats->colors[0], 2, 20, 10, 1.0) &&
+                              same_color (stats->colors[1], 1, 17, 17, 1.0) &&
+                              stats->criticalPath == 37 && near (stats->efficiency, 1.0),
+                              "the work within each color, one thread");
+
+  // with two threads, tiles 0 and 2 run side by side
+  insp->nThreads = 2;
+  insp_measure_quality (insp);
+  nFailures += example_check (stats->colors.size() == 2 &&
+                              stats->criticalPath == 10 + 17 &&
+                              near (stats->efficiency, 37.0 / (2*27)),
+                              "the work within each color, two threads");
+
+  // free memory
+  executor_t* exec = exec_init (insp);
+  insp_free (insp);
+  exec_free (exec);
+  delete[] e2vValues;
+
+  return nFailures;
+}
@@ -0,0 +1,50 @@
+/*
+ *  test_repair.cpp
+ *
+ * Check that repairing the conflicts found by a tiling sweep, rather than
+ * tiling the loop chain again from scratch, gives legal tiles
+ */
+
+#include "inspector.h"
+#include "executor.h"
+#include "common.hpp"
+
+int main ()
+{
+  ExampleGrid* mesh = example_grid(40, 30);
+  const int tileSizes[] = {6, 20};
+  const int seeds[] = {0, 2};
+  int nFailures = 0;
+
+  for (int i = 0; i < 2; i++) {
+    for (int s = 0; s < 2; s++) {
+      std::string what = "tile size " + std::to_string (tileSizes[i]) + ", seed loop " +
+                         std::to_string (seeds[s]);
+      ExampleChain* chain = new ExampleChain(mesh);
+      inspector_t* insp = insp_init(tileSizes[i], OMP, COL_DEFAULT, NULL, NULL, 1, false, "",
+                                    PART_DEFAULT, NULL, DIM2, 0, true);
+      example_add_loops (insp, chain);
+      insp_run (insp, seeds[s]);
+
+      // small tiles on this mesh always conflict at first
+      ExampleData expected (mesh);
+      ExampleData actual (mesh);
+      example_run (chain, &expected);
+      example_run_tiles (insp, chain, &actual);
+      nFailures += example_check (insp->nConflicts > 0 && insp->nRepairs > 0,
+                                  "conflicts are repaired, " + what);
+      nFailures += example_check (example_conflicts (insp) == 0 && actual == expected,
+                                  "the repaired tiles are legal, " + what);
+
+      // free memory
+      executor_t* exec = exec_init (insp);
+      insp_free (insp);
+      exec_free (exec);
+      delete chain;
+    }
+  }
+
+  delete mesh;
+
+  return nFailures;
+}
@@ -0,0 +1,89 @@
+/*
+ *  test_seed.cpp
+ *
+ * Check the automatic selection of the seed loop: the selected loop must be a
+ * legal seed loop, and the inspection must be the same as if that loop had been
+ * given as seed loop
+ */
+
+#include "inspector.h"
+#include "executor.h"
+#include "common.hpp"
+
+/*
+ * The color and the iterations of each tile, in each loop
+ */
+static std::vector<iterations_list> tiles_snapshot (inspector_t* insp)
+{
+  std::vector<iterations_list> snapshot;
+  for (size_t t = 0; t < insp->tiles->size(); t++) {
+    tile_t* tile = insp->tiles->at(t);
+    snapshot.push_back (iterations_list (1, tile->color));
+    for (size_t l = 0; l < insp->loops->size(); l++) {
+      snapshot.push_back (tile_get_iterations (tile, l));
+    }
+  }
+  return snapshot;
+}
+
+int main ()
+{
+  ExampleGrid* mesh = example_grid(32, 24);
+  const int tileSizes[] = {8, 30};
+  const insp_strategy strategies[] = {SEQUENTIAL, OMP};
+  const std::string names[] = {"SEQUENTIAL", "OMP"};
+  int nFailures = 0;
+
+  for (int i = 0; i < 2; i++) {
+    for (int s = 0; s < 2; s++) {
+      for (int irregular = 0; irregular < 2; irregular++) {
+        std::string what = names[s] + ", tile size " + std::to_string (tileSizes[i]) +
+                           (irregular ? ", irregular loop" : "");
+        ExampleChain* chain = new ExampleChain(mesh, irregular);
+        inspector_t* insp = insp_init(tileSizes[i], strategies[s]);
+        example_add_loops (insp, chain);
+        insp_run (insp, SEED_AUTO);
+
+        // the seed loop must be a non-empty loop, and with OMP it must read a
+        // map through which it can be colored
+        int seed = insp->seed;
+        bool legal = insp->autoSeed && seed >= 0 && seed < chain->nLoops;
+        if (legal) {
+          loop_t* seedLoop = insp->loops->at(seed);
+          legal = seedLoop->set->core > 0 && ! seedLoop->set->superset &&
+                  (strategies[s] != OMP || seedLoop->seedMap);
+        }
+        nFailures += example_check (legal, "the seed loop is legal, " + what);
+
+        ExampleData expected (mesh);
+        ExampleData actual (mesh);
+        example_run (chain, &expected);
+        example_run_tiles (insp, chain, &actual);
+        nFailures += example_check (example_conflicts (insp) == 0 && actual == expected,
+                                    "the tiles are legal, " + what);
+
+        // the trial inspections must not leak into the actual one. Ties between
+        // tiles are broken in the order of the access descriptors, which are
+        // the same only if the loop chain is the same
+        std::vector<iterations_list> autoTiles = tiles_snapshot (insp);
+        insp_run (insp, legal ? seed : 0);
+        nFailures += example_check (legal && tiles_snapshot (insp) == autoTiles,
+                                    "same tiles as with the seed loop given, " + what);
+        nFailures += example_check (! insp->autoSeed && insp->predictedGrowthFwd == 0.0 &&
+                                    insp->predictedGrowthBwd == 0.0 &&
+                                    insp->predictedConflicts == 0.0,
+                                    "no prediction with the seed loop given, " + what);
+
+        // free memory
+        executor_t* exec = exec_init (insp);
+        insp_free (insp);
+        exec_free (exec);
+        delete chain;
+      }
+    }
+  }
+
+  delete mesh;
+
+  return nFailures;
+}
@@ -0,0 +1,271 @@
+/*
+ *  test_stats.cpp
+ *
+ * Check the statistics of an inspection: the tiling sweeps tracked, the time
+ * spent in each phase, and their JSON output
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "inspector.h"
+#include "executor.h"
+#include "common.hpp"
+
+/*
+ * A minimal JSON parser, which only checks the syntax. The number of elements
+ * of each array that is the value of a key of the outermost object is stored in
+ * /nElements/, by key
+ */
+static void json_space (const char*& p)
+{
+  while (isspace(*p)) {
+    p++;
+  }
+}
+
+static bool json_string (const char*& p, std::string* value)
+{
+  if (*p != '"') {
+    return false;
+  }
+  std::string s;
+  for (p++; *p && *p != '"'; p++) {
+    if ((unsigned char)*p < 0x20) {
+      return false;
+    }
+    if (*p == '\\') {
+      p++;
+      if (! *p || ! strchr ("\"\\/bfnrtu", *p)) {
+        return false;
+      }
+    }
+    s += *p;
+  }
+  if (*p != '"') {
+    return false;
+  }
+  p++;
+  if (value) {
+    *value = s;
+  }
+  return true;
+}
+
+static bool json_number (const char*& p)
+{
+  const char* start = p;
+  if (*p == '-') {
+    p++;
+  }
+  if (*p == '0') {
+    p++;
+  }
+  else if (isdigit(*p)) {
+    while (isdigit(*p)) p++;
+  }
+  else {
+    return false;
+  }
+  if (*p == '.') {
+    p++;
+    if (! isdigit(*p)) {
+      return false;
+    }
+    while (isdigit(*p)) p++;
+  }
+  if (*p == 'e' || *p == 'E') {
+    p++;
+    if (*p == '+' || *p == '-') {
+      p++;
+    }
+    if (! isdigit(*p)) {
+      return false;
+    }
+    while (isdigit(*p)) p++;
+  }
+  return p > start;
+}
+
+static bool json_value (const char*& p, int depth, int* nArray,
+                        std::map<std::string, int>* nElements)
+{
+  json_space (p);
+  if (*p == '{') {
+    p++;
+    json_space (p);
+    if (*p == '}') {
+      p++;
+      return true;
+    }
+    while (true) {
+      std::string key;
+      json_space (p);
+      if (! json_string (p, &key)) {
+        return false;
+      }
+      json_space (p);
+      if (*p++ != ':') {
+        return false;
+      }
+      int n = -1;
+      if (! json_value (p, depth + 1, &n, nElements)) {
+        return false;
+      }
+      if (depth == 0 && n != -1) {
+        (*nElements)[key] = n;
+      }
+      json_space (p);
+      if (*p == '}') {
+        p++;
+        return true;
+      }
+      if (*p++ != ',') {
+        return false;
+      }
+    }
+  }
+  if (*p == '[') {
+    p++;
+    json_space (p);
+    int n = 0;
+    if (*p != ']') {
+      while (true) {
+        if (! json_value (p, depth + 1, NULL, nElements)) {
+          return false;
+        }
+        n++;
+        json_space (p);
+        if (*p == ']') {
+          break;
+        }
+        if (*p++ != ',') {
+          return false;
+        }
+      }
+    }
+    p++;
+    if (nArray) {
+      *nArray = n;
+    }
+    return true;
+  }
+  if (*p == '"') {
+    return json_string (p, NULL);
+  }
+  if (! strncmp (p, "true", 4) || ! strncmp (p, "null", 4)) {
+    p += 4;
+    return true;
+  }
+  if (! strncmp (p, "false", 5)) {
+    p += 5;
+    return true;
+  }
+  return json_number (p);
+}
+
+static bool json_parse (std::string text, std::map<std::string, int>* nElements)
+{
+  const char* p = text.c_str();
+  if (! json_value (p, 0, NULL, nElements)) {
+    return false;
+  }
+  json_space (p);
+  return *p == '\0';
+}
+
+int main ()
+{
+  ExampleGrid* mesh = example_grid(40, 30);
+  const std::string fileName = "test_stats.json";
+  const int tileSizes[] = {6, 40};
+  const int seeds[] = {0, 2};
+  int nFailures = 0;
+  bool severalSweeps = false;
+
+  for (int i = 0; i < 2; i++) {
+    for (int s = 0; s < 2; s++) {
+      std::string what = "tile size " + std::to_string (tileSizes[i]) +
+                         ", seed loop " + std::to_string (seeds[s]);
+      // conflicts are not repaired, but resolved by further tiling sweeps
+      ExampleChain* chain = new ExampleChain(mesh, true);
+      inspector_t* insp = insp_init(tileSizes[i], OMP, COL_DEFAULT, NULL, NULL, 1, false, "",
+                                    PART_DEFAULT, NULL, DIM2, 0, false);
+      example_add_loops (insp, chain);
+      insp_run (insp, seeds[s]);
+      insp_stats_t* stats = insp->stats;
+
+      int nRepairs = 0;
+      for (size_t k = 0; k < stats->sweeps.size(); k++) {
+        nRepairs += stats->sweeps[k].nRepairs;
+      }
+      severalSweeps |= insp->nSweeps > 1;
+      nFailures += example_check ((int)stats->sweeps.size() == insp->nSweeps &&
+                                  nRepairs == insp->nRepairs &&
+                                  stats->sweeps.back().nConflicts == 0 &&
+                                  (int)stats->loops.size() == chain->nLoops,
+                                  "one record per tiling sweep, " + what);
+
+      // the phases do not overlap, so their times add up to at most the total
+      double sumTimes = 0.0;
+      bool nonNegative = stats->totalTime >= 0.0;
+      for (int p = 0; p < N_PHASES; p++) {
+        nonNegative &= stats->times[p] >= 0.0;
+        sumTimes += stats->times[p];
+      }
+      double sumSweeps = 0.0;
+      for (size_t k = 0; k < stats->sweeps.size(); k++) {
+        nonNegative &= stats->sweeps[k].time >= 0.0 && stats->sweeps[k].repairTime >= 0.0;
+        sumSweeps += stats->sweeps[k].time + stats->sweeps[k].repairTime;
+      }
+      nFailures += example_check (nonNegative && sumTimes <= stats->totalTime &&
+                                  sumSweeps <= stats->totalTime,
+                                  "the phase times add up to at most the total, " + what);
+
+      // the JSON output parses, before and after measuring the quality
+      for (int quality = 0; quality < 2; quality++) {
+        if (quality) {
+          insp_measure_quality (insp);
+        }
+        std::remove (fileName.c_str());
+        insp_info result = insp_print_stats (insp, fileName);
+        std::ifstream file (fileName.c_str());
+        std::stringstream text;
+        text << file.rdbuf();
+        std::map<std::string, int> nElements;
+        bool parsed = json_parse (text.str(), &nElements);
+        nFailures += example_check (result == INSP_OK && parsed &&
+                                    nElements["sweeps"] == insp->nSweeps &&
+                                    nElements["loops"] == chain->nLoops &&
+                                    nElements["colors"] == (int)stats->colors.size(),
+                                    std::string("the statistics are valid JSON, ") +
+                                    (quality ? "with quality, " : "") + what);
+      }
+
+      // free memory
+      executor_t* exec = exec_init (insp);
+      insp_free (insp);
+      exec_free (exec);
+      delete chain;
+    }
+  }
+  nFailures += example_check (severalSweeps, "several tiling sweeps are tracked");
+
+  // the parser rejects invalid JSON
+  std::map<std::string, int> nElements;
+  nFailures += example_check (! json_parse ("{\"a\": nan}", &nElements) &&
+                              ! json_parse ("{\"a\": [1, 2,]}", &nElements) &&
+                              ! json_parse ("{\"a\": 1", &nElements) &&
+                              json_parse ("{\"a\": [1.5e-07, {\"b\": \"c\"}]}", &nElements) &&
+                              nElements["a"] == 2,
+                              "the JSON parser");
+
+  delete mesh;
+  std::remove (fileName.c_str());
+
+  return nFailures;
+}
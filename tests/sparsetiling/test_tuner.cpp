@@ -0,0 +1,138 @@
+/*
+ *  test_tuner.cpp
+ *
+ * Check the empirical selection of the tile size, with a kernel that is faster
+ * for a chosen tile size than for all others
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+#include "inspector.h"
+#include "executor.h"
+#include "tuner.h"
+#include "common.hpp"
+
+typedef struct {
+  inspector_t* insp;
+  /* the tile size for which the kernel returns immediately */
+  int fastTileSize;
+  /* the number of calls, and the tile sizes seen, so far */
+  int nCalls;
+  std::vector<int> tileSizes;
+} stub_args_t;
+
+/*
+ * Stand in for the execution of the loop chain: spin for a couple of
+ * milliseconds, unless the tile size being tried is /fastTileSize/
+ */
+static void stub_kernel (executor_t* exec, void* args)
+{
+  stub_args_t* stub = (stub_args_t*)args;
+  int tileSize = stub->insp->avgTileSize;
+  stub->nCalls++;
+  stub->tileSizes.push_back (tileSize);
+  if (tileSize == stub->fastTileSize) {
+    return;
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(2));
+}
+
+static int file_lines (std::string fileName)
+{
+  std::ifstream file (fileName.c_str());
+  std::string line;
+  int nLines = 0;
+  while (std::getline (file, line)) {
+    nLines++;
+  }
+  return nLines;
+}
+
+int main ()
+{
+  ExampleGrid* mesh = example_grid(24, 16);
+  const std::string fileName = "test_tuner.slope";
+  int tileSizes[] = {40, 10, 20, 0, 20};
+  const int nTileSizes = 5;
+  const int nRuns = 2;
+  int nFailures = 0;
+  std::remove (fileName.c_str());
+
+  ExampleChain* chain = new ExampleChain(mesh);
+  inspector_t* insp = insp_init(16, OMP);
+  example_add_loops (insp, chain);
+
+  // the fastest tile size is picked among the valid candidates, each of which
+  // is tried once, and then stored in the file
+  stub_args_t stub = {insp, 20, 0, std::vector<int>()};
+  tuning_t tuning;
+  insp_info result = insp_tune (insp, 1, stub_kernel, &stub, &tuning, tileSizes,
+                                nTileSizes, nRuns, EXEC_COLORS, fileName);
+  std::vector<int> seen (stub.tileSizes);
+  std::sort (seen.begin(), seen.end());
+  seen.erase (std::unique (seen.begin(), seen.end()), seen.end());
+  nFailures += example_check (result == INSP_OK && tuning.nTried == 3 &&
+                              stub.nCalls == 3*(nRuns + 1) &&
+                              seen == std::vector<int>({10, 20, 40}),
+                              "each valid candidate tile size is tried");
+  nFailures += example_check (tuning.avgTileSize == 20 && insp->avgTileSize == 20 &&
+                              insp->tiles && insp->seed == 1,
+                              "the fastest tile size is selected");
+  nFailures += example_check (file_lines (fileName) == 1,
+                              "the best tile size is stored");
+
+  // the loop chain is not tuned again, whatever the tile size the inspector
+  // starts from, and the inspection is run with the stored tile size
+  ExampleChain* storedChain = new ExampleChain(mesh);
+  inspector_t* storedInsp = insp_init(64, OMP);
+  example_add_loops (storedInsp, storedChain);
+  stub_args_t storedStub = {storedInsp, 40, 0, std::vector<int>()};
+  tuning_t storedTuning;
+  result = insp_tune (storedInsp, 1, stub_kernel, &storedStub, &storedTuning, tileSizes,
+                      nTileSizes, nRuns, EXEC_COLORS, fileName);
+  nFailures += example_check (result == INSP_OK && storedTuning.nTried == 0 &&
+                              storedStub.nCalls == 0 && storedTuning.avgTileSize == 20 &&
+                              storedInsp->avgTileSize == 20,
+                              "the best tile size is read back from file");
+  nFailures += example_check (example_same_tiles (insp->tiles, storedInsp->tiles, chain),
+                              "the inspection is run with the stored tile size");
+
+  // another seed loop is another inspection problem, which shares the file
+  ExampleChain* otherChain = new ExampleChain(mesh);
+  inspector_t* otherInsp = insp_init(16, OMP);
+  example_add_loops (otherInsp, otherChain);
+  stub_args_t otherStub = {otherInsp, 10, 0, std::vector<int>()};
+  tuning_t otherTuning;
+  result = insp_tune (otherInsp, 3, stub_kernel, &otherStub, &otherTuning, tileSizes,
+                      nTileSizes, nRuns, EXEC_COLORS, fileName);
+  nFailures += example_check (result == INSP_OK && otherTuning.nTried == 3 &&
+                              otherTuning.avgTileSize == 10 && file_lines (fileName) == 2,
+                              "another loop chain is tuned and stored");
+
+  // no valid candidate tile size
+  int invalidSizes[] = {0, -4};
+  result = insp_tune (otherInsp, 3, stub_kernel, &otherStub, NULL, invalidSizes, 2);
+  nFailures += example_check (result == INSP_ERR && otherInsp->avgTileSize == 10,
+                              "no valid candidate tile size");
+
+  // free memory
+  executor_t* exec = exec_init (insp);
+  executor_t* storedExec = exec_init (storedInsp);
+  executor_t* otherExec = exec_init (otherInsp);
+  insp_free (insp);
+  insp_free (storedInsp);
+  insp_free (otherInsp);
+  exec_free (exec);
+  exec_free (storedExec);
+  exec_free (otherExec);
+  delete chain;
+  delete storedChain;
+  delete otherChain;
+  delete mesh;
+  std::remove (fileName.c_str());
+
+  return nFailures;
+}